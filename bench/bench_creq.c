@@ -0,0 +1,305 @@
+/**
+ * @file bench_creq.c
+ * @brief Microbenchmarks of the object API on realistic message shapes.
+ * @author CSharperMantle
+ *
+ * Prints one JSON object per line and measurement, e.g.
+ *   {"shape":"small_get","op":"stringify","ops":65536,"ns_per_op":52.1,"bytes_per_op":61.0,"allocs_per_op":1.00,...}
+ * so that runs on two commits can be diffed or loaded by a script. Allocations are counted through
+ * creq_set_allocator(); bytes_per_op is the number of bytes requested from the allocator.
+ *
+ * Usage: creq_bench [scale], where 'scale' multiplies the number of iterations (default 1).
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "creq.h"
+
+static size_t alloc_count, alloc_bytes;
+
+static void *counting_malloc(size_t size, void *user_data)
+{
+    (void)user_data;
+    alloc_count++;
+    alloc_bytes += size;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *user_data)
+{
+    (void)user_data;
+    alloc_count++;
+    alloc_bytes += size;
+    return realloc(ptr, size);
+}
+
+static void counting_free(void *ptr, void *user_data)
+{
+    (void)user_data;
+    free(ptr);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+typedef struct
+{
+    const char *name;
+    bool is_response;
+    int header_count;
+    size_t body_len;
+} bench_shape_t;
+
+static const bench_shape_t shapes[] = {
+    {"small_get", false, 3, 0},
+    {"response_20_headers", true, 20, 256},
+    {"large_body", true, 4, 1 << 20},
+    {"many_headers", false, 200, 0},
+};
+
+/// Field names of real traffic first, then numbered custom ones.
+static const char *const common_names[] = {"Host",          "User-Agent", "Accept",        "Accept-Encoding",
+                                           "Content-Type",  "Connection", "Cache-Control", "Date",
+                                           "Server",        "ETag",       "Last-Modified", "Vary",
+                                           "Accept-Ranges", "Set-Cookie", "Expires"};
+#define COMMON_NAME_COUNT (sizeof(common_names) / sizeof(common_names[0]))
+
+static char header_names[256][32];
+static char header_values[256][48];
+static char *body;
+
+static void prepare_fields(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        if ((size_t)i < COMMON_NAME_COUNT)
+            snprintf(header_names[i], sizeof(header_names[i]), "%s", common_names[i]);
+        else
+            snprintf(header_names[i], sizeof(header_names[i]), "X-Custom-Header-%d", i);
+        snprintf(header_values[i], sizeof(header_values[i]), "value-%d-0123456789abcdefghijklmnop", i);
+    }
+    body = (char *)malloc((size_t)(1 << 20) + 1);
+    memset(body, 'b', 1 << 20);
+    body[1 << 20] = '\0';
+}
+
+static void *shape_create(const bench_shape_t *shape)
+{
+    if (shape->is_response)
+        return creq_Response_create(NULL);
+    return creq_Request_create(NULL);
+}
+
+static void shape_add_headers(const bench_shape_t *shape, void *msg)
+{
+    for (int i = 0; i < shape->header_count; i++)
+    {
+        if (shape->is_response)
+            creq_Response_add_header((creq_Response_t *)msg, header_names[i], header_values[i]);
+        else
+            creq_Request_add_header((creq_Request_t *)msg, header_names[i], header_values[i], false);
+    }
+}
+
+static void shape_fill(const bench_shape_t *shape, void *msg)
+{
+    if (shape->is_response)
+    {
+        creq_Response_t *resp = (creq_Response_t *)msg;
+        creq_Response_set_http_version(resp, 1, 1);
+        creq_Response_set_status_code(resp, 200);
+        creq_Response_set_reason_phrase_literal(resp, "OK");
+        shape_add_headers(shape, msg);
+        creq_Response_set_message_body_bytes(resp, body, shape->body_len, OWN_BORROW);
+        creq_Response_update_content_len(resp);
+    }
+    else
+    {
+        creq_Request_t *req = (creq_Request_t *)msg;
+        creq_Request_set_http_method(req, METH_GET);
+        creq_Request_set_target(req, "/index.html", true);
+        creq_Request_set_http_version(req, 1, 1);
+        shape_add_headers(shape, msg);
+    }
+}
+
+static void *shape_search(const bench_shape_t *shape, void *msg, char *name)
+{
+    if (shape->is_response)
+        return creq_Response_search_for_header((creq_Response_t *)msg, name);
+    return creq_Request_search_for_header((creq_Request_t *)msg, name);
+}
+
+static void shape_stringify(const bench_shape_t *shape, void *msg)
+{
+    char *str = shape->is_response ? creq_Response_stringify((creq_Response_t *)msg)
+                                   : creq_Request_stringify((creq_Request_t *)msg);
+    creq_free(str);
+}
+
+static void shape_stringify_cached(const bench_shape_t *shape, void *msg)
+{
+    if (shape->is_response)
+        creq_Response_stringify_cached((creq_Response_t *)msg, NULL);
+    else
+        creq_Request_stringify_cached((creq_Request_t *)msg, NULL);
+}
+
+/// Changes the value of one header, as a server would for e.g. a request ID.
+static void shape_touch_header(const bench_shape_t *shape, void *msg, int round)
+{
+    char *name = header_names[shape->header_count / 2], *value = header_values[round % 2];
+    if (shape->is_response)
+        creq_Response_set_header((creq_Response_t *)msg, name, value);
+    else
+        creq_Request_set_header((creq_Request_t *)msg, name, value, true);
+}
+
+static size_t shape_length(const bench_shape_t *shape, void *msg)
+{
+    size_t needed = 0;
+    if (shape->is_response)
+        creq_Response_stringify_into((creq_Response_t *)msg, NULL, 0, &needed);
+    else
+        creq_Request_stringify_into((creq_Request_t *)msg, NULL, 0, &needed);
+    return needed;
+}
+
+static void shape_free(const bench_shape_t *shape, void *msg)
+{
+    if (shape->is_response)
+        creq_Response_free((creq_Response_t *)msg);
+    else
+        creq_Request_free((creq_Request_t *)msg);
+}
+
+typedef struct
+{
+    double ns;
+    size_t allocs;
+    size_t bytes;
+    size_t ops;
+} bench_sample_t;
+
+static void sample_begin(bench_sample_t *sample)
+{
+    sample->allocs = alloc_count;
+    sample->bytes = alloc_bytes;
+    sample->ns = now_ns();
+}
+
+static void sample_end(bench_sample_t *sample, bench_sample_t *total, size_t ops)
+{
+    total->ns += now_ns() - sample->ns;
+    total->allocs += alloc_count - sample->allocs;
+    total->bytes += alloc_bytes - sample->bytes;
+    total->ops += ops;
+}
+
+static void report(const bench_shape_t *shape, const char *op, const bench_sample_t *total, size_t message_bytes)
+{
+    double ops = (double)total->ops;
+    printf("{\"shape\":\"%s\",\"op\":\"%s\",\"ops\":%zu,\"ns_per_op\":%.1f,\"bytes_per_op\":%.1f,"
+           "\"allocs_per_op\":%.2f,\"headers\":%d,\"message_bytes\":%zu}\n",
+           shape->name, op, total->ops, total->ns / ops, (double)total->bytes / ops, (double)total->allocs / ops,
+           shape->header_count, message_bytes);
+}
+
+#define BATCH 256
+
+static void run_shape(const bench_shape_t *shape, int scale)
+{
+    static void *msgs[BATCH];
+    bench_sample_t create = {0}, add = {0}, search = {0}, stringify = {0}, cached = {0}, cached_dirty = {0},
+                   destroy = {0}, sample;
+    size_t message_bytes = 0;
+    // about the same amount of work for every shape
+    int rounds = scale * (int)(20000 / ((size_t)shape->header_count * 8 + shape->body_len / 512 + 16));
+    char *last_name = header_names[shape->header_count - 1];
+    for (int round = 0; round < (rounds > 0 ? rounds : 1); round++)
+    {
+        sample_begin(&sample);
+        for (int i = 0; i < BATCH; i++)
+            msgs[i] = shape_create(shape);
+        sample_end(&sample, &create, BATCH);
+
+        sample_begin(&sample);
+        for (int i = 0; i < BATCH; i++)
+            shape_add_headers(shape, msgs[i]);
+        sample_end(&sample, &add, (size_t)BATCH * (size_t)shape->header_count);
+
+        for (int i = 0; i < BATCH; i++)
+        {
+            shape_free(shape, msgs[i]);
+            msgs[i] = shape_create(shape);
+            shape_fill(shape, msgs[i]);
+        }
+        message_bytes = shape_length(shape, msgs[0]);
+
+        sample_begin(&sample);
+        for (int i = 0; i < BATCH; i++)
+            shape_search(shape, msgs[i], last_name);
+        sample_end(&sample, &search, BATCH);
+
+        sample_begin(&sample);
+        for (int i = 0; i < BATCH; i++)
+            shape_stringify(shape, msgs[i]);
+        sample_end(&sample, &stringify, BATCH);
+
+        for (int i = 0; i < BATCH; i++)
+            shape_stringify_cached(shape, msgs[i]);
+        sample_begin(&sample);
+        for (int i = 0; i < BATCH; i++)
+            shape_stringify_cached(shape, msgs[i]);
+        sample_end(&sample, &cached, BATCH);
+
+        // once to get both buffers of the cache allocated, then measured
+        for (int i = 0; i < BATCH; i++)
+        {
+            shape_touch_header(shape, msgs[i], round + 1);
+            shape_stringify_cached(shape, msgs[i]);
+            shape_touch_header(shape, msgs[i], round);
+        }
+        sample_begin(&sample);
+        for (int i = 0; i < BATCH; i++)
+            shape_stringify_cached(shape, msgs[i]);
+        sample_end(&sample, &cached_dirty, BATCH);
+
+        sample_begin(&sample);
+        for (int i = 0; i < BATCH; i++)
+            shape_free(shape, msgs[i]);
+        sample_end(&sample, &destroy, BATCH);
+    }
+    report(shape, "create", &create, message_bytes);
+    report(shape, "add_header", &add, message_bytes);
+    report(shape, "search_for_header", &search, message_bytes);
+    report(shape, "stringify", &stringify, message_bytes);
+    report(shape, "stringify_cached", &cached, message_bytes);
+    report(shape, "stringify_cached_1_changed", &cached_dirty, message_bytes);
+    report(shape, "free", &destroy, message_bytes);
+}
+
+int main(int argc, char **argv)
+{
+    int scale = argc > 1 ? atoi(argv[1]) : 1;
+    const creq_Allocator_t allocator = {counting_malloc, counting_realloc, counting_free, NULL};
+    if (scale <= 0 || creq_set_allocator(&allocator) != CREQ_STATUS_SUCC)
+    {
+        fprintf(stderr, "usage: %s [scale]\n", argv[0]);
+        return 1;
+    }
+    prepare_fields();
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++)
+    {
+        run_shape(&shapes[i], scale);
+    }
+    free(body);
+    return 0;
+}
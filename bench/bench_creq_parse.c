@@ -0,0 +1,95 @@
+/**
+ * @file bench_creq_parse.c
+ * @brief Measures creq_Request_parse() on typical and large header sets, whole and in partial reads.
+ * @author CSharperMantle
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "creq.h"
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/// A browser-like GET followed by 'extra' custom headers.
+static char *make_request(int extra, size_t *len)
+{
+    static const char head[] = "GET /search?q=creq&lang=en HTTP/1.1\r\n"
+                               "Host: www.example.com\r\n"
+                               "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+                               "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                               "Accept-Language: en-US,en;q=0.5\r\n"
+                               "Accept-Encoding: gzip, deflate, br\r\n"
+                               "Referer: https://www.example.com/\r\n"
+                               "Connection: keep-alive\r\n"
+                               "Cookie: session=0123456789abcdef; theme=dark\r\n"
+                               "Upgrade-Insecure-Requests: 1\r\n"
+                               "Cache-Control: max-age=0\r\n";
+    size_t cap = sizeof(head) + (size_t)extra * 64 + 3;
+    char *buf = (char *)malloc(cap);
+    size_t n = (size_t)snprintf(buf, cap, "%s", head);
+    for (int i = 0; i < extra; i++)
+    {
+        n += (size_t)snprintf(buf + n, cap - n, "X-Bench-Header-%d: value-%d-abcdefghijklmnopqrstuvwxyz\r\n", i, i);
+    }
+    n += (size_t)snprintf(buf + n, cap - n, "\r\n");
+    *len = n;
+    return buf;
+}
+
+/// Parses 'buf' revealing 'chunk' more bytes per call, as successive reads would.
+static int parse_once(const char *buf, size_t len, size_t chunk, const creq_ParseLimits_t *limits)
+{
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_Parser_t parser;
+    creq_Parser_init(&parser, limits);
+    creq_status_t status = CREQ_STATUS_INCOMPLETE;
+    for (size_t avail = chunk < len ? chunk : len; status == CREQ_STATUS_INCOMPLETE; avail += chunk)
+    {
+        status = creq_Request_parse(&parser, req, buf, avail < len ? avail : len);
+    }
+    creq_Request_free(req);
+    return status == CREQ_STATUS_SUCC ? 0 : 1;
+}
+
+int main(void)
+{
+    static const int extra_counts[] = {0, 90};
+    static const size_t chunks[] = {(size_t)-1, 512, 64};
+    const creq_ParseLimits_t limits = {128, 0};
+    printf("%-8s %8s %8s %12s %10s\n", "headers", "bytes", "read", "ns/op", "MB/s");
+    for (size_t i = 0; i < sizeof(extra_counts) / sizeof(extra_counts[0]); i++)
+    {
+        size_t len = 0;
+        char *buf = make_request(extra_counts[i], &len);
+        for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+        {
+            int iterations = 2000000 / (extra_counts[i] + 10);
+            if (parse_once(buf, len, chunks[c], &limits) != 0)
+            {
+                fprintf(stderr, "parse failed at %d headers\n", extra_counts[i] + 10);
+                return 1;
+            }
+            double begin = now_ns();
+            for (int n = 0; n < iterations; n++)
+            {
+                parse_once(buf, len, chunks[c], &limits);
+            }
+            double per_op = (now_ns() - begin) / iterations;
+            char read[24] = "whole";
+            if (chunks[c] != (size_t)-1)
+            {
+                snprintf(read, sizeof(read), "%zu", chunks[c]);
+            }
+            printf("%-8d %8zu %8s %12.0f %10.1f\n", extra_counts[i] + 10, len, read, per_op, (double)len * 1e3 / per_op);
+        }
+        free(buf);
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file bench_creq_stringify.c
+ * @brief Compares creq_*_stringify() against the former snprintf/strcat pipeline.
+ * @author CSharperMantle
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "creq.h"
+
+/*
+ * The former response serializer, kept verbatim (modulo naming) as the reference both for timing and for
+ * checking that the current output is byte-identical.
+ */
+static char *legacy_Response_stringify(creq_Response_t *resp)
+{
+    const char *line_ending_s = "\r\n";
+    int len = snprintf(NULL, 0, "HTTP/%d.%d", resp->http_version.major, resp->http_version.minor);
+    char *http_version_s = (char *)calloc(len + 1, 1);
+    snprintf(http_version_s, len + 1, "HTTP/%d.%d", resp->http_version.major, resp->http_version.minor);
+
+    int status_line_len =
+        snprintf(NULL, 0, "%s %d %s%s", http_version_s, resp->status_code, resp->reason_phrase, line_ending_s);
+    char *status_line_s = (char *)calloc(status_line_len + 1, 1);
+    snprintf(status_line_s, status_line_len + 1, "%s %d %s%s", http_version_s, resp->status_code,
+             resp->reason_phrase, line_ending_s);
+    free(http_version_s);
+
+    char *headers_s = NULL;
+    size_t header_list_len = cvector_size(resp->header_vector);
+    if (header_list_len != 0)
+    {
+        int str_len = 0;
+        creq_HeaderField_t *hv = resp->header_vector;
+        for (size_t idx = 0; idx < header_list_len; idx++)
+        {
+            str_len += snprintf(NULL, 0, "%s: %s%s", hv[idx].field_name, hv[idx].field_value, line_ending_s);
+        }
+        headers_s = (char *)calloc(str_len + 1, 1);
+        for (size_t idx = 0; idx < header_list_len; idx++)
+        {
+            int hlen = snprintf(NULL, 0, "%s: %s%s", hv[idx].field_name, hv[idx].field_value, line_ending_s);
+            char *str = (char *)calloc(hlen + 1, 1);
+            snprintf(str, hlen + 1, "%s: %s%s", hv[idx].field_name, hv[idx].field_value, line_ending_s);
+            strcat(headers_s, str);
+            free(str);
+        }
+    }
+
+    const char *body_s = resp->message_body;
+    int full_resp_len = snprintf(NULL, 0, "%s%s%s%s", status_line_s, headers_s == NULL ? line_ending_s : headers_s,
+                                 line_ending_s, body_s == NULL ? "" : body_s);
+    char *full_resp_s = (char *)calloc(full_resp_len + 1, 1);
+    snprintf(full_resp_s, full_resp_len + 1, "%s%s%s%s", status_line_s, headers_s == NULL ? line_ending_s : headers_s,
+             line_ending_s, body_s == NULL ? "" : body_s);
+    free(status_line_s);
+    free(headers_s);
+    return full_resp_s;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static creq_Response_t *make_response(int header_count)
+{
+    creq_Response_t *resp = creq_Response_create(NULL);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase_literal(resp, "OK");
+    for (int i = 0; i < header_count; i++)
+    {
+        char name[32], value[64];
+        snprintf(name, sizeof(name), "X-Bench-Header-%d", i);
+        snprintf(value, sizeof(value), "value-%d-abcdefghijklmnopqrstuvwxyz", i);
+        creq_Response_add_header(resp, name, value);
+    }
+    creq_Response_set_message_body_literal_content_len(resp, "<html><body>Hello, world!</body></html>");
+    return resp;
+}
+
+/// 'release' matches the allocator of 'fn': free() for the legacy pipeline, creq_free() for creq.
+static double time_per_op(char *(*fn)(creq_Response_t *), void (*release)(void *), creq_Response_t *resp,
+                          int iterations)
+{
+    double begin = now_ns();
+    for (int i = 0; i < iterations; i++)
+    {
+        char *s = fn(resp);
+        release(s);
+    }
+    return (now_ns() - begin) / iterations;
+}
+
+/// Times a full validation, the cached verdict being dropped before every run.
+static double validate_per_op(creq_Response_t *resp, int iterations)
+{
+    double begin = now_ns();
+    for (int i = 0; i < iterations; i++)
+    {
+        resp->is_verified = false;
+        if (creq_Response_validate(resp) != CREQ_STATUS_SUCC)
+        {
+            return -1;
+        }
+    }
+    return (now_ns() - begin) / iterations;
+}
+
+int main(void)
+{
+    static const int header_counts[] = {5, 50, 500};
+    printf("%-8s %14s %14s %8s %15s\n", "headers", "legacy ns/op", "current ns/op", "speedup", "validate ns/op");
+    for (size_t i = 0; i < sizeof(header_counts) / sizeof(header_counts[0]); i++)
+    {
+        creq_Response_t *resp = make_response(header_counts[i]);
+        char *expected = legacy_Response_stringify(resp);
+        char *actual = creq_Response_stringify(resp);
+        if (strcmp(expected, actual) != 0)
+        {
+            fprintf(stderr, "output mismatch at %d headers\n", header_counts[i]);
+            return 1;
+        }
+        free(expected);
+        creq_free(actual);
+
+        int iterations = 2000000 / (header_counts[i] + 10);
+        double legacy = time_per_op(legacy_Response_stringify, free, resp, iterations);
+        double current = time_per_op(creq_Response_stringify, creq_free, resp, iterations);
+        double validate = validate_per_op(resp, iterations);
+        printf("%-8d %14.0f %14.0f %7.1fx %15.0f\n", header_counts[i], legacy, current, legacy / current, validate);
+        creq_Response_free(resp);
+    }
+    return 0;
+}
@@ -60,6 +60,12 @@ extern "C"
 #endif
 #endif
 
+/* POSIX I/O (struct iovec and friends) is used when available. Define CREQ_NO_POSIX_IO to opt out, e.g. on MCUs. */
+#if !defined(CREQ_NO_POSIX_IO) && !defined(CREQ_POSIX_IO) &&                                                          \
+    (defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__)))
+#define CREQ_POSIX_IO
+#endif
+
 /**
  * @brief Type for return values used when a function needs an error-indicating returning.
  * @see CREQ_STATUS_SUCC
@@ -78,23 +84,52 @@ typedef int creq_status_t;
  */
 #define CREQ_STATUS_FAILED 1
 
+/**
+ * @brief Value returned by parsers when the input ends before the message does, and by creq_Writer_write() when the
+ * output is full before the message is written. Call again once more bytes arrive or the output is writable again.
+ */
+#define CREQ_STATUS_INCOMPLETE 2
+
 /**
  * @brief Function-like marco for easy access to freeing a pointer with NULL-checks.
- * @attention This marco is intended for internal-uses only. Use this marco iff the pointer is malloced.
+ * @attention This marco is intended for internal-uses only. Use this marco iff the pointer is allocated by creq_malloc().
  */
 #define CREQ_GUARDED_FREE(ptr)                                                                                         \
 if (ptr != NULL)                                                                                                   \
 {                                                                                                                  \
-    free(ptr);                                                                                                     \
+    creq_free(ptr);                                                                                                \
     ptr = NULL;                                                                                                    \
 }
 
 #define CVECTOR_LOGARITHMIC_GROWTH
+#define cvector_clib_malloc creq_malloc
+#define cvector_clib_realloc creq_realloc
+#define cvector_clib_free creq_free
 
 #include "cvector.h"
 #include <inttypes.h>
 #include <stdbool.h>
 #include <wchar.h>
+#ifdef CREQ_POSIX_IO
+#include <limits.h>
+#include <sys/uio.h>
+#endif
+
+/**
+ * @brief Allocation hooks used for every allocation creq makes, including header vector growth.
+ * @see creq_set_allocator()
+ */
+typedef struct creq_Allocator
+{
+    /// Same contract as malloc().
+    void *(*malloc_fn)(size_t size, void *user_data);
+    /// Same contract as realloc().
+    void *(*realloc_fn)(void *ptr, size_t size, void *user_data);
+    /// Same contract as free().
+    void (*free_fn)(void *ptr, void *user_data);
+    /// Passed as-is to the hooks.
+    void *user_data;
+} creq_Allocator_t;
 
 /**
  * @brief Line ending styles used in request/response generation.
@@ -137,6 +172,133 @@ typedef enum creq_ConfigType_e
     CONF_RESPONSE
 } creq_ConfigType_t;
 
+/**
+ * @brief Optional behaviours of request/response objects, combined with bitwise OR.
+ * @see creq_Request_create_with_options()
+ * @see creq_Response_create_with_options()
+ */
+typedef enum creq_ConfigOption_e
+{
+    /// Allocate the object, its owned strings, header nodes and header vector from one chained per-object arena.
+    /// Everything is released at once by creq_Request_free()/creq_Response_free(). Memory of replaced or removed
+    /// fields is only reclaimed then, or by creq_Request_reset()/creq_Response_reset().
+    CONF_OPT_ARENA = 1 << 0,
+    /// Maintain a hash index over header names so that looking a header up does not scan the header list.
+    CONF_OPT_HEADER_INDEX = 1 << 1,
+    /// Refuse to serialize the object unless it passes creq_Request_validate()/creq_Response_validate(). The check
+    /// runs once per change to the object.
+    CONF_OPT_VALIDATE = 1 << 2
+} creq_ConfigOption_t;
+
+/**
+ * @brief Size in bytes of the first block of a per-object arena. Later blocks double in size.
+ * @see CONF_OPT_ARENA
+ */
+#ifndef CREQ_ARENA_BLOCK_SIZE
+#define CREQ_ARENA_BLOCK_SIZE 1024
+#endif
+
+/**
+ * @brief Opaque per-object arena.
+ * @see CONF_OPT_ARENA
+ */
+typedef struct creq_Arena creq_Arena_t;
+
+/**
+ * @brief Opaque per-object header name index.
+ * @see CONF_OPT_HEADER_INDEX
+ */
+typedef struct creq_HeaderIndex creq_HeaderIndex_t;
+
+/**
+ * @brief Opaque per-object copy of the last serialized message.
+ * @see creq_Request_stringify_cached()
+ * @see creq_Response_stringify_cached()
+ */
+typedef struct creq_SerialCache creq_SerialCache_t;
+
+/**
+ * @brief Opaque per-object store of strings kept for reuse.
+ * @see creq_Request_reset()
+ * @see creq_Response_reset()
+ */
+typedef struct creq_StringBin creq_StringBin_t;
+
+/**
+ * @brief An immutable, reference-counted set of headers shared by many messages as their default headers.
+ * @see creq_HeaderProfile_create_from_request()
+ * @see creq_Request_set_header_profile()
+ */
+typedef struct creq_HeaderProfile creq_HeaderProfile_t;
+
+/// Maximum number of headers in a header profile.
+#define CREQ_HEADER_PROFILE_MAX_FIELDS 64
+
+/**
+ * @brief IDs of well-known field names.
+ * @note Headers added by ID are emitted with the canonical spelling and their names are never copied. Every header
+ * whose name matches one of these case-insensitively is tagged with its ID, so looking it up compares integers only.
+ * @see creq_get_header_name()
+ * @see creq_get_header_id()
+ */
+typedef enum creq_HeaderId_e
+{
+    CREQ_HDR_UNKNOWN = 0,
+    CREQ_HDR_ACCEPT,
+    CREQ_HDR_ACCEPT_CHARSET,
+    CREQ_HDR_ACCEPT_ENCODING,
+    CREQ_HDR_ACCEPT_LANGUAGE,
+    CREQ_HDR_ACCEPT_RANGES,
+    CREQ_HDR_ACCESS_CONTROL_ALLOW_ORIGIN,
+    CREQ_HDR_AGE,
+    CREQ_HDR_ALLOW,
+    CREQ_HDR_AUTHORIZATION,
+    CREQ_HDR_CACHE_CONTROL,
+    CREQ_HDR_CONNECTION,
+    CREQ_HDR_CONTENT_DISPOSITION,
+    CREQ_HDR_CONTENT_ENCODING,
+    CREQ_HDR_CONTENT_LANGUAGE,
+    CREQ_HDR_CONTENT_LENGTH,
+    CREQ_HDR_CONTENT_LOCATION,
+    CREQ_HDR_CONTENT_RANGE,
+    CREQ_HDR_CONTENT_TYPE,
+    CREQ_HDR_COOKIE,
+    CREQ_HDR_DATE,
+    CREQ_HDR_ETAG,
+    CREQ_HDR_EXPECT,
+    CREQ_HDR_EXPIRES,
+    CREQ_HDR_FROM,
+    CREQ_HDR_HOST,
+    CREQ_HDR_IF_MATCH,
+    CREQ_HDR_IF_MODIFIED_SINCE,
+    CREQ_HDR_IF_NONE_MATCH,
+    CREQ_HDR_IF_RANGE,
+    CREQ_HDR_IF_UNMODIFIED_SINCE,
+    CREQ_HDR_KEEP_ALIVE,
+    CREQ_HDR_LAST_MODIFIED,
+    CREQ_HDR_LOCATION,
+    CREQ_HDR_MAX_FORWARDS,
+    CREQ_HDR_ORIGIN,
+    CREQ_HDR_PRAGMA,
+    CREQ_HDR_PROXY_AUTHENTICATE,
+    CREQ_HDR_PROXY_AUTHORIZATION,
+    CREQ_HDR_RANGE,
+    CREQ_HDR_REFERER,
+    CREQ_HDR_RETRY_AFTER,
+    CREQ_HDR_SERVER,
+    CREQ_HDR_SET_COOKIE,
+    CREQ_HDR_STRICT_TRANSPORT_SECURITY,
+    CREQ_HDR_TE,
+    CREQ_HDR_TRAILER,
+    CREQ_HDR_TRANSFER_ENCODING,
+    CREQ_HDR_UPGRADE,
+    CREQ_HDR_USER_AGENT,
+    CREQ_HDR_VARY,
+    CREQ_HDR_VIA,
+    CREQ_HDR_WWW_AUTHENTICATE,
+    _CREQ_HDR_COUNT
+} creq_HeaderId_t;
+
 /**
  * @brief Represents a single header-value pair used in request and response.
  * @attention Manually editing these fields is not encouraged. Poorly-set values may cause use-after-free situation and/or crashes.
@@ -144,13 +306,103 @@ typedef enum creq_ConfigType_e
 typedef struct creq_HeaderField
 {
     char *field_name;
+    /// Length of field_name in bytes. field_name is not NUL-terminated if it was given by a *_n setter as a literal.
+    size_t field_name_len;
     bool is_field_name_literal;
+    /// Whether field_name is the library's own spelling of the well-known header field_id. Do not touch.
+    bool is_field_name_static;
     char *field_value;
+    /// Length of field_value in bytes. field_value is not NUL-terminated if it was given by a *_n setter as a literal.
+    size_t field_value_len;
     bool is_field_value_literal;
+    /// Case-insensitive hash of field_name.
+    uint32_t field_name_hash;
+    /// ID of field_name if it is well-known, CREQ_HDR_UNKNOWN otherwise.
+    creq_HeaderId_t field_id;
 } creq_HeaderField_t;
 
+/**
+ * @brief Iterates over every occurrence of a header, in list order.
+ * @see creq_Request_header_iter_begin()
+ * @see creq_Response_header_iter_begin()
+ */
+typedef struct creq_HeaderIter
+{
+    const char *name;
+    size_t name_len;
+    uint32_t name_hash;
+    creq_HeaderId_t name_id;
+    size_t next_index;
+} creq_HeaderIter_t;
+
+/**
+ * @brief A scatter-gather I/O vector entry.
+ * @note On POSIX systems this is 'struct iovec', so arrays of it can be passed to writev() and sendmsg() directly.
+ */
+#ifdef CREQ_POSIX_IO
+typedef struct iovec creq_IoVec_t;
+#else
+typedef struct creq_IoVec
+{
+    void *iov_base;
+    size_t iov_len;
+} creq_IoVec_t;
+#endif
+
+/**
+ * @brief Most entries an I/O vector function fills, so that the vector can always be passed to one writev() call.
+ * @note A message needs four entries per header field, so this caps the I/O vector functions at about 250 headers.
+ * Larger messages are refused and have to be serialized some other way.
+ */
+#ifdef IOV_MAX
+#define CREQ_IOV_MAX IOV_MAX
+#else
+#define CREQ_IOV_MAX 1024
+#endif
+
+/**
+ * @brief Size of creq_IoVecScratch_t::data.
+ */
+#define CREQ_IOVEC_SCRATCH_LEN 64
+
+/**
+ * @brief Caller-owned storage for the bytes of an I/O vector that do not exist anywhere else, e.g. "HTTP/1.1".
+ * @attention It must outlive every use of the I/O vector it is filled together with.
+ */
+typedef struct creq_IoVecScratch
+{
+    char data[CREQ_IOVEC_SCRATCH_LEN];
+} creq_IoVecScratch_t;
+
+/**
+ * @brief Number of headers a request/response stores inside the object itself before allocating header storage.
+ */
+#ifndef CREQ_INLINE_HEADER_CAPACITY
+#define CREQ_INLINE_HEADER_CAPACITY 8
+#endif
+
+/**
+ * @brief Length of an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+ * @see creq_Response_add_date_header()
+ */
+#define CREQ_HTTP_DATE_LEN 29
+
+/**
+ * @brief How a setter treats the buffer it is given.
+ */
+typedef enum creq_Ownership_e
+{
+    /// The object stores its own copy. The caller keeps the buffer.
+    OWN_COPY,
+    /// The object stores the pointer. The caller keeps the buffer alive and unchanged while the object uses it.
+    OWN_BORROW,
+    /// The object takes the buffer and frees it with creq_free(). It must come from creq_malloc().
+    OWN_TRANSFER
+} creq_Ownership_t;
+
 /**
  * @brief Configuration used in both request and response.
+ * @attention Zero-initialize it (e.g. '= {0}') so that fields you do not set keep their defaults.
  */
 typedef struct creq_Config
 {
@@ -159,12 +411,10 @@ typedef struct creq_Config
         struct
         {
             creq_LineEnding_t line_ending;
-
         } request_config;
         struct
         {
             creq_LineEnding_t line_ending;
-
         } response_config;
     } data;
     creq_ConfigType_t config_type;
@@ -181,16 +431,24 @@ typedef struct creq_HttpVersion
 
 /**
  * @brief Inner request struct for response generating.
+ * @attention Only handle it through the pointer returned by creq_Request_create(). The object may point into itself
+ *  (see header_inline), so copying it by value with memcpy() or struct assignment gives a corrupt object.
  * @see RFC7230 Section 3
  */
 typedef struct creq_Request
 {
     creq_Config_t config;
+    /// Bitwise OR of creq_ConfigOption_t values the object was created with.
+    unsigned options;
+    /// NULL unless created with CONF_OPT_ARENA.
+    creq_Arena_t *arena;
 
     // > request-line, Section 3.1.1
     creq_HttpMethod_t method;
     // space
     char *request_target;
+    /// Length of request_target in bytes.
+    size_t request_target_len;
     bool is_request_target_literal;
     // space
     creq_HttpVersion_t http_version;
@@ -198,24 +456,48 @@ typedef struct creq_Request
     // line ending
 
     // > header field
-    cvector_VECTOR(creq_HeaderField_t *) header_vector;
+    cvector_VECTOR(creq_HeaderField_t) header_vector;
     // line ending after each header
     // line ending again in the end
+    /// Storage backing header_vector until it outgrows it. Do not touch.
+    struct
+    {
+        size_t meta[2];
+        creq_HeaderField_t fields[CREQ_INLINE_HEADER_CAPACITY];
+    } header_inline;
+    /// NULL unless created with CONF_OPT_HEADER_INDEX and headers have been added.
+    creq_HeaderIndex_t *header_index;
+    /// Default headers emitted before header_vector, unless overridden by it. NULL if none is attached.
+    creq_HeaderProfile_t *header_profile;
 
     char *message_body;
+    /// Length of message_body in bytes. The body may contain NULs and is not always NUL-terminated.
+    size_t message_body_len;
     bool is_message_body_literal;
+    /// Set when message_body was taken over with OWN_TRANSFER and may lack room for a NUL. Do not touch.
+    bool is_message_body_transferred;
 
-    /// @todo for future verification apis, not used for now
+    /// Set when the object passes validation, cleared by every setter. Writing the fields directly does not clear it.
     bool is_verified;
+    /// NULL until creq_Request_stringify_cached() is first called. Do not touch.
+    creq_SerialCache_t *serial_cache;
+    /// NULL until creq_Request_reset() is first called on a heap-backed object. Do not touch.
+    creq_StringBin_t *string_bin;
 } creq_Request_t;
 
 /**
  * @brief Inner response struct for response generating.
+ * @attention Only handle it through the pointer returned by creq_Response_create(). The object may point into itself
+ *  (see header_inline), so copying it by value with memcpy() or struct assignment gives a corrupt object.
  * @see RFC7230 Section 3
  */
 typedef struct creq_Response
 {
     creq_Config_t config;
+    /// Bitwise OR of creq_ConfigOption_t values the object was created with.
+    unsigned options;
+    /// NULL unless created with CONF_OPT_ARENA.
+    creq_Arena_t *arena;
 
     // > status-line, Section 3.1.2
     creq_HttpVersion_t http_version;
@@ -223,21 +505,321 @@ typedef struct creq_Response
     int status_code;
     // space
     char *reason_phrase;
+    /// Length of reason_phrase in bytes.
+    size_t reason_phrase_len;
     bool is_reason_phrase_literal;
     // line ending
 
     // > header field
-    cvector_VECTOR(creq_HeaderField_t *) header_vector;
+    cvector_VECTOR(creq_HeaderField_t) header_vector;
     // line ending after each header
     // line ending again in the end
+    /// Storage backing header_vector until it outgrows it. Do not touch.
+    struct
+    {
+        size_t meta[2];
+        creq_HeaderField_t fields[CREQ_INLINE_HEADER_CAPACITY];
+    } header_inline;
+    /// NULL unless created with CONF_OPT_HEADER_INDEX and headers have been added.
+    creq_HeaderIndex_t *header_index;
+    /// Default headers emitted before header_vector, unless overridden by it. NULL if none is attached.
+    creq_HeaderProfile_t *header_profile;
 
     char *message_body;
+    /// Length of message_body in bytes. The body may contain NULs and is not always NUL-terminated.
+    size_t message_body_len;
     bool is_message_body_literal;
+    /// Set when message_body was taken over with OWN_TRANSFER and may lack room for a NUL. Do not touch.
+    bool is_message_body_transferred;
+    /// File range used as the body instead of message_body. fd is -1 unless creq_Response_set_body_file() is used.
+    struct
+    {
+        int fd;
+        uint64_t offset;
+        size_t len;
+    } body_file;
 
-    /// @todo for future verification apis, not used for now
+    /// Set when the object passes validation, cleared by every setter. Writing the fields directly does not clear it.
     bool is_verified;
+    /// NULL until creq_Response_stringify_cached() is first called. Do not touch.
+    creq_SerialCache_t *serial_cache;
+    /// NULL until creq_Response_reset() is first called on a heap-backed object. Do not touch.
+    creq_StringBin_t *string_bin;
+    /// Value of the Date header set by creq_Response_add_date_header(). Do not touch.
+    char date_buf[CREQ_HTTP_DATE_LEN + 1];
 } creq_Response_t;
 
+/**
+ * @brief Upper bound of the bytes a chunk adds to its data: the hexadecimal size and two line endings.
+ * @see creq_ChunkedEncoder_write_chunk()
+ */
+#define CREQ_CHUNK_MAX_OVERHEAD (2 * sizeof(size_t) + 4)
+
+/**
+ * @brief State of a chunked body being written, after the head of its response.
+ * @see creq_ChunkedEncoder_begin()
+ */
+typedef struct creq_ChunkedEncoder
+{
+    const char *line_ending;
+    size_t line_ending_len;
+    bool is_finished;
+    /// Whether the trailers are checked, set when the response has CONF_OPT_VALIDATE.
+    bool is_validating;
+} creq_ChunkedEncoder_t;
+
+#ifdef CREQ_POSIX_IO
+/**
+ * @brief State of a message being written to a non-blocking file descriptor. Initialize it with
+ * creq_Writer_init_request() or creq_Writer_init_response() for every message.
+ * @note The message is written piece by piece in serialization order: six start-line pieces, four pieces per header
+ * field (name, separator, value, line ending), the terminating empty line and the body, followed by the body file of
+ * a response. Empty pieces are skipped.
+ * @see creq_Writer_write()
+ */
+typedef struct creq_Writer
+{
+    /// The message being written. Exactly one of them is set.
+    creq_Request_t *request;
+    creq_Response_t *response;
+    /// Index of the piece to write next. The body file of a response is the piece after the last one.
+    size_t piece;
+    /// Bytes of that piece already written.
+    size_t piece_offset;
+    /// Bytes of the body file already written, counted from the start of its range.
+    size_t file_offset;
+    /// Bytes of the message written so far.
+    uint64_t written;
+    bool is_finished;
+} creq_Writer_t;
+#endif // CREQ_POSIX_IO
+
+/**
+ * @brief Parts of a message a template leaves variable.
+ * @see creq_TemplateSlot_t
+ */
+typedef enum creq_TemplateSlotKind_e
+{
+    /// The request target. Requests only.
+    TPL_SLOT_TARGET,
+    /// The value of the first occurrence of a header, which must be present when compiling.
+    TPL_SLOT_HEADER_VALUE,
+    /// The value of the Content-Length header, which must be present when compiling. It is generated from the body.
+    TPL_SLOT_CONTENT_LENGTH,
+    /// The message body.
+    TPL_SLOT_BODY
+} creq_TemplateSlotKind_t;
+
+/**
+ * @brief Marks a variable part of a message to compile into a template.
+ */
+typedef struct creq_TemplateSlot
+{
+    creq_TemplateSlotKind_t kind;
+    /// The header name for TPL_SLOT_HEADER_VALUE, NULL otherwise.
+    const char *header;
+} creq_TemplateSlot_t;
+
+/**
+ * @brief The value of a template slot. 'data' need not be NUL-terminated.
+ */
+typedef struct creq_TemplateValue
+{
+    const void *data;
+    size_t len;
+} creq_TemplateValue_t;
+
+/**
+ * @brief A message compiled into constant bytes and variable slots.
+ * @see creq_Template_compile_request()
+ * @see creq_Template_compile_response()
+ */
+typedef struct creq_Template creq_Template_t;
+
+/**
+ * @brief Default for creq_ParseLimits_t::max_header_count.
+ */
+#ifndef CREQ_PARSE_DEFAULT_MAX_HEADERS
+#define CREQ_PARSE_DEFAULT_MAX_HEADERS 100
+#endif
+
+/**
+ * @brief Default for creq_ParseLimits_t::max_line_len.
+ */
+#ifndef CREQ_PARSE_DEFAULT_MAX_LINE_LEN
+#define CREQ_PARSE_DEFAULT_MAX_LINE_LEN 8192
+#endif
+
+/**
+ * @brief Limits enforced while parsing. A zero field selects its default.
+ */
+typedef struct creq_ParseLimits
+{
+    /// Maximum number of header fields. Default CREQ_PARSE_DEFAULT_MAX_HEADERS.
+    size_t max_header_count;
+    /// Maximum length of the start line and of each header line, line ending included.
+    /// Default CREQ_PARSE_DEFAULT_MAX_LINE_LEN.
+    size_t max_line_len;
+} creq_ParseLimits_t;
+
+/**
+ * @brief Reasons for a parser to return CREQ_STATUS_FAILED.
+ */
+typedef enum creq_ParseError_e
+{
+    PARSE_ERR_NONE,
+    /// Bad argument given, e.g. a buffer shorter than what has already been consumed.
+    PARSE_ERR_ARGUMENT,
+    /// The input is not a well-formed message.
+    PARSE_ERR_SYNTAX,
+    /// A line is longer than creq_ParseLimits_t::max_line_len.
+    PARSE_ERR_LINE_TOO_LONG,
+    /// There are more than creq_ParseLimits_t::max_header_count header fields.
+    PARSE_ERR_TOO_MANY_HEADERS,
+    /// The message uses a feature the parser does not implement, such as a transfer coding.
+    PARSE_ERR_UNSUPPORTED,
+    /// Out of memory while storing headers.
+    PARSE_ERR_NO_MEMORY,
+    /// The body callback returned something other than CREQ_STATUS_SUCC.
+    PARSE_ERR_ABORTED,
+    /// The input ended before the message did.
+    PARSE_ERR_TRUNCATED
+} creq_ParseError_t;
+
+/**
+ * @brief Receives body bytes from a response parser as they arrive.
+ * @return CREQ_STATUS_SUCC to go on. Anything else stops the parser with PARSE_ERR_ABORTED.
+ * @see creq_Parser_init_response()
+ */
+typedef creq_status_t (*creq_BodySink_t)(void *user_data, const char *data, size_t len);
+
+/**
+ * @brief State of an incremental message parser. Initialize it with creq_Parser_init() for every message.
+ * @see creq_Request_parse()
+ */
+typedef struct creq_Parser
+{
+    creq_ParseLimits_t limits;
+    /// Why the last call failed. PARSE_ERR_NONE otherwise.
+    creq_ParseError_t error;
+    /// Bytes of the buffer consumed so far. Once the message is complete, its total length in the buffer.
+    size_t consumed;
+    /// Length of the head, start line to the empty line included. 0 until the head is complete.
+    size_t head_len;
+    /// Method of the request being answered, _METH_UNKNOWN if not known. Responses to HEAD have no body.
+    creq_HttpMethod_t request_method;
+    creq_BodySink_t on_body;
+    void *user_data;
+    /// Internal progress. Do not touch.
+    int state;
+    size_t scanned;
+    size_t header_count;
+    size_t first_header;
+    uint64_t body_len;
+    bool has_body_len;
+    bool has_transfer_coding;
+    bool is_chunked;
+    const char *base;
+} creq_Parser_t;
+
+/**
+ * @brief Routes all of creq's allocations through the given hooks.
+ * @param[in] allocator The hooks to use. They are copied. NULL restores malloc/realloc/free.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED One of the hooks is NULL. The current allocator is kept.
+ * @attention Not thread-safe. Call it once at start-up, before any object is created. Memory must always be freed by
+ * the allocator that allocated it.
+ */
+CREQ_PUBLIC(creq_status_t) creq_set_allocator(const creq_Allocator_t *allocator);
+
+/**
+ * @brief Allocates memory with the current creq allocator.
+ * @see creq_set_allocator()
+ */
+CREQ_PUBLIC(void *) creq_malloc(size_t size);
+
+/**
+ * @brief Reallocates memory with the current creq allocator.
+ * @see creq_set_allocator()
+ */
+CREQ_PUBLIC(void *) creq_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Frees memory with the current creq allocator. Strings returned by the *_stringify() functions must be freed
+ * with it.
+ * @see creq_set_allocator()
+ */
+CREQ_PUBLIC(void) creq_free(void *ptr);
+
+/**
+ * @brief Allocation counters, kept only when creq itself is compiled with CREQ_ENABLE_STATS defined.
+ * @note Blocks are not altered in any way, so the counters never change which function may free them. Byte counts
+ * are the sizes the C library reports for blocks of the default allocator (malloc_usable_size(), malloc_size() or
+ * _msize()), which may exceed the sizes asked for. They stay 0 with a custom allocator or on other platforms.
+ * @see creq_get_stats()
+ */
+typedef struct creq_Stats
+{
+    /// Blocks allocated by creq_malloc(), or by creq_realloc() given NULL.
+    uint64_t alloc_count;
+    /// Blocks resized by creq_realloc().
+    uint64_t realloc_count;
+    /// Blocks released by creq_free().
+    uint64_t free_count;
+    /// Bytes allocated and not released yet. Per thread, it drops below 0 when freeing another thread's memory. Blocks
+    /// that did not come from creq_malloc() but are released by creq_free() also lower it.
+    int64_t bytes_live;
+    /// Highest bytes_live seen since start-up or the last creq_reset_stats().
+    int64_t bytes_peak;
+} creq_Stats_t;
+
+/**
+ * @brief Reads the allocation counters of the whole process and of the calling thread.
+ * @param[out] global Receives the process-wide counters. May be NULL.
+ * @param[out] thread Receives the counters of allocations made and freed by the calling thread. May be NULL.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED creq was built without CREQ_ENABLE_STATS. Both outputs are zeroed.
+ * @note The global counters are updated with relaxed atomics, so they are only a consistent snapshot when no other
+ * thread is allocating.
+ */
+CREQ_PUBLIC(creq_status_t) creq_get_stats(creq_Stats_t *global, creq_Stats_t *thread);
+
+/**
+ * @brief Zeroes the counts of the process and of the calling thread, and lowers their bytes_peak to bytes_live.
+ */
+CREQ_PUBLIC(void) creq_reset_stats(void);
+
+/**
+ * @brief Caps the number of freed creq_HeaderField_t nodes each thread keeps for reuse.
+ * @param[in] max_cached The cap. 0, the default, disables pooling and releases nothing already pooled.
+ * @note Pooled nodes are handed out again by creq_HeaderField_create*(), bypassing the allocator. Headers added to
+ * requests/responses are stored in the objects themselves and do not use the pool.
+ * @see creq_HeaderField_pool_drain()
+ */
+CREQ_PUBLIC(void) creq_HeaderField_pool_set_limit(size_t max_cached);
+
+/**
+ * @brief Returns every node pooled by the calling thread to the allocator.
+ * @attention Call it before a thread that used the pool exits, or its pooled nodes leak.
+ */
+CREQ_PUBLIC(void) creq_HeaderField_pool_drain(void);
+
+/**
+ * @brief Gets the canonical name of a well-known header.
+ * @return The name, a string literal.
+ *  @retval NULL 'id' is not a well-known header ID.
+ */
+CREQ_PUBLIC(const char *) creq_get_header_name(creq_HeaderId_t id);
+
+/**
+ * @brief Gets the ID of a field name, compared case-insensitively.
+ * @return The ID.
+ *  @retval CREQ_HDR_UNKNOWN The name is not well-known or is NULL.
+ */
+CREQ_PUBLIC(creq_HeaderId_t) creq_get_header_id(const char *header);
+
 /**
  * @brief Creates a new header-value pair.
  * @return A pointer to the newly created node.
@@ -262,7 +844,7 @@ CREQ_PUBLIC(creq_HeaderField_t *) creq_HeaderField_create_literal(const char *he
  * @return Indicates if the procedure is finished properly.
  *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
  *  @retval CREQ_STATUS_FAILED Procedure fails.
- * @attention This procedure only frees the object, the data field and the strings.
+ * @attention This procedure only frees the object, the data field and the strings. '*ptrToFieldPtr' is set to NULL.
  * @attention For internal use only.
  * @see creq_HeaderField_t
  */
@@ -278,6 +860,17 @@ CREQ_PUBLIC(creq_status_t) creq_HeaderField_free(creq_HeaderField_t **ptrToField
  */
 CREQ_PUBLIC(creq_Request_t *) creq_Request_create(creq_Config_t *conf);
 
+/**
+ * @brief Creates a new creq_Request object with optional behaviours turned on.
+ * @param[in] conf The config, as for creq_Request_create(). May be NULL.
+ * @param[in] options Bitwise OR of creq_ConfigOption_t values. 0 gives the same object as creq_Request_create().
+ * @return A pointer to the newly created creq_Request object.
+ *  @retval NULL Fails to create a new object.
+ * @attention Always use creq_Request_free when done.
+ * @see creq_ConfigOption_t
+ */
+CREQ_PUBLIC(creq_Request_t *) creq_Request_create_with_options(creq_Config_t *conf, unsigned options);
+
 /**
  * @brief Frees a previously-created creq_Request object.
  * @return Indicates if the procedure is finished properly.
@@ -290,6 +883,34 @@ CREQ_PUBLIC(creq_Request_t *) creq_Request_create(creq_Config_t *conf);
  */
 CREQ_PUBLIC(creq_status_t) creq_Request_free(creq_Request_t *req);
 
+/**
+ * @brief Empties a creq_Request object for reuse, as if it had just been created with the same config.
+ * @param[in,out] req The request.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED 'req' is NULL or the string bin cannot be allocated. 'req' is left unchanged.
+ * @note The storage of the old contents is kept: the header vector keeps its capacity, the header index and the
+ * buffers of creq_Request_stringify_cached() stay allocated, owned strings are recycled for the strings copied next,
+ * and an arena is rewound rather than freed. A request rebuilt with similar contents after a reset therefore does not
+ * allocate. An attached header profile is released.
+ * @note At most a few hundred owned strings are kept for reuse; beyond that the smallest are freed.
+ * @see creq_Request_free()
+ */
+CREQ_PUBLIC(creq_status_t) creq_Request_reset(creq_Request_t *req);
+
+/**
+ * @brief Estimates the heap memory a request holds.
+ * @param[in] req The request.
+ * @return An estimate of the bytes creq requested from the allocator for 'req': the object itself, the header vector's
+ * capacity once it outgrows the inline storage, the header index, every string the object owns and the strings kept by
+ * creq_Request_reset(), or all blocks of its arena, plus the buffers of creq_Request_stringify_cached(). 0 if 'req' is
+ * NULL.
+ * @note Literals and borrowed buffers are not counted, nor is an attached header profile, which is shared. An
+ * OWN_TRANSFER buffer is counted by its length rather than its capacity, so the estimate may fall short of the real
+ * figure.
+ */
+CREQ_PUBLIC(size_t) creq_Request_memory_usage(const creq_Request_t *req);
+
 /**
  * @brief Set the creq_Request object's http method.
  * @return Indicates if the procedure is finished properly.
@@ -318,14 +939,35 @@ CREQ_PUBLIC(creq_HttpMethod_t) creq_Request_get_http_method(creq_Request_t *req)
  */
 CREQ_PUBLIC(creq_status_t) creq_Request_set_target(creq_Request_t *req, char *requestTarget, bool is_literal);
 
+/**
+ * @brief Set the creq_Request object's target to the first 'len' bytes of 'requestTarget'.
+ * @param[in] requestTarget The pointer to the new target, which need not be NUL-terminated. NULL will clear the
+ * target, in which case 'len' must be 0.
+ * @param[in] is_literal true if 'requestTarget' is stored as-is. It must then outlive its uses.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @see creq_Request_set_target()
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_target_n(creq_Request_t *req, const char *requestTarget, size_t len, bool is_literal);
+
 /**
  * @brief Get the creq_Request object's target
  * @return A pointer to the target string.
  *  @retval NULL No target specified or invalid argument given.
  * @attention The returned pointer points to the internal object. DO NOT MODIFY IT.
+ * @attention A target set by creq_Request_set_target_n() as a literal is not NUL-terminated. Use
+ * creq_Request_get_target_len().
  */
 CREQ_PUBLIC(char *) creq_Request_get_target(creq_Request_t *req);
 
+/**
+ * @brief Get the length in bytes of the creq_Request object's target.
+ * @return The length. 0 if no target is set or bad argument given.
+ */
+CREQ_PUBLIC(size_t) creq_Request_get_target_len(creq_Request_t *req);
+
 /**
  * @brief Set the creq_Request object's http version.
  * @return Indicates if the procedure is finished properly.
@@ -351,11 +993,57 @@ CREQ_PUBLIC(creq_HttpVersion_t) creq_Request_get_http_version(creq_Request_t *re
  */
 CREQ_PUBLIC(creq_status_t) creq_Request_add_header(creq_Request_t *req, char *header, char *value, bool is_literal);
 
+/**
+ * @brief Like creq_Request_add_header(), with explicit lengths. Neither 'header' nor 'value' need be NUL-terminated.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Request_add_header_n(creq_Request_t *req, const char *header, size_t header_len, const char *value,
+                          size_t value_len, bool is_literal);
+
+/**
+ * @brief Sets a header of the creq_Request object: the value of its first occurrence is replaced in place and any
+ * further occurrences are removed. The header is appended if it is not present.
+ * @param[in] is_literal true if 'header' and 'value' are string literals.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @see creq_Request_add_header()
+ */
+CREQ_PUBLIC(creq_status_t) creq_Request_set_header(creq_Request_t *req, char *header, char *value, bool is_literal);
+
+/**
+ * @brief Like creq_Request_set_header(), with explicit lengths. Neither 'header' nor 'value' need be NUL-terminated.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_header_n(creq_Request_t *req, const char *header, size_t header_len, const char *value,
+                          size_t value_len, bool is_literal);
+
+/**
+ * @brief Adds a new well-known header to the tail of the headers list of the creq_Request object.
+ * @param[in] is_literal true if 'value' is a string literal.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @note The name is never copied and is emitted from a precomputed "Name: " run.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Request_add_header_id(creq_Request_t *req, creq_HeaderId_t id, char *value, bool is_literal);
+
 /**
  * @brief Searches for a header-value pair in the headers list of the creq_Request object which contains the given header.
+ * @note Field names are compared case-insensitively.
  * @return A pointer to the header found.
  *  @retval NULL Header not found.
  * @attention Always return the first one when there are multiple occurrences.
+ * @attention The returned pointer points into the object's header storage. Adding or removing headers invalidates it.
+ * @note Only the object's own headers are searched, as the returned pointer may be written through. Use
+ * creq_Request_lookup_header() to see the header profile as well.
+ * @see creq_Request_lookup_header()
  */
 CREQ_PUBLIC(creq_HeaderField_t *) creq_Request_search_for_header(creq_Request_t *req, char *header);
 
@@ -367,6 +1055,50 @@ CREQ_PUBLIC(creq_HeaderField_t *) creq_Request_search_for_header(creq_Request_t
  */
 CREQ_PUBLIC(int) creq_Request_search_for_header_index(creq_Request_t *req, char *header);
 
+/**
+ * @brief Searches for a well-known header in the headers list of the creq_Request object.
+ * @return A pointer to the header found.
+ *  @retval NULL Header not found.
+ * @attention Always return the first one when there are multiple occurrences.
+ * @attention The returned pointer points into the object's header storage. Adding or removing headers invalidates it.
+ * @note Only the object's own headers are searched, like creq_Request_search_for_header().
+ */
+CREQ_PUBLIC(creq_HeaderField_t *) creq_Request_search_for_header_id(creq_Request_t *req, creq_HeaderId_t id);
+
+/**
+ * @brief Looks a header up in the creq_Request object, then in its header profile, without changing either.
+ * @note Field names are compared case-insensitively. A header of the object hides the profile's.
+ * @return A read-only pointer to the first occurrence, which may belong to the shared profile.
+ *  @retval NULL Header not found or bad argument given.
+ * @attention Changing the object's headers or its profile invalidates the pointer.
+ * @see creq_Request_set_header_profile()
+ */
+CREQ_PUBLIC(const creq_HeaderField_t *) creq_Request_lookup_header(const creq_Request_t *req, const char *header);
+
+/**
+ * @brief Looks a well-known header up like creq_Request_lookup_header().
+ */
+CREQ_PUBLIC(const creq_HeaderField_t *) creq_Request_lookup_header_id(const creq_Request_t *req, creq_HeaderId_t id);
+
+/**
+ * @brief Starts iterating over every occurrence of the given header in the creq_Request object.
+ * @param[out] iter The iterator to initialize.
+ * @param[in] header The field name to look for, compared case-insensitively. It must outlive the iteration.
+ * @return A pointer to the first occurrence.
+ *  @retval NULL Header not found.
+ * @attention Adding or removing headers during the iteration invalidates it.
+ * @note Only the object's own headers are visited, like creq_Request_search_for_header().
+ * @see creq_Request_header_iter_next()
+ */
+CREQ_PUBLIC(creq_HeaderField_t *) creq_Request_header_iter_begin(creq_Request_t *req, creq_HeaderIter_t *iter, char *header);
+
+/**
+ * @brief Advances an iterator started by creq_Request_header_iter_begin().
+ * @return A pointer to the next occurrence.
+ *  @retval NULL No more occurrences.
+ */
+CREQ_PUBLIC(creq_HeaderField_t *) creq_Request_header_iter_next(creq_Request_t *req, creq_HeaderIter_t *iter);
+
 /**
  * @brief Moves the header with the given header name out of the creq_Request object's headers list and frees it.
  * @return Indicates if the procedure is finished properly.
@@ -408,25 +1140,161 @@ CREQ_PUBLIC(creq_status_t) creq_Request_set_message_body(creq_Request_t *req, ch
  *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
  *  @retval CREQ_STATUS_FAILED Procedure fails.
  * @see creq_Request_set_message_body()
+ * @see creq_Request_update_content_len()
  */
 CREQ_PUBLIC(creq_status_t) creq_Request_set_message_body_content_len(creq_Request_t *req, char *msg, bool is_literal);
 
+/**
+ * @brief Set the creq_Request object's message body to 'len' bytes of possibly binary data.
+ * @param[in] ptr The pointer to the new body. NULL will clear the body, in which case 'len' must be 0.
+ * @param[in] ownership Whether the body is copied, borrowed or taken over.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @note Exactly 'len' bytes are serialized. The body is never scanned for a terminator.
+ * @note With CONF_OPT_ARENA, a transferred buffer is copied into the arena and freed at once.
+ * @see creq_Request_update_content_len()
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_message_body_bytes(creq_Request_t *req, const void *ptr, size_t len, creq_Ownership_t ownership);
+
+/**
+ * @brief Set the Content-Length header of the creq_Request object to the length of its current message body.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @note An existing Content-Length header is updated in place and keeps its position, and any later duplicates are
+ * removed. Only a message without one gets it appended after its other headers. Earlier versions always removed the
+ * header and appended a new one, moving it to the end.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Request_update_content_len(creq_Request_t *req);
+
 /**
  * @brief Get the creq_Request object's message body.
  * @return The pointer to the message body string.
  *  @retval NULL Message body not set or bad argument given.
  * @attention The returned pointer points to the internal object. DO NOT MODIFY IT.
+ * @attention A body given to creq_Request_set_message_body_bytes() with OWN_BORROW or OWN_TRANSFER is the caller's
+ *  buffer as-is and need not be NUL-terminated, and any binary body may contain NUL bytes. Use
+ *  creq_Request_get_message_body_len() for its length rather than strlen().
  */
 CREQ_PUBLIC(char *) creq_Request_get_message_body(creq_Request_t *req);
 
+/**
+ * @brief Get the length in bytes of the creq_Request object's message body.
+ * @return The length. 0 if no body is set or bad argument given.
+ */
+CREQ_PUBLIC(size_t) creq_Request_get_message_body_len(creq_Request_t *req);
+
+/**
+ * @brief Attaches a header profile to the creq_Request object as its default headers.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Bad argument given.
+ * @note The profile is retained, not copied, and the previous one is released. NULL detaches the current profile.
+ * @note Profile headers are emitted before the object's own headers. A header of the object hides every profile header
+ * with the same name. Searching, iterating and index-based functions only see the object's headers, while
+ * creq_Request_lookup_header() sees both. To change a profile header for this object alone, set it on the object.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Request_set_header_profile(creq_Request_t *req, creq_HeaderProfile_t *profile);
+
+/**
+ * @brief Checks the method, target, HTTP version and headers of the creq_Request object against RFC 7230.
+ * @return Indicates if the object is valid.
+ *  @retval CREQ_STATUS_SUCC The object is valid. is_verified is set and later calls return at once until it changes.
+ *  @retval CREQ_STATUS_FAILED The object is invalid, e.g. a header value holds CR or LF, or bad argument given.
+ * @note Field names must be tokens and field values and reason phrases must not hold control characters but HTAB.
+ * The message body is not checked.
+ * @see CONF_OPT_VALIDATE
+ */
+CREQ_PUBLIC(creq_status_t) creq_Request_validate(creq_Request_t *req);
+
 /**
  * @brief Create the full request text using the given creq_Request object.
  * @return A pointer to the newly created request string.
- *  @retval NULL Some of the fields unset or invalid.
- * @attention This procedure will return a NEWLY MALLOC'ED string. Creq will not store it. It's the caller's responsibility to deal with it and free it.
+ *  @retval NULL Some of the fields unset or invalid, or the object fails CONF_OPT_VALIDATE.
+ * @attention This procedure will return a NEWLY MALLOC'ED string. Creq will not store it. It's the caller's responsibility to deal with it and free it with creq_free().
+ * @note A binary body may contain NULs. Use creq_Request_stringify_into() when the exact length is needed.
  */
 CREQ_PUBLIC(char *) creq_Request_stringify(creq_Request_t *req);
 
+/**
+ * @brief Writes the full request text into a caller-owned buffer.
+ * @param[out] buf The destination buffer. May be NULL when only the size is wanted.
+ * @param[in] cap The capacity of 'buf' in bytes.
+ * @param[out] needed If not NULL, receives the exact number of bytes the request takes. Always set.
+ * @return The number of bytes written.
+ *  @retval 0 'buf' is NULL, 'cap' is too small, 'req' is NULL or fails CONF_OPT_VALIDATE. Nothing is written in this
+ *  case.
+ * @attention The output is NOT NUL-terminated. It is byte-identical to what creq_Request_stringify() returns.
+ * @see creq_Request_stringify()
+ */
+CREQ_PUBLIC(size_t) creq_Request_stringify_into(creq_Request_t *req, char *buf, size_t cap, size_t *needed);
+
+/**
+ * @brief Create the full request text in a buffer kept by the creq_Request object, for objects sent many times.
+ * @param[out] len Receives the length of the text. May be NULL.
+ * @return The text, NUL-terminated and owned by the object. It stays valid until the next call or until the object
+ * is freed.
+ *  @retval NULL Some of the fields unset or invalid, the object fails CONF_OPT_VALIDATE, or allocation fails.
+ * @note The setters record which parts of the object they change. An unchanged object gets its previous text back
+ * as-is; otherwise the start line and header lines that did not change are copied from the previous text instead of
+ * being formatted again.
+ * @attention Changes made by writing the fields directly, or to borrowed buffers, are not noticed.
+ */
+CREQ_PUBLIC(const char *) creq_Request_stringify_cached(creq_Request_t *req, size_t *len);
+
+/**
+ * @brief Describes the full request text as an I/O vector without copying any field.
+ * @param[out] iov The destination array. May be NULL when only the count is wanted.
+ * @param[in] iov_cap The number of entries 'iov' can hold.
+ * @param[out] scratch Storage for the generated parts of the request line.
+ * @param[out] needed If not NULL, receives the exact number of entries the request takes. Always set.
+ * @return The number of entries filled.
+ *  @retval 0 'iov' or 'scratch' is NULL, 'iov_cap' is too small, 'req' is NULL or fails CONF_OPT_VALIDATE, or the
+ *  request takes more than CREQ_IOV_MAX entries.
+ * @attention The entries point into 'req', its strings and 'scratch'. Do not modify or free any of them before the
+ * vector is written out.
+ * @note Concatenating the entries gives exactly what creq_Request_stringify() returns.
+ */
+CREQ_PUBLIC(size_t)
+creq_Request_to_iovec(creq_Request_t *req, creq_IoVec_t *iov, size_t iov_cap, creq_IoVecScratch_t *scratch,
+                      size_t *needed);
+
+/**
+ * @brief Writes several requests back to back into one caller-owned buffer, e.g. for an HTTP/1.1 pipeline.
+ * @param[in] reqs The requests, in the order they are to be sent.
+ * @param[in] count The number of requests.
+ * @param[out] buf The destination buffer. May be NULL when only the sizes are wanted.
+ * @param[in] cap The capacity of 'buf' in bytes.
+ * @param[out] offsets If not NULL, an array of 'count' + 1 entries receiving where each request starts, then the total
+ * length. Filled whenever the sizes can be computed, even if nothing is written.
+ * @param[out] needed If not NULL, receives the total number of bytes. Always set.
+ * @return The number of bytes written.
+ *  @retval 0 'buf' is NULL, 'cap' is too small, a request is NULL or fails CONF_OPT_VALIDATE, or 'count' is 0.
+ *  Nothing is written in this case.
+ * @attention The output is NOT NUL-terminated. Request i spans [offsets[i], offsets[i + 1]).
+ * @see creq_Request_stringify_into()
+ */
+CREQ_PUBLIC(size_t)
+creq_Request_stringify_batch(creq_Request_t *const *reqs, size_t count, char *buf, size_t cap, size_t *offsets,
+                             size_t *needed);
+
+/**
+ * @brief Describes several requests back to back as one I/O vector, e.g. for a single writev() of a pipeline.
+ * @param[out] scratches An array of 'count' scratch areas, one per request.
+ * @param[out] offsets If not NULL, an array of 'count' + 1 entries receiving the index of the first entry of each
+ * request, then the total number of entries.
+ * @param[out] needed If not NULL, receives the total number of entries. Always set.
+ * @return The number of entries filled.
+ *  @retval 0 'iov' or 'scratches' is NULL, 'iov_cap' is too small, a request is NULL or fails CONF_OPT_VALIDATE,
+ *  'count' is 0, or the batch takes more than CREQ_IOV_MAX entries.
+ * @see creq_Request_to_iovec()
+ */
+CREQ_PUBLIC(size_t)
+creq_Request_to_iovec_batch(creq_Request_t *const *reqs, size_t count, creq_IoVec_t *iov, size_t iov_cap,
+                            creq_IoVecScratch_t *scratches, size_t *offsets, size_t *needed);
+
 /**
  * @brief Creates a new creq_Response object.
  * @return A pointer to the newly created creq_Response object.
@@ -437,6 +1305,17 @@ CREQ_PUBLIC(char *) creq_Request_stringify(creq_Request_t *req);
  */
 CREQ_PUBLIC(creq_Response_t *) creq_Response_create(creq_Config_t *conf);
 
+/**
+ * @brief Creates a new creq_Response object with optional behaviours turned on.
+ * @param[in] conf The config, as for creq_Response_create(). May be NULL.
+ * @param[in] options Bitwise OR of creq_ConfigOption_t values. 0 gives the same object as creq_Response_create().
+ * @return A pointer to the newly created creq_Response object.
+ *  @retval NULL Fails to create a new object.
+ * @attention Always use creq_Response_free when done.
+ * @see creq_ConfigOption_t
+ */
+CREQ_PUBLIC(creq_Response_t *) creq_Response_create_with_options(creq_Config_t *conf, unsigned options);
+
 /**
  * @brief Frees a previously-created creq_Response object.
  * @return Indicates if the procedure is finished properly.
@@ -448,6 +1327,34 @@ CREQ_PUBLIC(creq_Response_t *) creq_Response_create(creq_Config_t *conf);
  */
 CREQ_PUBLIC(creq_status_t) creq_Response_free(creq_Response_t *resp);
 
+/**
+ * @brief Empties a creq_Response object for reuse, as if it had just been created with the same config.
+ * @param[in,out] resp The response.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED 'resp' is NULL or the string bin cannot be allocated. 'resp' is left unchanged.
+ * @note The storage of the old contents is kept: the header vector keeps its capacity, the header index and the
+ * buffers of creq_Response_stringify_cached() stay allocated, owned strings are recycled for the strings copied next,
+ * and an arena is rewound rather than freed. A response rebuilt with similar contents after a reset therefore does
+ * not allocate. An attached header profile is released and a body file is detached, not closed.
+ * @note At most a few hundred owned strings are kept for reuse; beyond that the smallest are freed.
+ * @see creq_Response_free()
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_reset(creq_Response_t *resp);
+
+/**
+ * @brief Estimates the heap memory a response holds.
+ * @param[in] resp The response.
+ * @return An estimate of the bytes creq requested from the allocator for 'resp': the object itself, the header vector's
+ * capacity once it outgrows the inline storage, the header index, every string the object owns and the strings kept by
+ * creq_Response_reset(), or all blocks of its arena, plus the buffers of creq_Response_stringify_cached(). 0 if 'resp'
+ * is NULL.
+ * @note Literals, borrowed buffers and body files are not counted, nor is an attached header profile, which is shared.
+ * An OWN_TRANSFER buffer is counted by its length rather than its capacity, so the estimate may fall short of the real
+ * figure.
+ */
+CREQ_PUBLIC(size_t) creq_Response_memory_usage(const creq_Response_t *resp);
+
 /**
  * @brief Set the creq_Response object's http version.
  * @return Indicates if the procedure is finished properly.
@@ -472,6 +1379,17 @@ CREQ_PUBLIC(creq_HttpVersion_t) creq_Response_get_http_version(creq_Response_t *
  */
 CREQ_PUBLIC(creq_status_t) creq_Response_set_status_code(creq_Response_t *resp, int status);
 
+/**
+ * @brief Set the creq_Response object's status code and its standard reason phrase, e.g. "Not Found" for 404.
+ * @param[in] status A status code registered with IANA.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED 'status' is not registered, or bad argument given. The object is left unchanged.
+ * @note The phrase is stored as a literal, nothing is copied. An HTTP/1.0 or HTTP/1.1 response whose reason phrase
+ * is the standard one gets its whole status line from a static table when serialized.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_set_status(creq_Response_t *resp, int status);
+
 /**
  * @brief Set the creq_Response object's reason phrase to a given value.
  * @return Indicates if the procedure is finished properly.
@@ -492,6 +1410,26 @@ CREQ_PUBLIC(creq_status_t) creq_Response_set_reason_phrase(creq_Response_t *resp
  */
 CREQ_PUBLIC(creq_status_t) creq_Response_set_reason_phrase_literal(creq_Response_t *resp, const char *reason_s);
 
+/**
+ * @brief Set the creq_Response object's reason phrase to a copy of the first 'len' bytes of 'reason'.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @see creq_Response_set_reason_phrase()
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_set_reason_phrase_n(creq_Response_t *resp, const char *reason, size_t len);
+
+/**
+ * @brief Set the creq_Response object's reason phrase to the first 'len' bytes of 'reason_s', stored as-is.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @attention 'reason_s' need not be NUL-terminated, but must outlive its uses.
+ * @see creq_Response_set_reason_phrase_literal()
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_reason_phrase_literal_n(creq_Response_t *resp, const char *reason_s, size_t len);
+
 /**
  * @brief Get the creq_Response object's status code.
  * @return The previously set status code or 0.
@@ -506,6 +1444,12 @@ CREQ_PUBLIC(int) creq_Response_get_status_code(creq_Response_t *resp);
  */
 CREQ_PUBLIC(char *) creq_Response_get_reason_phrase(creq_Response_t *resp);
 
+/**
+ * @brief Get the length in bytes of the creq_Response object's reason phrase.
+ * @return The length. 0 if no reason phrase is set or bad argument given.
+ */
+CREQ_PUBLIC(size_t) creq_Response_get_reason_phrase_len(creq_Response_t *resp);
+
 /**
  * @brief Adds a new item to the tail of the headers list of the creq_Response object.
  * @return Indicates if the procedure is finished properly.
@@ -514,6 +1458,16 @@ CREQ_PUBLIC(char *) creq_Response_get_reason_phrase(creq_Response_t *resp);
  */
 CREQ_PUBLIC(creq_status_t) creq_Response_add_header(creq_Response_t *resp, char *header, char *value);
 
+/**
+ * @brief Like creq_Response_add_header(), with explicit lengths. Neither 'header' nor 'value' need be NUL-terminated.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header_n(creq_Response_t *resp, const char *header, size_t header_len, const char *value,
+                           size_t value_len);
+
 /**
  * @brief Adds a new item with literal header and value to the tail of the headers list of the creq_Response object.
  * @return Indicates if the procedure is finished properly.
@@ -523,11 +1477,86 @@ CREQ_PUBLIC(creq_status_t) creq_Response_add_header(creq_Response_t *resp, char
  */
 CREQ_PUBLIC(creq_status_t) creq_Response_add_header_literal(creq_Response_t *resp, const char *header_s, const char *value_s);
 
+/**
+ * @brief Like creq_Response_add_header_literal(), with explicit lengths. Neither 'header_s' nor 'value_s' need be
+ * NUL-terminated.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header_literal_n(creq_Response_t *resp, const char *header_s, size_t header_len, const char *value_s,
+                                   size_t value_len);
+
+/**
+ * @brief Sets a header of the creq_Response object: the value of its first occurrence is replaced in place and any
+ * further occurrences are removed. The header is appended if it is not present.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @attention This procedure stores a copy of the given strings.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_set_header(creq_Response_t *resp, char *header, char *value);
+
+/**
+ * @brief Like creq_Response_set_header(), with explicit lengths. Neither 'header' nor 'value' need be NUL-terminated.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_header_n(creq_Response_t *resp, const char *header, size_t header_len, const char *value,
+                           size_t value_len);
+
+/**
+ * @brief Adds a new well-known header to the tail of the headers list of the creq_Response object.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @attention This procedure stores a copy of the given value.
+ * @note The name is never copied and is emitted from a precomputed "Name: " run.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_add_header_id(creq_Response_t *resp, creq_HeaderId_t id, char *value);
+
+/**
+ * @brief Adds a new well-known header with a literal value to the tail of the headers list of the creq_Response object.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @attention This function works with literal values. If non-literals are given, the result is undefined.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_add_header_id_literal(creq_Response_t *resp, creq_HeaderId_t id, const char *value_s);
+
+/**
+ * @brief Sets a header of the creq_Response object to a literal value, like creq_Response_set_header() does.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @attention This function works with literal header and values. If non-literals are given, the result is undefined.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_set_header_literal(creq_Response_t *resp, const char *header_s, const char *value_s);
+
+/**
+ * @brief Like creq_Response_set_header_literal(), with explicit lengths. Neither 'header_s' nor 'value_s' need be
+ * NUL-terminated.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_header_literal_n(creq_Response_t *resp, const char *header_s, size_t header_len, const char *value_s,
+                                   size_t value_len);
+
 /**
  * @brief Searches for a header-value pair in the headers list of the creq_Response object which contains the given header.
+ * @note Field names are compared case-insensitively.
  * @return A pointer to the header found.
  *  @retval NULL Header not found.
  * @attention Always return the first one when there are multiple occurrences.
+ * @attention The returned pointer points into the object's header storage. Adding or removing headers invalidates it.
+ * @note Only the object's own headers are searched, as the returned pointer may be written through. Use
+ * creq_Response_lookup_header() to see the header profile as well.
+ * @see creq_Response_lookup_header()
  */
 CREQ_PUBLIC(creq_HeaderField_t *) creq_Response_search_for_header(creq_Response_t *resp, char *header);
 
@@ -539,6 +1568,51 @@ CREQ_PUBLIC(creq_HeaderField_t *) creq_Response_search_for_header(creq_Response_
  */
 CREQ_PUBLIC(int) creq_Response_search_for_header_index(creq_Response_t *resp, char *header);
 
+/**
+ * @brief Searches for a well-known header in the headers list of the creq_Response object.
+ * @return A pointer to the header found.
+ *  @retval NULL Header not found.
+ * @attention Always return the first one when there are multiple occurrences.
+ * @attention The returned pointer points into the object's header storage. Adding or removing headers invalidates it.
+ * @note Only the object's own headers are searched, like creq_Response_search_for_header().
+ */
+CREQ_PUBLIC(creq_HeaderField_t *) creq_Response_search_for_header_id(creq_Response_t *resp, creq_HeaderId_t id);
+
+/**
+ * @brief Looks a header up in the creq_Response object, then in its header profile, without changing either.
+ * @note Field names are compared case-insensitively. A header of the object hides the profile's.
+ * @return A read-only pointer to the first occurrence, which may belong to the shared profile.
+ *  @retval NULL Header not found or bad argument given.
+ * @attention Changing the object's headers or its profile invalidates the pointer.
+ * @see creq_Response_set_header_profile()
+ */
+CREQ_PUBLIC(const creq_HeaderField_t *) creq_Response_lookup_header(const creq_Response_t *resp, const char *header);
+
+/**
+ * @brief Looks a well-known header up like creq_Response_lookup_header().
+ */
+CREQ_PUBLIC(const creq_HeaderField_t *) creq_Response_lookup_header_id(const creq_Response_t *resp, creq_HeaderId_t id);
+
+/**
+ * @brief Starts iterating over every occurrence of the given header in the creq_Response object.
+ * @param[out] iter The iterator to initialize.
+ * @param[in] header The field name to look for, compared case-insensitively. It must outlive the iteration.
+ * @return A pointer to the first occurrence.
+ *  @retval NULL Header not found.
+ * @attention Adding or removing headers during the iteration invalidates it.
+ * @note Only the object's own headers are visited, like creq_Response_search_for_header().
+ * @see creq_Response_header_iter_next()
+ */
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Response_header_iter_begin(creq_Response_t *resp, creq_HeaderIter_t *iter, char *header);
+
+/**
+ * @brief Advances an iterator started by creq_Response_header_iter_begin().
+ * @return A pointer to the next occurrence.
+ *  @retval NULL No more occurrences.
+ */
+CREQ_PUBLIC(creq_HeaderField_t *) creq_Response_header_iter_next(creq_Response_t *resp, creq_HeaderIter_t *iter);
+
 /**
  * @brief Moves the header with the given header name out of the creq_Response object's headers list and frees it.
  * @return Indicates if the procedure is finished properly.
@@ -587,6 +1661,7 @@ CREQ_PUBLIC(creq_status_t) creq_Response_set_message_body_literal(creq_Response_
  *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
  *  @retval CREQ_STATUS_FAILED Procedure fails.
  * @see creq_Response_set_message_body()
+ * @see creq_Response_update_content_len()
  */
 CREQ_PUBLIC(creq_status_t) creq_Response_set_message_body_content_len(creq_Response_t *resp, char *msg);
 
@@ -597,6 +1672,7 @@ CREQ_PUBLIC(creq_status_t) creq_Response_set_message_body_content_len(creq_Respo
  *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
  *  @retval CREQ_STATUS_FAILED Procedure fails.
  * @see creq_Response_set_message_body_literal()
+ * @see creq_Response_update_content_len()
  */
 CREQ_PUBLIC(creq_status_t)
 creq_Response_set_message_body_literal_content_len(creq_Response_t *resp, const char *msg_s);
@@ -606,17 +1682,408 @@ creq_Response_set_message_body_literal_content_len(creq_Response_t *resp, const
  * @return The pointer to the message body string.
  *  @retval NULL Message body not set or bad argument given.
  * @attention The returned pointer points to the internal object. DO NOT MODIFY IT.
+ * @attention A body given to creq_Response_set_message_body_bytes() with OWN_BORROW or OWN_TRANSFER is the caller's
+ *  buffer as-is and need not be NUL-terminated, and any binary body may contain NUL bytes. Use
+ *  creq_Response_get_message_body_len() for its length rather than strlen().
  */
 CREQ_PUBLIC(char *) creq_Response_get_message_body(creq_Response_t *resp);
 
+/**
+ * @brief Get the length in bytes of the creq_Response object's message body.
+ * @return The length. 0 if no body is set or bad argument given.
+ */
+CREQ_PUBLIC(size_t) creq_Response_get_message_body_len(creq_Response_t *resp);
+
+/**
+ * @brief Attaches a header profile to the creq_Response object as its default headers.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Bad argument given.
+ * @note The profile is retained, not copied, and the previous one is released. NULL detaches the current profile.
+ * @note Profile headers are emitted before the object's own headers. A header of the object hides every profile header
+ * with the same name. Searching, iterating and index-based functions only see the object's headers, while
+ * creq_Response_lookup_header() sees both. To change a profile header for this object alone, set it on the object.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_set_header_profile(creq_Response_t *resp, creq_HeaderProfile_t *profile);
+
+/**
+ * @brief Checks the status code, HTTP version, reason phrase and headers of the creq_Response object against RFC 7230.
+ * @return Indicates if the object is valid.
+ *  @retval CREQ_STATUS_SUCC The object is valid. is_verified is set and later calls return at once until it changes.
+ *  @retval CREQ_STATUS_FAILED The object is invalid, e.g. a header value holds CR or LF, or bad argument given.
+ * @note Field names must be tokens and field values and reason phrases must not hold control characters but HTAB.
+ * The message body is not checked.
+ * @see CONF_OPT_VALIDATE
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_validate(creq_Response_t *resp);
+
+/**
+ * @brief Set the creq_Response object's message body to 'len' bytes of possibly binary data.
+ * @param[in] ptr The pointer to the new body. NULL will clear the body, in which case 'len' must be 0.
+ * @param[in] ownership Whether the body is copied, borrowed or taken over.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @note Exactly 'len' bytes are serialized. The body is never scanned for a terminator.
+ * @note With CONF_OPT_ARENA, a transferred buffer is copied into the arena and freed at once.
+ * @see creq_Response_update_content_len()
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_message_body_bytes(creq_Response_t *resp, const void *ptr, size_t len, creq_Ownership_t ownership);
+
+/**
+ * @brief Set the Content-Length header of the creq_Response object to the length of its current message body.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @note An existing Content-Length header is updated in place and keeps its position, and any later duplicates are
+ * removed. Only a message without one gets it appended after its other headers. Earlier versions always removed the
+ * header and appended a new one, moving it to the end.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_update_content_len(creq_Response_t *resp);
+
+/**
+ * @brief Set the Date header of the creq_Response object to the current time, as an IMF-fixdate.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @note The date is formatted at most once per second for the whole process and read without locking. It is copied
+ * into the object and stored as a literal, so nothing is allocated for it. Any previous Date header is replaced.
+ * @see RFC 7231 Section 7.1.1.2
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_add_date_header(creq_Response_t *resp);
+
+/**
+ * @brief Use a range of an open file as the creq_Response object's message body and update the Content-Length header.
+ * @param[in] fd The file descriptor. It is neither duplicated nor closed, and must stay open until the response is
+ * sent.
+ * @param[in] offset The offset of the range in the file.
+ * @param[in] len The length of the range in bytes.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Procedure fails.
+ * @attention The file is only read by creq_Response_send(). The stringify and I/O vector functions produce the head
+ * only. Setting a message body drops the file.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_set_body_file(creq_Response_t *resp, int fd, uint64_t offset, size_t len);
+
 /**
  * @brief Create the full request text using the given creq_Response object.
  * @return A pointer to the newly created request string.
- *  @retval NULL Some of the fields unset or invalid.
- * @attention This procedure will return a NEWLY MALLOC'ED string. Creq will not store it. It's the caller's responsibility to deal with it and free it.
+ *  @retval NULL Some of the fields unset or invalid, or the object fails CONF_OPT_VALIDATE.
+ * @attention This procedure will return a NEWLY MALLOC'ED string. Creq will not store it. It's the caller's responsibility to deal with it and free it with creq_free().
+ * @note A binary body may contain NULs. Use creq_Response_stringify_into() when the exact length is needed.
  */
 CREQ_PUBLIC(char *) creq_Response_stringify(creq_Response_t *resp);
 
+/**
+ * @brief Writes the full response text into a caller-owned buffer.
+ * @param[out] buf The destination buffer. May be NULL when only the size is wanted.
+ * @param[in] cap The capacity of 'buf' in bytes.
+ * @param[out] needed If not NULL, receives the exact number of bytes the response takes. Always set.
+ * @return The number of bytes written.
+ *  @retval 0 'buf' is NULL, 'cap' is too small, 'resp' is NULL or fails CONF_OPT_VALIDATE. Nothing is written in this
+ *  case.
+ * @attention The output is NOT NUL-terminated. It is byte-identical to what creq_Response_stringify() returns.
+ * @see creq_Response_stringify()
+ */
+CREQ_PUBLIC(size_t) creq_Response_stringify_into(creq_Response_t *resp, char *buf, size_t cap, size_t *needed);
+
+/**
+ * @brief Create the full response text in a buffer kept by the creq_Response object, for objects sent many times.
+ * @param[out] len Receives the length of the text. May be NULL.
+ * @return The text, NUL-terminated and owned by the object. It stays valid until the next call or until the object
+ * is freed.
+ *  @retval NULL Some of the fields unset or invalid, the object fails CONF_OPT_VALIDATE, or allocation fails.
+ * @note The setters record which parts of the object they change. An unchanged object gets its previous text back
+ * as-is; otherwise the start line and header lines that did not change are copied from the previous text instead of
+ * being formatted again.
+ * @attention Changes made by writing the fields directly, or to borrowed buffers, are not noticed.
+ */
+CREQ_PUBLIC(const char *) creq_Response_stringify_cached(creq_Response_t *resp, size_t *len);
+
+/**
+ * @brief Describes the full response text as an I/O vector without copying any field.
+ * @param[out] iov The destination array. May be NULL when only the count is wanted.
+ * @param[in] iov_cap The number of entries 'iov' can hold.
+ * @param[out] scratch Storage for the generated parts of the status line.
+ * @param[out] needed If not NULL, receives the exact number of entries the response takes. Always set.
+ * @return The number of entries filled.
+ *  @retval 0 'iov' or 'scratch' is NULL, 'iov_cap' is too small, 'resp' is NULL or fails CONF_OPT_VALIDATE, or the
+ *  response takes more than CREQ_IOV_MAX entries.
+ * @attention The entries point into 'resp', its strings and 'scratch'. Do not modify or free any of them before the
+ * vector is written out.
+ * @note Concatenating the entries gives exactly what creq_Response_stringify() returns.
+ */
+CREQ_PUBLIC(size_t)
+creq_Response_to_iovec(creq_Response_t *resp, creq_IoVec_t *iov, size_t iov_cap, creq_IoVecScratch_t *scratch,
+                       size_t *needed);
+
+/**
+ * @brief Produces data for creq_ChunkedEncoder_pull_chunk().
+ * @param[in] user_data The pointer given to creq_ChunkedEncoder_pull_chunk().
+ * @param[out] buf Where to write the data.
+ * @param[in] cap The capacity of 'buf' in bytes.
+ * @return The number of bytes written. 0 ends the body.
+ */
+typedef size_t (*creq_ChunkSource_t)(void *user_data, char *buf, size_t cap);
+
+/**
+ * @brief Creates the head of a chunked response.
+ * @param[out] enc The encoder to initialize.
+ * @param[in] resp The response. Its Content-Length headers are removed and 'Transfer-Encoding: chunked' is added
+ * unless a Transfer-Encoding header is present, which must then list chunked last. Its body is not written. The
+ * headers are only changed when the head is written. A Content-Length header of its header profile is left out of
+ * the head, but the profile itself cannot change, so serializing the response again would show it.
+ * @param[out] buf The destination buffer. May be NULL when only the size is wanted.
+ * @param[in] cap The capacity of 'buf' in bytes.
+ * @param[out] needed If not NULL, receives the exact number of bytes the head takes. Always set.
+ * @return The number of bytes written.
+ *  @retval 0 'buf' is NULL, 'cap' is too small or bad argument given, or the last Transfer-Encoding header does not
+ *  end with chunked (case-insensitively) or the response has CONF_OPT_VALIDATE and fails validation, in which cases
+ *  'needed' stays 0. Nothing is written in this case.
+ * @attention The output is NOT NUL-terminated. The encoder may be re-initialized if the head did not fit.
+ * @see RFC7230 Section 4.1
+ */
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_begin(creq_ChunkedEncoder_t *enc, creq_Response_t *resp, char *buf, size_t cap, size_t *needed);
+
+/**
+ * @brief Encodes 'len' bytes of body data as one chunk.
+ * @param[out] buf The destination buffer. It needs 'len' + CREQ_CHUNK_MAX_OVERHEAD bytes at most.
+ * @param[out] needed If not NULL, receives the exact number of bytes the chunk takes. Always set.
+ * @return The number of bytes written.
+ *  @retval 0 'len' is 0, 'buf' is NULL, 'cap' is too small or the encoder is finished. Nothing is written.
+ */
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_write_chunk(creq_ChunkedEncoder_t *enc, const void *data, size_t len, char *buf, size_t cap,
+                                size_t *needed);
+
+/**
+ * @brief Lets 'source' write body data directly into 'buf' and encodes it as one chunk, without copying the data.
+ * @param[in] cap The capacity of 'buf' in bytes. Up to 'cap' - CREQ_CHUNK_MAX_OVERHEAD bytes of data are requested.
+ * @param[out] offset Receives the offset of the chunk in 'buf'. The head of 'buf' is reserved for the size line.
+ * @return The length of the chunk starting at 'buf' + *offset.
+ *  @retval 0 'source' ended the body, 'cap' leaves no room for data or bad argument given.
+ */
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_pull_chunk(creq_ChunkedEncoder_t *enc, creq_ChunkSource_t source, void *user_data, char *buf,
+                               size_t cap, size_t *offset);
+
+/**
+ * @brief Writes the last chunk, the trailer fields and the final line ending.
+ * @param[in] trailers Header fields sent after the body, e.g. created by creq_HeaderField_create(). May be NULL when
+ * 'trailer_count' is 0.
+ * @param[out] needed If not NULL, receives the exact number of bytes the output takes. Always set.
+ * @return The number of bytes written.
+ *  @retval 0 'buf' is NULL, 'cap' is too small or the encoder is already finished, or the response had
+ *  CONF_OPT_VALIDATE and a trailer field is invalid, in which case 'needed' stays 0. Nothing is written.
+ * @note Trailer fields should be announced with a Trailer header in the head.
+ */
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_finish(creq_ChunkedEncoder_t *enc, creq_HeaderField_t *const *trailers, size_t trailer_count,
+                           char *buf, size_t cap, size_t *needed);
+
+/**
+ * @brief Compiles a request into a template whose slots are filled at render time.
+ * @param[in] slots The variable parts, at most 64. Each one must resolve to a distinct part of the request.
+ * @return The template.
+ *  @retval NULL A slot cannot be resolved, e.g. a header is missing, the request has CONF_OPT_VALIDATE and fails
+ *  validation, or allocation fails.
+ * @attention The template copies every constant byte. 'req' may be modified or freed afterwards.
+ * @see creq_Template_render()
+ */
+CREQ_PUBLIC(creq_Template_t *)
+creq_Template_compile_request(creq_Request_t *req, const creq_TemplateSlot_t *slots, size_t slot_count);
+
+/**
+ * @brief Compiles a response into a template whose slots are filled at render time.
+ * @return The template.
+ *  @retval NULL A slot cannot be resolved, e.g. a TPL_SLOT_TARGET is given or a header is missing, the response has
+ *  CONF_OPT_VALIDATE and fails validation, or allocation fails.
+ * @see creq_Template_compile_request()
+ */
+CREQ_PUBLIC(creq_Template_t *)
+creq_Template_compile_response(creq_Response_t *resp, const creq_TemplateSlot_t *slots, size_t slot_count);
+
+/**
+ * @brief Renders a message from a template.
+ * @param[in] values One value per slot, in the order the slots were given. The value of a TPL_SLOT_CONTENT_LENGTH
+ * slot is ignored.
+ * @param[out] buf The destination buffer. May be NULL when only the size is wanted.
+ * @param[out] needed If not NULL, receives the exact number of bytes the message takes. Always set.
+ * @return The number of bytes written.
+ *  @retval 0 'buf' is NULL, 'cap' is too small or bad argument given. Nothing is written in this case.
+ * @attention The output is NOT NUL-terminated.
+ */
+CREQ_PUBLIC(size_t)
+creq_Template_render(const creq_Template_t *tpl, const creq_TemplateValue_t *values, char *buf, size_t cap,
+                     size_t *needed);
+
+/**
+ * @brief Frees a template. NULL is ignored.
+ */
+CREQ_PUBLIC(void) creq_Template_free(creq_Template_t *tpl);
+
+/**
+ * @brief Creates a header profile holding a copy of the headers of a creq_Request object.
+ * @return The profile, with a reference count of 1.
+ *  @retval NULL More than CREQ_HEADER_PROFILE_MAX_FIELDS headers, out of memory or bad argument given.
+ * @note Every name and value is copied, literals included, so the message is left untouched and may be freed or reused
+ * afterwards. Only the names of well-known headers added by ID are shared, as they are static.
+ */
+CREQ_PUBLIC(creq_HeaderProfile_t *) creq_HeaderProfile_create_from_request(creq_Request_t *req);
+
+/**
+ * @brief Creates a header profile holding a copy of the headers of a creq_Response object.
+ * @see creq_HeaderProfile_create_from_request()
+ */
+CREQ_PUBLIC(creq_HeaderProfile_t *) creq_HeaderProfile_create_from_response(creq_Response_t *resp);
+
+/**
+ * @brief Takes a reference to a header profile. Thread-safe unless the compiler lacks C11 atomics.
+ * @return 'profile'.
+ */
+CREQ_PUBLIC(creq_HeaderProfile_t *) creq_HeaderProfile_retain(creq_HeaderProfile_t *profile);
+
+/**
+ * @brief Drops a reference to a header profile, freeing it with the last one. NULL is ignored.
+ */
+CREQ_PUBLIC(void) creq_HeaderProfile_release(creq_HeaderProfile_t *profile);
+
+/**
+ * @brief Get the number of headers in a header profile. 0 if 'profile' is NULL.
+ */
+CREQ_PUBLIC(size_t) creq_HeaderProfile_get_count(const creq_HeaderProfile_t *profile);
+
+/**
+ * @brief Prepares a parser for a new message.
+ * @param limits Limits to enforce. NULL selects every default.
+ */
+CREQ_PUBLIC(void) creq_Parser_init(creq_Parser_t *parser, const creq_ParseLimits_t *limits);
+
+/**
+ * @brief Parses an HTTP/1.x request from a receive buffer into a creq_Request object without copying.
+ * @param buf Every byte received so far for this message, starting with its request line. It may have moved since
+ * the previous call, e.g. after realloc(), as long as its content is kept.
+ * @param len Length of 'buf' in bytes.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC The message is complete. parser->consumed is its length; any following bytes belong to
+ *  the next message.
+ *  @retval CREQ_STATUS_INCOMPLETE More bytes are needed. Call again with the grown buffer.
+ *  @retval CREQ_STATUS_FAILED parser->error tells why. The request should not be used.
+ * @note Lines already parsed are not scanned again. Bare LF is accepted as a line ending.
+ * @note The target, header names and values and the body are borrowed slices of 'buf', which are NOT NUL-terminated.
+ * Use the length fields or functions, and keep the buffer alive and unchanged while the request is in use.
+ * @note Parsed headers are appended to those already in 'req'. An unrecognized method is stored as _METH_UNKNOWN.
+ * @attention Only bodies delimited by Content-Length are supported. Transfer-Encoding fails with
+ * PARSE_ERR_UNSUPPORTED.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Request_parse(creq_Parser_t *parser, creq_Request_t *req, const char *buf, size_t len);
+
+/**
+ * @brief Prepares a parser for a response, whose body is streamed to a callback.
+ * @param limits Limits to enforce. NULL selects every default.
+ * @param request_method Method of the request being answered, or _METH_UNKNOWN.
+ * @param on_body Called with each piece of body, transfer coding removed. NULL discards the body.
+ * @param user_data Passed as-is to 'on_body'.
+ */
+CREQ_PUBLIC(void)
+creq_Parser_init_response(creq_Parser_t *parser, const creq_ParseLimits_t *limits, creq_HttpMethod_t request_method,
+                          creq_BodySink_t on_body, void *user_data);
+
+/**
+ * @brief Parses an HTTP/1.x response from a receive buffer into a creq_Response object, streaming its body.
+ * @param buf Every byte received so far for this message, starting with its status line, except the body bytes
+ * dropped by creq_Parser_compact(). It may have moved since the previous call as long as its content is kept.
+ * @param len Length of 'buf' in bytes.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC The message is complete. parser->consumed is its length; any following bytes belong to
+ *  the next message.
+ *  @retval CREQ_STATUS_INCOMPLETE More bytes are needed. Call again with the grown buffer, or call creq_Parser_eof()
+ *  if the connection has been closed.
+ *  @retval CREQ_STATUS_FAILED parser->error tells why. The response should not be used.
+ * @note The reason phrase, header names and values are borrowed slices of 'buf', which are NOT NUL-terminated. The
+ * body is never stored into the response; it goes to the callback given to creq_Parser_init_response().
+ * @note Bodies are delimited by the chunked transfer coding, by Content-Length or by the end of the connection.
+ * Responses to HEAD, 1xx, 204 and 304 responses and 2xx responses to CONNECT have none. Chunk extensions and
+ * trailer fields are skipped.
+ * @note A 1xx response is complete after its head. Initialize the parser again to read the response that follows.
+ */
+CREQ_PUBLIC(creq_status_t)
+creq_Response_parse(creq_Parser_t *parser, creq_Response_t *resp, const char *buf, size_t len);
+
+/**
+ * @brief Tells a parser that the connection has been closed, ending a body delimited by the end of the connection.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC The message is complete.
+ *  @retval CREQ_STATUS_FAILED The message is cut short, with PARSE_ERR_TRUNCATED, or parsing has already failed.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Parser_eof(creq_Parser_t *parser);
+
+/**
+ * @brief Drops the body bytes a parser is done with, so that a large body never has to be buffered whole.
+ * @return The new length of the content of 'buf'.
+ * @note Unparsed bytes are moved down to follow the head, and parser->consumed becomes parser->head_len. Nothing
+ * happens before the head is complete or once the message is.
+ */
+CREQ_PUBLIC(size_t) creq_Parser_compact(creq_Parser_t *parser, char *buf, size_t len);
+
+#ifdef CREQ_POSIX_IO
+/**
+ * @brief Writes the whole response to a blocking file descriptor, usually a socket.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED A write fails. errno tells why. Part of the response may have been written.
+ *  Also returned, with nothing written, for a bad argument or a response failing CONF_OPT_VALIDATE.
+ * @note The head is written with writev(). A file body is then copied by the kernel with sendfile() where available,
+ * or written from read-only mappings of at most 1 MiB of the file at a time. Its content never passes through a creq
+ * buffer.
+ * @attention Writes to a socket use MSG_NOSIGNAL where the platform has it, so a closed connection fails with EPIPE
+ * rather than raising SIGPIPE. sendfile() has no such flag, and neither do platforms without MSG_NOSIGNAL: a server
+ * that must survive peers going away should ignore SIGPIPE (or set SO_NOSIGPIPE on its sockets) anyway.
+ * @see creq_Response_set_body_file()
+ */
+CREQ_PUBLIC(creq_status_t) creq_Response_send(creq_Response_t *resp, int fd);
+
+/**
+ * @brief Prepares to write a request with creq_Writer_write().
+ * @param[out] writer The writer to initialize.
+ * @param[in] req The request. It must not be changed or freed until the writer is finished or abandoned.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Bad argument given or the request fails CONF_OPT_VALIDATE.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Writer_init_request(creq_Writer_t *writer, creq_Request_t *req);
+
+/**
+ * @brief Prepares to write a response, including its body file, with creq_Writer_write().
+ * @param[out] writer The writer to initialize.
+ * @param[in] resp The response. It must not be changed or freed until the writer is finished or abandoned.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC Procedure finishes successfully.
+ *  @retval CREQ_STATUS_FAILED Bad argument given or the response fails CONF_OPT_VALIDATE.
+ */
+CREQ_PUBLIC(creq_status_t) creq_Writer_init_response(creq_Writer_t *writer, creq_Response_t *resp);
+
+/**
+ * @brief Writes as much of the message as 'fd' takes, picking up where the previous call stopped.
+ * @param[in] fd The file descriptor, usually a non-blocking socket. Blocking ones work too.
+ * @return Indicates if the procedure is finished properly.
+ *  @retval CREQ_STATUS_SUCC The whole message is written. Further calls write nothing.
+ *  @retval CREQ_STATUS_INCOMPLETE 'fd' would block. Call again once it is writable, e.g. on EPOLLOUT.
+ *  @retval CREQ_STATUS_FAILED A write fails, errno tells why, or the body file is shorter than its range. The writer
+ *  stays where it was.
+ * @note Nothing is buffered or allocated: the pieces are handed to writev() straight from the message, and a body file
+ * is copied by the kernel with sendfile() where available, or written from read-only mappings of at most 1 MiB of the
+ * file at a time.
+ * @attention As with creq_Response_send(), socket writes use MSG_NOSIGNAL where the platform has it, but sendfile()
+ * cannot: ignore SIGPIPE (or set SO_NOSIGPIPE) to survive peers going away while a body file is being sent.
+ * @see creq_Response_send()
+ */
+CREQ_PUBLIC(creq_status_t) creq_Writer_write(creq_Writer_t *writer, int fd);
+#endif // CREQ_POSIX_IO
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -10,6 +10,17 @@ extern "C" {
 #include <stdlib.h> /* for malloc/realloc/free */
 #include <assert.h> /* for assert */
 
+/* allocation functions used for vector storage; define these before including this header to override them */
+#ifndef cvector_clib_malloc
+#define cvector_clib_malloc malloc
+#endif
+#ifndef cvector_clib_realloc
+#define cvector_clib_realloc realloc
+#endif
+#ifndef cvector_clib_free
+#define cvector_clib_free free
+#endif
+
 /**
  * @brief cvector_VECTOR - The vector type used in this library  
  */
@@ -74,14 +85,14 @@ do {                                    \
 #define cvector_grow(vec, count) \
 do {                                                                                    \
 	if(!(vec)) {                                                                        \
-		size_t *__p = malloc((count) * sizeof(*(vec)) + (sizeof(size_t) * 2));          \
+		size_t *__p = cvector_clib_malloc((count) * sizeof(*(vec)) + (sizeof(size_t) * 2));          \
 		assert(__p);                                                                    \
 		(vec) = (void *)(&__p[2]);                                                      \
 		cvector_set_capacity((vec), (count));                                            \
 		cvector_set_size((vec), 0);                                                      \
 	} else {                                                                            \
 		size_t *__p1 = &((size_t *)(vec))[-2];                                          \
-		size_t *__p2 = realloc(__p1, ((count) * sizeof(*(vec))+ (sizeof(size_t) * 2))); \
+		size_t *__p2 = cvector_clib_realloc(__p1, ((count) * sizeof(*(vec))+ (sizeof(size_t) * 2))); \
 		assert(__p2);                                                                   \
 		(vec) = (void *)(&__p2[2]);                                                     \
 		cvector_set_capacity((vec), (count));                                            \
@@ -127,7 +138,7 @@ do {                                                   \
 do { \
 	if(vec) {                                \
 		size_t *p1 = &((size_t *)(vec))[-2]; \
-		free(p1);                            \
+		cvector_clib_free(p1);                          \
 	}                                        \
 } while(0)
 
@@ -4,20 +4,56 @@
  * @author CSharperMantle
  */
 
-// for portability consideration, try to make hacks to use %zu format for size_t
-#if defined(__MINGW32__) || defined(__MINGW64__)
-#define __USE_MINGW_ANSI_STDIO 1
-#endif // defined(__MINGW32__) || defined (__MINGW64__)
-
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <time.h>
 #include <wchar.h>
 #include "creq.h"
 #include "cvector.h"
 
+#ifndef __STDC_NO_ATOMICS__
+#include <stdatomic.h>
+#endif
+
+// The validator scans 32 or 16 bytes at a time where the target has AVX2 or SSE2. Define CREQ_NO_SIMD to opt out.
+// GCC and Clang also build the AVX2 path for an SSE2-only target and take it when the CPU turns out to have AVX2.
+#if !defined(CREQ_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define _CREQ_SIMD_AVX2
+#define _CREQ_SIMD_SSE2
+#elif !defined(CREQ_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define _CREQ_SIMD_AVX2
+#define _CREQ_SIMD_AVX2_RUNTIME
+#define _CREQ_SIMD_SSE2
+#elif !defined(CREQ_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define _CREQ_SIMD_SSE2
+#endif
+
+// For the few helpers that only pay off once the class they check is folded in as a constant.
+#if defined(__GNUC__)
+#define _CREQ_INLINE(type) static inline __attribute__((always_inline)) type
+#else
+#define _CREQ_INLINE(type) static inline type
+#endif
+
+#ifdef CREQ_POSIX_IO
+#include <errno.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
 /*
  * RFC 7320
  * Whitespace Rules
@@ -29,946 +65,5794 @@
  *                  ; "bad" whitespace
  */
 
-/*
- * RFC 7230
- * request-line = method SP request-target SP HTTP-version CRLF
- * 
- * $(method) /target/path HTTP/1.1 line_ending(\r, \n || \r\n)
- */
-CREQ_PRIVATE(const char *)
-_creq_FMT_REQUEST_LINE = "%s %s %s%s";
-
-/*
- * RFC 7230
- * HTTP-version  = HTTP-name "/" DIGIT "." DIGIT
- * HTTP-name     = %x48.54.54.50 ; "HTTP", case-sensitive
- * 
- * HTTP/$(major).$(minor)
- */
-CREQ_PRIVATE(const char *)
-_creq_FMT_HTTP_VERSION = "HTTP/%d.%d";
-
-/*
- * RFC 7230
- * header-field   = field-name ":" OWS field-value OWS
- * 
- * Header-Head: Header-Value line_ending
- */
-CREQ_PRIVATE(const char *)
-_creq_FMT_HEADER = "%s: %s%s";
-
 /*
  * RFC 7230
  * HTTP-message   = start-line
  *                  *( header-field CRLF )
  *                  CRLF
  *                  [ message-body ]
- * 
- * REQUEST_LINE(with line_ending)
- * HEADER(with line_ending)
+ * request-line   = method SP request-target SP HTTP-version CRLF
+ * status-line    = HTTP-version SP status-code SP reason-phrase CRLF
+ * HTTP-version   = HTTP-name "/" DIGIT "." DIGIT
+ * HTTP-name      = %x48.54.54.50 ; "HTTP", case-sensitive
+ * header-field   = field-name ":" OWS field-value OWS
+ *
+ * $(method) /target/path HTTP/$(major).$(minor) line_ending(\r, \n || \r\n)
+ * HTTP/$(major).$(minor) $(status) $(reason) line_ending
+ * Header-Head: Header-Value line_ending
  * line_ending
  * BODY
  */
-CREQ_PRIVATE(const char *)
-_creq_FMT_FULL_REQUEST = "%s%s%s%s";
 
-/*
- * RFC 7320
- * status-line = HTTP-version SP status-code SP reason-phrase CRLF
- */
-CREQ_PRIVATE(const char *)
-_creq_FMT_STATUS_LINE = "%s %d %s%s";
+#if defined(CREQ_NO_THREAD_LOCAL)
+#define _CREQ_THREAD_LOCAL
+#elif defined(_MSC_VER)
+#define _CREQ_THREAD_LOCAL __declspec(thread)
+#else
+#define _CREQ_THREAD_LOCAL _Thread_local
+#endif
 
-/*
- * RFC 7230
- * HTTP-message   = start-line
- *                  *( header-field CRLF )
- *                  CRLF
- *                  [ message-body ]
- * 
- * STATUS_LINE(with line_ending)
- * HEADER(with line_ending)
- * line_ending
- * BODY
- */
-CREQ_PRIVATE(const char *)
-_creq_FMT_FULL_RESPONSE = "%s%s%s%s";
+CREQ_PRIVATE(void *)
+_creq_default_malloc(size_t size, void *user_data)
+{
+    (void)user_data;
+    return malloc(size);
+}
 
 CREQ_PRIVATE(void *)
-_creq_malloc_n_init(size_t size)
+_creq_default_realloc(void *ptr, size_t size, void *user_data)
 {
-    void *pNewSpace = malloc(size);
-    memset(pNewSpace, 0, size);
-    return pNewSpace;
+    (void)user_data;
+    return realloc(ptr, size);
 }
 
-/// @attention Don't forget to free the pointer returned!
-CREQ_PRIVATE(char *)
-_creq_malloc_strcpy(const char *src)
+CREQ_PRIVATE(void)
+_creq_default_free(void *ptr, void *user_data)
 {
-    size_t fullLen = strlen(src) + 1;
-    char *dest = (char *)malloc(sizeof(char) * fullLen);
-    strcpy(dest, src);
-    return dest;
+    (void)user_data;
+    free(ptr);
 }
 
-CREQ_PRIVATE(const char *)
-_creq_get_line_ending_str(creq_Config_t *conf, creq_ConfigType_t confType)
+static creq_Allocator_t _creq_allocator = {_creq_default_malloc, _creq_default_realloc, _creq_default_free, NULL};
+
+/*
+ * Allocation statistics (CREQ_ENABLE_STATS). Blocks are handed out unchanged, so anything the allocator can free may
+ * still free them. Sizes are asked of the C library, which only knows the blocks of the default allocator. The
+ * process-wide counters are relaxed atomics; the per-thread ones are plain thread-locals.
+ */
+#ifdef CREQ_ENABLE_STATS
+#if defined(_WIN32)
+#include <malloc.h>
+#define _CREQ_USABLE_SIZE(ptr) _msize(ptr)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define _CREQ_USABLE_SIZE(ptr) malloc_size(ptr)
+#elif defined(__linux__)
+#include <malloc.h>
+#define _CREQ_USABLE_SIZE(ptr) malloc_usable_size(ptr)
+#endif
+
+/// @return The size of a block, or 0 if it is unknown.
+CREQ_PRIVATE(int64_t)
+_creq_stats_block_size(void *ptr)
 {
-    if (conf == NULL)
+#ifdef _CREQ_USABLE_SIZE
+    if (ptr != NULL && _creq_allocator.malloc_fn == _creq_default_malloc)
     {
-        return NULL;
+        return (int64_t)_CREQ_USABLE_SIZE(ptr);
     }
-    creq_LineEnding_t ending = LE_CRLF;
-    if (confType == CONF_REQUEST)
+#else
+    (void)ptr;
+#endif
+    return 0;
+}
+
+#ifndef __STDC_NO_ATOMICS__
+typedef atomic_uint_fast64_t _creq_StatCount_t;
+typedef atomic_int_fast64_t _creq_StatBytes_t;
+#define _CREQ_STAT_LOAD(var) atomic_load_explicit(&(var), memory_order_relaxed)
+#define _CREQ_STAT_STORE(var, value) atomic_store_explicit(&(var), (value), memory_order_relaxed)
+/// Evaluates to the value before the addition.
+#define _CREQ_STAT_FETCH_ADD(var, n) atomic_fetch_add_explicit(&(var), (n), memory_order_relaxed)
+#else
+typedef uint_fast64_t _creq_StatCount_t;
+typedef int_fast64_t _creq_StatBytes_t;
+#define _CREQ_STAT_LOAD(var) (var)
+#define _CREQ_STAT_STORE(var, value) ((var) = (value))
+#define _CREQ_STAT_FETCH_ADD(var, n) (((var) += (n)) - (n))
+#endif
+
+static struct
+{
+    _creq_StatCount_t alloc_count;
+    _creq_StatCount_t realloc_count;
+    _creq_StatCount_t free_count;
+    _creq_StatBytes_t bytes_live;
+    _creq_StatBytes_t bytes_peak;
+} _creq_stats_global;
+static _CREQ_THREAD_LOCAL creq_Stats_t _creq_stats_thread;
+
+/// @brief Counts one allocator call that changed the live bytes by 'delta'.
+CREQ_PRIVATE(void)
+_creq_stats_update(_creq_StatCount_t *pGlobalCount, uint64_t *pThreadCount, int64_t delta)
+{
+    creq_Stats_t *pThread = &_creq_stats_thread;
+    (*pThreadCount)++;
+    pThread->bytes_live += delta;
+    if (pThread->bytes_live > pThread->bytes_peak)
     {
-        ending = conf->data.request_config.line_ending;
+        pThread->bytes_peak = pThread->bytes_live;
     }
-    else if (confType == CONF_RESPONSE)
+    (void)_CREQ_STAT_FETCH_ADD(*pGlobalCount, 1);
+    int_fast64_t live = _CREQ_STAT_FETCH_ADD(_creq_stats_global.bytes_live, delta) + delta;
+    if (delta <= 0)
     {
-        ending = conf->data.response_config.line_ending;
+        return;
     }
-    switch (ending)
+#ifndef __STDC_NO_ATOMICS__
+    int_fast64_t peak = _CREQ_STAT_LOAD(_creq_stats_global.bytes_peak);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&_creq_stats_global.bytes_peak, &peak, live,
+                                                                  memory_order_relaxed, memory_order_relaxed))
     {
-    case LE_CR:
-        return "\r";
-    case LE_LF:
-        return "\n";
-    case LE_CRLF:
-        // fall through
-    default:
-        return "\r\n";
     }
+#else
+    if (live > _creq_stats_global.bytes_peak)
+    {
+        _creq_stats_global.bytes_peak = live;
+    }
+#endif
 }
+#endif
 
-CREQ_PRIVATE(const char *)
-_creq_get_http_method_str(creq_HttpMethod_t meth)
+CREQ_PUBLIC(creq_status_t)
+creq_get_stats(creq_Stats_t *global, creq_Stats_t *thread)
 {
-    switch (meth)
+#ifdef CREQ_ENABLE_STATS
+    if (global != NULL)
     {
-    case METH_GET:
-        return "GET";
-    case METH_HEAD:
-        return "HEAD";
-    case METH_POST:
-        return "POST";
-    case METH_PUT:
-        return "PUT";
-    case METH_DELETE:
-        return "DELETE";
-    case METH_CONNECT:
-        return "CONNECT";
-    case METH_OPTIONS:
-        return "OPTIONS";
-    case METH_TRACE:
-        return "TRACE";
-    default:
-        return NULL;
+        global->alloc_count = _CREQ_STAT_LOAD(_creq_stats_global.alloc_count);
+        global->realloc_count = _CREQ_STAT_LOAD(_creq_stats_global.realloc_count);
+        global->free_count = _CREQ_STAT_LOAD(_creq_stats_global.free_count);
+        global->bytes_live = _CREQ_STAT_LOAD(_creq_stats_global.bytes_live);
+        global->bytes_peak = _CREQ_STAT_LOAD(_creq_stats_global.bytes_peak);
+    }
+    if (thread != NULL)
+    {
+        *thread = _creq_stats_thread;
+    }
+    return CREQ_STATUS_SUCC;
+#else
+    if (global != NULL)
+    {
+        memset(global, 0, sizeof(creq_Stats_t));
+    }
+    if (thread != NULL)
+    {
+        memset(thread, 0, sizeof(creq_Stats_t));
     }
+    return CREQ_STATUS_FAILED;
+#endif
 }
 
-/// @attention Don't forget to free the returned string! THE STR IS MALLOC'ED!
-CREQ_PRIVATE(char *)
-_creq_get_http_version_str(int major, int minor)
+CREQ_PUBLIC(void)
+creq_reset_stats(void)
 {
-    int len = snprintf((char *)NULL, 0U, _creq_FMT_HTTP_VERSION, major, minor);
-    char *str = (char *)_creq_malloc_n_init(sizeof(char) * (len + 1));
-    snprintf(str, len + 1, _creq_FMT_HTTP_VERSION, major, minor);
-    return str;
+#ifdef CREQ_ENABLE_STATS
+    _CREQ_STAT_STORE(_creq_stats_global.alloc_count, 0);
+    _CREQ_STAT_STORE(_creq_stats_global.realloc_count, 0);
+    _CREQ_STAT_STORE(_creq_stats_global.free_count, 0);
+    _CREQ_STAT_STORE(_creq_stats_global.bytes_peak, _CREQ_STAT_LOAD(_creq_stats_global.bytes_live));
+    _creq_stats_thread.alloc_count = 0;
+    _creq_stats_thread.realloc_count = 0;
+    _creq_stats_thread.free_count = 0;
+    _creq_stats_thread.bytes_peak = _creq_stats_thread.bytes_live;
+#endif
 }
 
-CREQ_PUBLIC(creq_HeaderField_t *)
-creq_HeaderField_create(char *header, char *value)
+CREQ_PUBLIC(creq_status_t)
+creq_set_allocator(const creq_Allocator_t *allocator)
 {
-    if (header == NULL || value == NULL)
+    if (allocator == NULL)
     {
-        return NULL;
+        _creq_allocator.malloc_fn = _creq_default_malloc;
+        _creq_allocator.realloc_fn = _creq_default_realloc;
+        _creq_allocator.free_fn = _creq_default_free;
+        _creq_allocator.user_data = NULL;
+        return CREQ_STATUS_SUCC;
     }
-    creq_HeaderField_t *pNewHeader = (creq_HeaderField_t *)_creq_malloc_n_init(sizeof(struct creq_HeaderField));
-    pNewHeader->field_name = _creq_malloc_strcpy(header);
-    pNewHeader->is_field_name_literal = false;
-    pNewHeader->field_value = _creq_malloc_strcpy(value);
-    pNewHeader->is_field_value_literal = false;
-    return pNewHeader;
+    if (allocator->malloc_fn == NULL || allocator->realloc_fn == NULL || allocator->free_fn == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_allocator = *allocator;
+    return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(creq_HeaderField_t *)
-creq_HeaderField_create_literal(const char *header_s, const char *value_s)
+CREQ_PUBLIC(void *)
+creq_malloc(size_t size)
 {
-    if (header_s == NULL || value_s == NULL)
+    void *ptr = _creq_allocator.malloc_fn(size, _creq_allocator.user_data);
+#ifdef CREQ_ENABLE_STATS
+    if (ptr != NULL)
     {
-        return NULL;
+        _creq_stats_update(&_creq_stats_global.alloc_count, &_creq_stats_thread.alloc_count,
+                           _creq_stats_block_size(ptr));
     }
-    creq_HeaderField_t *pNewHeader = (creq_HeaderField_t *)_creq_malloc_n_init(sizeof(struct creq_HeaderField));
-    pNewHeader->field_name = (char *)header_s;
-    pNewHeader->is_field_name_literal = true;
-    pNewHeader->field_value = (char *)value_s;
-    pNewHeader->is_field_value_literal = true;
-    return pNewHeader;
+#endif
+    return ptr;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_HeaderField_free(creq_HeaderField_t **ptrToFieldPtr)
+CREQ_PUBLIC(void *)
+creq_realloc(void *ptr, size_t size)
 {
-    if (ptrToFieldPtr == NULL)
-    {
-        return CREQ_STATUS_FAILED;
-    }
-    creq_HeaderField_t *pField = *ptrToFieldPtr;
-    if (!pField->is_field_name_literal)
+#ifdef CREQ_ENABLE_STATS
+    if (ptr == NULL)
     {
-        CREQ_GUARDED_FREE(pField->field_name);
-        pField->field_name = NULL;
+        return creq_malloc(size);
     }
-    if (!pField->is_field_value_literal)
+    int64_t oldSize = _creq_stats_block_size(ptr);
+    ptr = _creq_allocator.realloc_fn(ptr, size, _creq_allocator.user_data);
+    if (ptr != NULL)
     {
-        CREQ_GUARDED_FREE(pField->field_value);
-        pField->field_value = NULL;
+        _creq_stats_update(&_creq_stats_global.realloc_count, &_creq_stats_thread.realloc_count,
+                           _creq_stats_block_size(ptr) - oldSize);
     }
-    CREQ_GUARDED_FREE(pField);
-    return CREQ_STATUS_SUCC;
+    return ptr;
+#else
+    return _creq_allocator.realloc_fn(ptr, size, _creq_allocator.user_data);
+#endif
 }
 
-CREQ_PUBLIC(creq_Request_t *)
-creq_Request_create(creq_Config_t *conf)
+CREQ_PUBLIC(void)
+creq_free(void *ptr)
 {
-    creq_Request_t *pRequest = (creq_Request_t *)_creq_malloc_n_init(sizeof(struct creq_Request));
-
-    if (conf != NULL && conf->config_type == CONF_REQUEST)
-    {
-        pRequest->config = *conf;
-    }
-    else
+    if (ptr != NULL)
     {
-        creq_Config_t config;
-        config.config_type = CONF_REQUEST;
-        config.data.request_config.line_ending = LE_CRLF;
-        pRequest->config = config;
+#ifdef CREQ_ENABLE_STATS
+        _creq_stats_update(&_creq_stats_global.free_count, &_creq_stats_thread.free_count,
+                           -_creq_stats_block_size(ptr));
+#endif
+        _creq_allocator.free_fn(ptr, _creq_allocator.user_data);
     }
-    pRequest->method = _METH_UNKNOWN;
-    pRequest->is_request_target_literal = false;
-    pRequest->request_target = NULL;
-    pRequest->http_version.major = 0;
-    pRequest->http_version.minor = 0;
-    pRequest->header_vector = NULL;
-    pRequest->is_message_body_literal = false;
-    pRequest->message_body = NULL;
-
-    return pRequest;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_free(creq_Request_t *req)
+CREQ_PRIVATE(void *)
+_creq_malloc_n_init(size_t size)
 {
-    if (req != NULL)
+    void *pNewSpace = creq_malloc(size);
+    if (pNewSpace != NULL)
     {
-        // free pointer members
-        if (!req->is_request_target_literal)
-            CREQ_GUARDED_FREE(req->request_target);
-        if (!req->is_message_body_literal)
-            CREQ_GUARDED_FREE(req->message_body);
-        creq_HeaderField_t *pHeader = NULL;
-        size_t szNowSize = cvector_size(req->header_vector);
-        while (szNowSize > 0)
-        {
-            pHeader = req->header_vector[szNowSize - 1];
-            cvector_pop_back(req->header_vector);
-            creq_HeaderField_free(&pHeader);
-            szNowSize = cvector_size(req->header_vector);
-        }
-        cvector_free(req->header_vector);
-        // finally
-        free(req);
-        return CREQ_STATUS_SUCC;
+        memset(pNewSpace, 0, size);
     }
-    return CREQ_STATUS_FAILED;
+    return pNewSpace;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_set_http_method(creq_Request_t *req, creq_HttpMethod_t method)
+/*
+ * Per-thread free list of creq_HeaderField_t nodes. A pooled node's field_name holds the link to the next one.
+ */
+static size_t _creq_header_pool_limit = 0;
+static _CREQ_THREAD_LOCAL creq_HeaderField_t *_creq_header_pool_head = NULL;
+static _CREQ_THREAD_LOCAL size_t _creq_header_pool_count = 0;
+
+CREQ_PUBLIC(void)
+creq_HeaderField_pool_set_limit(size_t max_cached)
 {
-    if (req == NULL)
-    {
-        return CREQ_STATUS_FAILED;
-    }
-    req->method = method;
-    return CREQ_STATUS_SUCC;
+    _creq_header_pool_limit = max_cached;
 }
 
-CREQ_PUBLIC(creq_HttpMethod_t)
-creq_Request_get_http_method(creq_Request_t *req)
+CREQ_PUBLIC(void)
+creq_HeaderField_pool_drain(void)
 {
-    if (req == NULL)
+    while (_creq_header_pool_head != NULL)
     {
-        return _METH_UNKNOWN;
+        creq_HeaderField_t *pNode = _creq_header_pool_head;
+        _creq_header_pool_head = (creq_HeaderField_t *)pNode->field_name;
+        creq_free(pNode);
     }
-    return req->method;
+    _creq_header_pool_count = 0;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_set_target(creq_Request_t *req, char *requestTarget, bool is_literal)
+/// @return A zero-filled node, recycled from the pool when possible.
+CREQ_PRIVATE(creq_HeaderField_t *)
+_creq_header_pool_get(void)
 {
-    if (req == NULL)
-    {
-        return CREQ_STATUS_FAILED;
-    }
-    if (!req->is_request_target_literal)
-        CREQ_GUARDED_FREE(req->request_target); // if it is a malloc'ed string then free it.
-    if (requestTarget == NULL)
+    creq_HeaderField_t *pNode = _creq_header_pool_head;
+    if (pNode == NULL)
     {
-        req->request_target = NULL;
-        return CREQ_STATUS_SUCC;
+        return (creq_HeaderField_t *)_creq_malloc_n_init(sizeof(struct creq_HeaderField));
     }
+    _creq_header_pool_head = (creq_HeaderField_t *)pNode->field_name;
+    _creq_header_pool_count--;
+    memset(pNode, 0, sizeof(struct creq_HeaderField));
+    return pNode;
+}
 
-    if (is_literal)
+CREQ_PRIVATE(void)
+_creq_header_pool_put(creq_HeaderField_t *pNode)
+{
+    if (_creq_header_pool_count >= _creq_header_pool_limit)
     {
-        req->request_target = (char *)requestTarget; // this is a immediate literal value, store it.
-        req->is_request_target_literal = true;
+        creq_free(pNode);
+        return;
     }
-    else
-    {
+    pNode->field_name = (char *)_creq_header_pool_head;
+    _creq_header_pool_head = pNode;
+    _creq_header_pool_count++;
+}
 
-        char *pReqTargetCopy = _creq_malloc_strcpy(requestTarget);
-        req->request_target = pReqTargetCopy;
-        req->is_request_target_literal = false; // this is not a immediate literal.
-    }
+/*
+ * Per-message arena (CONF_OPT_ARENA).
+ *
+ * Blocks are chained newest-first. The creq_Arena_t itself and the message owning it live in the first block, so
+ * destroying the arena releases the message with everything it allocated in one go. Individual frees are no-ops.
+ * Rewinding the arena drops everything allocated after the mark and keeps the blocks it emptied for later use.
+ */
+typedef struct _creq_ArenaBlock
+{
+    struct _creq_ArenaBlock *prev;
+    size_t capacity;
+    size_t used;
+} _creq_ArenaBlock_t;
 
-    return CREQ_STATUS_SUCC;
-}
+struct creq_Arena
+{
+    _creq_ArenaBlock_t *current;
+    /// Emptied blocks, reused before new ones are allocated.
+    _creq_ArenaBlock_t *spare;
+    /// Where _creq_Arena_rewind() goes back to.
+    _creq_ArenaBlock_t *mark_block;
+    size_t mark_used;
+};
 
-CREQ_PUBLIC(char *)
-creq_Request_get_target(creq_Request_t *req)
+#define _CREQ_ALIGN_UP(n) (((n) + _Alignof(max_align_t) - 1) & ~(size_t)(_Alignof(max_align_t) - 1))
+#define _CREQ_ARENA_BLOCK_HEADER_SIZE _CREQ_ALIGN_UP(sizeof(_creq_ArenaBlock_t))
+
+CREQ_PRIVATE(_creq_ArenaBlock_t *)
+_creq_ArenaBlock_create(_creq_ArenaBlock_t *prev, size_t capacity)
 {
-    if (req == NULL)
+    _creq_ArenaBlock_t *pBlock = (_creq_ArenaBlock_t *)creq_malloc(_CREQ_ARENA_BLOCK_HEADER_SIZE + capacity);
+    if (pBlock == NULL)
     {
         return NULL;
     }
-    return req->request_target;
+    pBlock->prev = prev;
+    pBlock->capacity = capacity;
+    pBlock->used = 0;
+    return pBlock;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_set_http_version(creq_Request_t *req, int major, int minor)
+/// @return A zero-filled, max_align_t-aligned chunk, or NULL on allocation failure.
+CREQ_PRIVATE(void *)
+_creq_Arena_alloc(creq_Arena_t *arena, size_t size)
 {
-    if (req == NULL)
+    size = _CREQ_ALIGN_UP(size);
+    _creq_ArenaBlock_t *pBlock = arena->current;
+    if (pBlock->capacity - pBlock->used < size)
     {
-        return CREQ_STATUS_FAILED;
+        _creq_ArenaBlock_t **ppSpare = &arena->spare;
+        while (*ppSpare != NULL && (*ppSpare)->capacity < size)
+        {
+            ppSpare = &(*ppSpare)->prev;
+        }
+        if (*ppSpare != NULL)
+        {
+            _creq_ArenaBlock_t *pSpare = *ppSpare;
+            *ppSpare = pSpare->prev;
+            pSpare->prev = pBlock;
+            pSpare->used = 0;
+            pBlock = pSpare;
+        }
+        else
+        {
+            size_t capacity = pBlock->capacity * 2;
+            pBlock = _creq_ArenaBlock_create(pBlock, capacity > size ? capacity : size);
+            if (pBlock == NULL)
+            {
+                return NULL;
+            }
+        }
+        arena->current = pBlock;
     }
-    req->http_version.major = major;
-    req->http_version.minor = minor;
-    return CREQ_STATUS_SUCC;
+    char *ptr = (char *)pBlock + _CREQ_ARENA_BLOCK_HEADER_SIZE + pBlock->used;
+    pBlock->used += size;
+    memset(ptr, 0, size);
+    return ptr;
 }
 
-CREQ_PUBLIC(creq_HttpVersion_t)
-creq_Request_get_http_version(creq_Request_t *req)
+CREQ_PRIVATE(creq_Arena_t *)
+_creq_Arena_create(void)
 {
-    creq_HttpVersion_t obj;
-    obj.major = -1;
-    obj.minor = -1;
-    if (req == NULL)
+    _creq_ArenaBlock_t *pBlock = _creq_ArenaBlock_create(NULL, _CREQ_ALIGN_UP(CREQ_ARENA_BLOCK_SIZE));
+    if (pBlock == NULL)
     {
-        return obj;
+        return NULL;
     }
-    obj.major = req->http_version.major;
-    obj.minor = req->http_version.minor;
-    return obj;
+    creq_Arena_t *arena = (creq_Arena_t *)((char *)pBlock + _CREQ_ARENA_BLOCK_HEADER_SIZE);
+    pBlock->used = _CREQ_ALIGN_UP(sizeof(creq_Arena_t));
+    arena->current = pBlock;
+    arena->spare = NULL;
+    arena->mark_block = pBlock;
+    arena->mark_used = pBlock->used;
+    return arena;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_add_header(creq_Request_t *req, char *header, char *value, bool is_literal)
+/// @brief Remembers the current fill level as the point _creq_Arena_rewind() goes back to.
+CREQ_PRIVATE(void)
+_creq_Arena_set_mark(creq_Arena_t *arena)
 {
-    if (req == NULL || header == NULL || value == NULL)
+    arena->mark_block = arena->current;
+    arena->mark_used = arena->current->used;
+}
+
+/// @brief Releases everything allocated since the mark. The blocks emptied this way are kept as spares.
+CREQ_PRIVATE(void)
+_creq_Arena_rewind(creq_Arena_t *arena)
+{
+    while (arena->current != arena->mark_block)
     {
-        return CREQ_STATUS_FAILED;
+        _creq_ArenaBlock_t *pBlock = arena->current;
+        arena->current = pBlock->prev;
+        pBlock->prev = arena->spare;
+        arena->spare = pBlock;
     }
-    if (is_literal)
+    arena->current->used = arena->mark_used;
+}
+
+CREQ_PRIVATE(void)
+_creq_Arena_destroy(creq_Arena_t *arena)
+{
+    _creq_ArenaBlock_t *pBlock = arena->spare;
+    while (pBlock != NULL)
     {
-        creq_HeaderField_t *pNewHeader = creq_HeaderField_create_literal(header, value);
-        cvector_push_back(req->header_vector, pNewHeader);
+        _creq_ArenaBlock_t *pPrev = pBlock->prev;
+        creq_free(pBlock);
+        pBlock = pPrev;
     }
-    else
+    // the arena itself lives in the oldest block, so that one goes last
+    pBlock = arena->current;
+    while (pBlock != NULL)
     {
-        creq_HeaderField_t *pNewHeader = creq_HeaderField_create(header, value);
-        cvector_push_back(req->header_vector, pNewHeader);
+        _creq_ArenaBlock_t *pPrev = pBlock->prev;
+        creq_free(pBlock);
+        pBlock = pPrev;
     }
-    return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(creq_HeaderField_t *)
-creq_Request_search_for_header(creq_Request_t *req, char *header)
+/// @return The bytes of all blocks of an arena, including the one holding the arena itself and the spares.
+CREQ_PRIVATE(size_t)
+_creq_Arena_memory_usage(const creq_Arena_t *arena)
 {
-    if (req == NULL || req->header_vector == NULL || header == NULL)
+    size_t bytes = 0;
+    for (const _creq_ArenaBlock_t *pBlock = arena->current; pBlock != NULL; pBlock = pBlock->prev)
     {
-        return NULL;
+        bytes += _CREQ_ARENA_BLOCK_HEADER_SIZE + pBlock->capacity;
     }
-    for (int i = 0; i < cvector_size(req->header_vector); ++i)
+    for (const _creq_ArenaBlock_t *pBlock = arena->spare; pBlock != NULL; pBlock = pBlock->prev)
     {
-        if (!strcmp(req->header_vector[i]->field_name, header))
-        {
-            return req->header_vector[i];
-        }
+        bytes += _CREQ_ARENA_BLOCK_HEADER_SIZE + pBlock->capacity;
     }
-    return NULL;
+    return bytes;
+}
+
+/// @return The bytes of a malloc'ed, NUL-terminated copy of a (pointer, length) field, or 0 for a literal.
+CREQ_PRIVATE(size_t)
+_creq_slice_memory_usage(const char *ptr, size_t len, bool is_literal)
+{
+    return ptr == NULL || is_literal ? 0 : sizeof(char) * (len + 1);
+}
+
+/*
+ * String bin of a heap-backed message.
+ *
+ * creq_Request_reset()/creq_Response_reset() put the strings the message owned here instead of freeing them, and the
+ * copies made for its next contents are taken from the bin whenever a buffer is large enough. A message rebuilt with
+ * similar contents therefore allocates nothing.
+ *
+ * A taken buffer stays on record as lent, so that its true capacity is known when the next reset puts it back. The
+ * idle entries come first, the lent ones after them. A lent buffer released by the message is struck off the record
+ * before it is freed, or a later block at the same address would inherit its capacity. At most
+ * _CREQ_STRING_BIN_MAX_ENTRIES entries are kept; past that the smallest idle buffers are freed.
+ */
+#define _CREQ_STRING_BIN_MAX_ENTRIES 256
+
+typedef struct _creq_StringBinEntry
+{
+    char *ptr;
+    size_t cap;
+    /// Bytes the message asked for when the buffer was lent, 0 while it is idle.
+    size_t used;
+} _creq_StringBinEntry_t;
+
+struct creq_StringBin
+{
+    _creq_StringBinEntry_t *entries;
+    size_t count;
+    size_t capacity;
+    /// Number of idle entries, stored before the lent ones.
+    size_t idle;
+};
+
+CREQ_PRIVATE(creq_StringBin_t *)
+_creq_StringBin_create(void)
+{
+    return (creq_StringBin_t *)_creq_malloc_n_init(sizeof(struct creq_StringBin));
+}
+
+/// @brief Frees the bin and its idle buffers. Lent buffers belong to the message and are left alone.
+CREQ_PRIVATE(void)
+_creq_StringBin_free(creq_StringBin_t *bin)
+{
+    if (bin != NULL)
+    {
+        for (size_t i = 0; i < bin->idle; i++)
+        {
+            creq_free(bin->entries[i].ptr);
+        }
+        creq_free(bin->entries);
+        creq_free(bin);
+    }
+}
+
+/// @return The index of the lent entry of 'ptr', or bin->count if it was not taken from the bin.
+CREQ_PRIVATE(size_t)
+_creq_StringBin_find_lent(const creq_StringBin_t *bin, const char *ptr)
+{
+    size_t i = bin->idle;
+    while (i < bin->count && bin->entries[i].ptr != ptr)
+    {
+        i++;
+    }
+    return i;
+}
+
+/// @brief Hands a buffer over to the bin. 'size' is its capacity unless it was taken from the bin, whose record is
+/// used instead. It is freed if the bin cannot take it.
+CREQ_PRIVATE(void)
+_creq_StringBin_put(creq_StringBin_t *bin, char *ptr, size_t size)
+{
+    size_t i = _creq_StringBin_find_lent(bin, ptr);
+    if (i < bin->count)
+    {
+        _creq_StringBinEntry_t entry = bin->entries[i];
+        entry.used = 0;
+        bin->entries[i] = bin->entries[bin->idle];
+        bin->entries[bin->idle++] = entry;
+        return;
+    }
+    if (bin->count == _CREQ_STRING_BIN_MAX_ENTRIES)
+    {
+        size_t smallest = 0;
+        for (i = 1; i < bin->idle; i++)
+        {
+            if (bin->entries[i].cap < bin->entries[smallest].cap)
+            {
+                smallest = i;
+            }
+        }
+        if (bin->idle == 0 || bin->entries[smallest].cap >= size)
+        {
+            creq_free(ptr);
+            return;
+        }
+        creq_free(bin->entries[smallest].ptr);
+        bin->entries[smallest].ptr = ptr;
+        bin->entries[smallest].cap = size;
+        return;
+    }
+    if (bin->count == bin->capacity)
+    {
+        size_t newCapacity = bin->capacity == 0 ? 16 : bin->capacity * 2;
+        _creq_StringBinEntry_t *pNew = (_creq_StringBinEntry_t *)creq_realloc(
+            bin->entries, sizeof(_creq_StringBinEntry_t) * newCapacity);
+        if (pNew == NULL)
+        {
+            creq_free(ptr);
+            return;
+        }
+        bin->entries = pNew;
+        bin->capacity = newCapacity;
+    }
+    // the first lent entry moves to the end to make room for an idle one
+    bin->entries[bin->count++] = bin->entries[bin->idle];
+    bin->entries[bin->idle].ptr = ptr;
+    bin->entries[bin->idle].cap = size;
+    bin->entries[bin->idle].used = 0;
+    bin->idle++;
+}
+
+/// @return The smallest idle buffer holding at least 'size' bytes, now lent, or NULL if none does.
+CREQ_PRIVATE(char *)
+_creq_StringBin_take(creq_StringBin_t *bin, size_t size)
+{
+    size_t best = bin->idle;
+    for (size_t i = 0; i < bin->idle; i++)
+    {
+        if (bin->entries[i].cap >= size && (best == bin->idle || bin->entries[i].cap < bin->entries[best].cap))
+        {
+            best = i;
+        }
+    }
+    if (best == bin->idle)
+    {
+        return NULL;
+    }
+    _creq_StringBinEntry_t entry = bin->entries[best];
+    entry.used = size;
+    bin->entries[best] = bin->entries[--bin->idle];
+    bin->entries[bin->idle] = entry;
+    return entry.ptr;
+}
+
+/// @brief Strikes a buffer the message is about to free off the record. NULL bins and unknown buffers are ignored.
+CREQ_PRIVATE(void)
+_creq_StringBin_forget(creq_StringBin_t *bin, const char *ptr)
+{
+    if (bin == NULL)
+    {
+        return;
+    }
+    size_t i = _creq_StringBin_find_lent(bin, ptr);
+    if (i < bin->count)
+    {
+        bin->entries[i] = bin->entries[--bin->count];
+    }
+}
+
+/// @return The bytes of the bin itself, its idle buffers and the spare capacity of the lent ones, which the message
+/// counts by the size it asked for.
+CREQ_PRIVATE(size_t)
+_creq_StringBin_memory_usage(const creq_StringBin_t *bin)
+{
+    if (bin == NULL)
+    {
+        return 0;
+    }
+    size_t bytes = sizeof(struct creq_StringBin) + sizeof(_creq_StringBinEntry_t) * bin->capacity;
+    for (size_t i = 0; i < bin->count; i++)
+    {
+        bytes += bin->entries[i].cap - bin->entries[i].used;
+    }
+    return bytes;
+}
+
+/// @brief Copies 'len' bytes into memory owned by a message, NUL-terminating the copy for the string getters.
+/// @param bin The string bin of a heap-backed message to take a buffer from first. May be NULL.
+CREQ_PRIVATE(char *)
+_creq_msg_memdup(creq_Arena_t *arena, creq_StringBin_t *bin, const void *src, size_t len)
+{
+    char *dest = NULL;
+    if (arena != NULL)
+    {
+        dest = (char *)_creq_Arena_alloc(arena, sizeof(char) * (len + 1));
+    }
+    else if (bin == NULL || (dest = _creq_StringBin_take(bin, sizeof(char) * (len + 1))) == NULL)
+    {
+        dest = (char *)creq_malloc(sizeof(char) * (len + 1));
+    }
+    if (dest != NULL)
+    {
+        memcpy(dest, src, len);
+        dest[len] = '\0';
+    }
+    return dest;
+}
+
+/// @brief Releases memory owned by a message. Arena memory is only reclaimed when the whole message is freed.
+#define _CREQ_MSG_FREE(arena, bin, ptr)                                                                                \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ((arena) == NULL)                                                                                           \
+        {                                                                                                              \
+            _creq_StringBin_forget(bin, ptr);                                                                          \
+            CREQ_GUARDED_FREE(ptr);                                                                                    \
+        }                                                                                                              \
+        ptr = NULL;                                                                                                    \
+    } while (0)
+
+/// @brief Replaces a (pointer, length) field of a message, such as its body or request target. On failure the old
+/// value is already released and the field is left empty.
+CREQ_PRIVATE(creq_status_t)
+_creq_slice_set(creq_Arena_t *arena, creq_StringBin_t *bin, char **pBody, size_t *pLen, bool *pLiteral,
+                const void *ptr, size_t len, creq_Ownership_t ownership)
+{
+    if (!*pLiteral)
+        _CREQ_MSG_FREE(arena, bin, *pBody);
+    *pBody = NULL;
+    *pLen = 0;
+    *pLiteral = false;
+    if (ptr == NULL)
+    {
+        return CREQ_STATUS_SUCC;
+    }
+    switch (ownership)
+    {
+    case OWN_BORROW:
+        *pBody = (char *)ptr;
+        *pLiteral = true;
+        break;
+    case OWN_TRANSFER:
+        if (arena == NULL)
+        {
+            *pBody = (char *)ptr;
+            break;
+        }
+        // Arena-backed objects never free individual fields, so the buffer is moved into the arena.
+        *pBody = _creq_msg_memdup(arena, bin, ptr, len);
+        creq_free((void *)ptr);
+        break;
+    default:
+        *pBody = _creq_msg_memdup(arena, bin, ptr, len);
+        break;
+    }
+    if (*pBody == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    *pLen = len;
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PRIVATE(const char *)
+_creq_get_line_ending_str(creq_Config_t *conf, creq_ConfigType_t confType)
+{
+    if (conf == NULL)
+    {
+        return NULL;
+    }
+    creq_LineEnding_t ending = LE_CRLF;
+    if (confType == CONF_REQUEST)
+    {
+        ending = conf->data.request_config.line_ending;
+    }
+    else if (confType == CONF_RESPONSE)
+    {
+        ending = conf->data.response_config.line_ending;
+    }
+    switch (ending)
+    {
+    case LE_CR:
+        return "\r";
+    case LE_LF:
+        return "\n";
+    case LE_CRLF:
+        // fall through
+    default:
+        return "\r\n";
+    }
+}
+
+CREQ_PRIVATE(const char *)
+_creq_get_http_method_str(creq_HttpMethod_t meth)
+{
+    switch (meth)
+    {
+    case METH_GET:
+        return "GET";
+    case METH_HEAD:
+        return "HEAD";
+    case METH_POST:
+        return "POST";
+    case METH_PUT:
+        return "PUT";
+    case METH_DELETE:
+        return "DELETE";
+    case METH_CONNECT:
+        return "CONNECT";
+    case METH_OPTIONS:
+        return "OPTIONS";
+    case METH_TRACE:
+        return "TRACE";
+    default:
+        return NULL;
+    }
+}
+
+/*
+ * Well-known field names. Each entry carries the canonical name and the "Name: " run emitted for headers added by ID,
+ * whose name pointer is the table's own literal. Lookups by ID only compare integers.
+ */
+typedef struct _creq_WellKnownHeader
+{
+    const char *name;
+    const char *prefix;
+    size_t name_len;
+} _creq_WellKnownHeader_t;
+
+#define _CREQ_WELL_KNOWN(id, str) [id] = {str, str ": ", sizeof(str) - 1}
+
+static const _creq_WellKnownHeader_t _creq_well_known_headers[_CREQ_HDR_COUNT] = {
+    [CREQ_HDR_UNKNOWN] = {NULL, NULL, 0},
+    _CREQ_WELL_KNOWN(CREQ_HDR_ACCEPT, "Accept"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ACCEPT_CHARSET, "Accept-Charset"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ACCEPT_ENCODING, "Accept-Encoding"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ACCEPT_LANGUAGE, "Accept-Language"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ACCEPT_RANGES, "Accept-Ranges"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ACCESS_CONTROL_ALLOW_ORIGIN, "Access-Control-Allow-Origin"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_AGE, "Age"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ALLOW, "Allow"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_AUTHORIZATION, "Authorization"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CACHE_CONTROL, "Cache-Control"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONNECTION, "Connection"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONTENT_DISPOSITION, "Content-Disposition"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONTENT_ENCODING, "Content-Encoding"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONTENT_LANGUAGE, "Content-Language"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONTENT_LENGTH, "Content-Length"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONTENT_LOCATION, "Content-Location"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONTENT_RANGE, "Content-Range"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_CONTENT_TYPE, "Content-Type"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_COOKIE, "Cookie"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_DATE, "Date"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ETAG, "ETag"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_EXPECT, "Expect"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_EXPIRES, "Expires"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_FROM, "From"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_HOST, "Host"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_IF_MATCH, "If-Match"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_IF_MODIFIED_SINCE, "If-Modified-Since"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_IF_NONE_MATCH, "If-None-Match"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_IF_RANGE, "If-Range"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_IF_UNMODIFIED_SINCE, "If-Unmodified-Since"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_KEEP_ALIVE, "Keep-Alive"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_LAST_MODIFIED, "Last-Modified"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_LOCATION, "Location"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_MAX_FORWARDS, "Max-Forwards"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_ORIGIN, "Origin"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_PRAGMA, "Pragma"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_PROXY_AUTHENTICATE, "Proxy-Authenticate"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_PROXY_AUTHORIZATION, "Proxy-Authorization"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_RANGE, "Range"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_REFERER, "Referer"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_RETRY_AFTER, "Retry-After"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_SERVER, "Server"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_SET_COOKIE, "Set-Cookie"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_STRICT_TRANSPORT_SECURITY, "Strict-Transport-Security"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_TE, "TE"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_TRAILER, "Trailer"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_TRANSFER_ENCODING, "Transfer-Encoding"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_UPGRADE, "Upgrade"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_USER_AGENT, "User-Agent"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_VARY, "Vary"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_VIA, "Via"),
+    _CREQ_WELL_KNOWN(CREQ_HDR_WWW_AUTHENTICATE, "WWW-Authenticate"),
+};
+
+#define _CREQ_WELL_KNOWN_MAX_LEN (sizeof("Access-Control-Allow-Origin") - 1)
+
+/// Well-known IDs grouped by name length, each row ended by CREQ_HDR_UNKNOWN. Keep it in sync with the table above.
+static const unsigned char _creq_header_ids_by_len[_CREQ_WELL_KNOWN_MAX_LEN + 1][7] = {
+    [2] = {CREQ_HDR_TE},
+    [3] = {CREQ_HDR_AGE, CREQ_HDR_VIA},
+    [4] = {CREQ_HDR_DATE, CREQ_HDR_ETAG, CREQ_HDR_FROM, CREQ_HDR_HOST, CREQ_HDR_VARY},
+    [5] = {CREQ_HDR_ALLOW, CREQ_HDR_RANGE},
+    [6] = {CREQ_HDR_ACCEPT, CREQ_HDR_COOKIE, CREQ_HDR_EXPECT, CREQ_HDR_ORIGIN, CREQ_HDR_PRAGMA, CREQ_HDR_SERVER},
+    [7] = {CREQ_HDR_EXPIRES, CREQ_HDR_REFERER, CREQ_HDR_TRAILER, CREQ_HDR_UPGRADE},
+    [8] = {CREQ_HDR_IF_MATCH, CREQ_HDR_IF_RANGE, CREQ_HDR_LOCATION},
+    [10] = {CREQ_HDR_CONNECTION, CREQ_HDR_KEEP_ALIVE, CREQ_HDR_SET_COOKIE, CREQ_HDR_USER_AGENT},
+    [11] = {CREQ_HDR_RETRY_AFTER},
+    [12] = {CREQ_HDR_CONTENT_TYPE, CREQ_HDR_MAX_FORWARDS},
+    [13] = {CREQ_HDR_ACCEPT_RANGES, CREQ_HDR_AUTHORIZATION, CREQ_HDR_CACHE_CONTROL, CREQ_HDR_CONTENT_RANGE,
+             CREQ_HDR_IF_NONE_MATCH, CREQ_HDR_LAST_MODIFIED},
+    [14] = {CREQ_HDR_ACCEPT_CHARSET, CREQ_HDR_CONTENT_LENGTH},
+    [15] = {CREQ_HDR_ACCEPT_ENCODING, CREQ_HDR_ACCEPT_LANGUAGE},
+    [16] = {CREQ_HDR_CONTENT_ENCODING, CREQ_HDR_CONTENT_LANGUAGE, CREQ_HDR_CONTENT_LOCATION, CREQ_HDR_WWW_AUTHENTICATE},
+    [17] = {CREQ_HDR_IF_MODIFIED_SINCE, CREQ_HDR_TRANSFER_ENCODING},
+    [18] = {CREQ_HDR_PROXY_AUTHENTICATE},
+    [19] = {CREQ_HDR_CONTENT_DISPOSITION, CREQ_HDR_IF_UNMODIFIED_SINCE, CREQ_HDR_PROXY_AUTHORIZATION},
+    [25] = {CREQ_HDR_STRICT_TRANSPORT_SECURITY},
+    [27] = {CREQ_HDR_ACCESS_CONTROL_ALLOW_ORIGIN},
+};
+
+/// @brief Case-insensitive comparison of two field names of the same length 'len', as field names are
+/// case-insensitive per RFC 7230 Section 3.2.
+CREQ_PRIVATE(bool)
+_creq_header_name_eq(const char *a, const char *b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char ca = (unsigned char)a[i], cb = (unsigned char)b[i];
+        if (ca != cb)
+        {
+            ca = ca >= 'A' && ca <= 'Z' ? ca + ('a' - 'A') : ca;
+            cb = cb >= 'A' && cb <= 'Z' ? cb + ('a' - 'A') : cb;
+            if (ca != cb)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+CREQ_PRIVATE(creq_HeaderId_t)
+_creq_header_id_n(const char *header, size_t len)
+{
+    if (len == 0 || len > _CREQ_WELL_KNOWN_MAX_LEN)
+    {
+        return CREQ_HDR_UNKNOWN;
+    }
+    // at most a handful of names share a length, and the first character rules out nearly all of them
+    unsigned char first = (unsigned char)header[0] | 0x20;
+    for (const unsigned char *pId = _creq_header_ids_by_len[len]; *pId != CREQ_HDR_UNKNOWN; pId++)
+    {
+        const _creq_WellKnownHeader_t *pKnown = &_creq_well_known_headers[*pId];
+        if (((unsigned char)pKnown->name[0] | 0x20) == first && _creq_header_name_eq(pKnown->name, header, len))
+        {
+            return (creq_HeaderId_t)*pId;
+        }
+    }
+    return CREQ_HDR_UNKNOWN;
+}
+
+CREQ_PUBLIC(creq_HeaderId_t)
+creq_get_header_id(const char *header)
+{
+    if (header == NULL)
+    {
+        return CREQ_HDR_UNKNOWN;
+    }
+    return _creq_header_id_n(header, strlen(header));
+}
+
+CREQ_PUBLIC(const char *)
+creq_get_header_name(creq_HeaderId_t id)
+{
+    if (id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT)
+    {
+        return NULL;
+    }
+    return _creq_well_known_headers[id].name;
+}
+
+/// @brief Gets the bytes emitted for a header's name: "Name: " for headers added by ID, the bare name otherwise.
+CREQ_PRIVATE(const char *)
+_creq_HeaderField_name_piece(const creq_HeaderField_t *pField, size_t *len, size_t *separatorLen)
+{
+    const _creq_WellKnownHeader_t *pKnown = &_creq_well_known_headers[pField->field_id];
+    if (pField->is_field_name_static)
+    {
+        *len = pKnown->name_len + 2;
+        *separatorLen = 0;
+        return pKnown->prefix;
+    }
+    *len = pField->field_name_len;
+    *separatorLen = 2;
+    return pField->field_name;
+}
+
+/*
+ * Serializer core.
+ *
+ * A message is laid out as a fixed sequence of pieces: six start-line pieces (including its line ending), four pieces
+ * per header field (name, separator, value, line ending), the terminating empty line and the body. Both requests and
+ * responses are first captured into a _creq_MessageView_t, after which measuring and emitting never needs to format
+ * anything. The view keeps small scratch buffers for the numeric parts of the start line, so it must not be copied.
+ */
+#define _CREQ_START_LINE_PIECES 6
+#define _CREQ_NUM_BUF_LEN 24
+
+typedef struct _creq_MessageView
+{
+    const char *start_line[_CREQ_START_LINE_PIECES];
+    size_t start_line_len[_CREQ_START_LINE_PIECES];
+    const creq_HeaderField_t *header_vector;
+    size_t header_count;
+    /// Headers of the attached profile, emitted before header_vector. Bit i of profile_hidden set means the message
+    /// overrides profile_vector[i].
+    const creq_HeaderField_t *profile_vector;
+    size_t profile_count;
+    uint64_t profile_hidden;
+    const char *line_ending;
+    size_t line_ending_len;
+    const char *body;
+    size_t body_len;
+    char version_buf[_CREQ_NUM_BUF_LEN * 2];
+    char status_code_buf[_CREQ_NUM_BUF_LEN];
+} _creq_MessageView_t;
+
+/// @attention Writes no NUL terminator. 'out' must hold at least _CREQ_NUM_BUF_LEN chars.
+CREQ_PRIVATE(size_t)
+_creq_format_uint(unsigned long long value, char *out)
+{
+    char tmp[_CREQ_NUM_BUF_LEN];
+    size_t len = 0;
+    do
+    {
+        tmp[len++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = tmp[len - 1 - i];
+    }
+    return len;
+}
+
+/// @attention Writes no NUL terminator. 'out' must hold at least _CREQ_NUM_BUF_LEN chars.
+CREQ_PRIVATE(size_t)
+_creq_format_int(long long value, char *out)
+{
+    if (value < 0)
+    {
+        out[0] = '-';
+        return 1 + _creq_format_uint(0ULL - (unsigned long long)value, out + 1);
+    }
+    return _creq_format_uint((unsigned long long)value, out);
+}
+
+/// @attention Writes no NUL terminator. 'out' must hold at least 2 * sizeof(size_t) chars.
+CREQ_PRIVATE(size_t)
+_creq_format_hex(size_t value, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    char tmp[2 * sizeof(size_t)];
+    size_t len = 0;
+    do
+    {
+        tmp[len++] = digits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = tmp[len - 1 - i];
+    }
+    return len;
+}
+
+/// @brief Formats "HTTP/major.minor" into 'out' and returns its length.
+CREQ_PRIVATE(size_t)
+_creq_format_http_version(creq_HttpVersion_t ver, char *out)
+{
+    size_t len = 0;
+    memcpy(out, "HTTP/", 5);
+    len += 5;
+    len += _creq_format_uint(ver.major, out + len);
+    out[len++] = '.';
+    len += _creq_format_uint(ver.minor, out + len);
+    return len;
+}
+
+/*
+ * Status codes registered with IANA and their reason phrases, RFC 9110 Section 15. Every status line of HTTP/1.0 and
+ * HTTP/1.1 with one of these is prerendered for each line ending, so that it is emitted as one piece.
+ */
+#define _CREQ_STATUS_CODES(X)                                                                                          \
+    X(100, "Continue")                                                                                                 \
+    X(101, "Switching Protocols")                                                                                      \
+    X(102, "Processing")                                                                                               \
+    X(103, "Early Hints")                                                                                              \
+    X(200, "OK")                                                                                                       \
+    X(201, "Created")                                                                                                  \
+    X(202, "Accepted")                                                                                                 \
+    X(203, "Non-Authoritative Information")                                                                            \
+    X(204, "No Content")                                                                                               \
+    X(205, "Reset Content")                                                                                            \
+    X(206, "Partial Content")                                                                                          \
+    X(207, "Multi-Status")                                                                                             \
+    X(208, "Already Reported")                                                                                         \
+    X(226, "IM Used")                                                                                                  \
+    X(300, "Multiple Choices")                                                                                         \
+    X(301, "Moved Permanently")                                                                                        \
+    X(302, "Found")                                                                                                    \
+    X(303, "See Other")                                                                                                \
+    X(304, "Not Modified")                                                                                             \
+    X(305, "Use Proxy")                                                                                                \
+    X(307, "Temporary Redirect")                                                                                       \
+    X(308, "Permanent Redirect")                                                                                       \
+    X(400, "Bad Request")                                                                                              \
+    X(401, "Unauthorized")                                                                                             \
+    X(402, "Payment Required")                                                                                         \
+    X(403, "Forbidden")                                                                                                \
+    X(404, "Not Found")                                                                                                \
+    X(405, "Method Not Allowed")                                                                                       \
+    X(406, "Not Acceptable")                                                                                           \
+    X(407, "Proxy Authentication Required")                                                                            \
+    X(408, "Request Timeout")                                                                                          \
+    X(409, "Conflict")                                                                                                 \
+    X(410, "Gone")                                                                                                     \
+    X(411, "Length Required")                                                                                          \
+    X(412, "Precondition Failed")                                                                                      \
+    X(413, "Content Too Large")                                                                                        \
+    X(414, "URI Too Long")                                                                                             \
+    X(415, "Unsupported Media Type")                                                                                   \
+    X(416, "Range Not Satisfiable")                                                                                    \
+    X(417, "Expectation Failed")                                                                                       \
+    X(421, "Misdirected Request")                                                                                      \
+    X(422, "Unprocessable Content")                                                                                    \
+    X(423, "Locked")                                                                                                   \
+    X(424, "Failed Dependency")                                                                                        \
+    X(425, "Too Early")                                                                                                \
+    X(426, "Upgrade Required")                                                                                         \
+    X(428, "Precondition Required")                                                                                    \
+    X(429, "Too Many Requests")                                                                                        \
+    X(431, "Request Header Fields Too Large")                                                                          \
+    X(451, "Unavailable For Legal Reasons")                                                                            \
+    X(500, "Internal Server Error")                                                                                    \
+    X(501, "Not Implemented")                                                                                          \
+    X(502, "Bad Gateway")                                                                                              \
+    X(503, "Service Unavailable")                                                                                      \
+    X(504, "Gateway Timeout")                                                                                          \
+    X(505, "HTTP Version Not Supported")                                                                               \
+    X(506, "Variant Also Negotiates")                                                                                  \
+    X(507, "Insufficient Storage")                                                                                     \
+    X(508, "Loop Detected")                                                                                            \
+    X(510, "Not Extended")                                                                                             \
+    X(511, "Network Authentication Required")
+
+#define _CREQ_STATUS_ENUM(code, reason) _CREQ_STATUS_##code,
+enum
+{
+    _CREQ_STATUS_NONE,
+    _CREQ_STATUS_CODES(_CREQ_STATUS_ENUM) _CREQ_STATUS_COUNT
+};
+
+#define _CREQ_STATUS_INDEX(code, reason) [(code) - 100] = _CREQ_STATUS_##code,
+
+/// Position in _creq_status_lines of each code from 100 to 599, 0 for unregistered ones.
+static const unsigned char _creq_status_index[500] = {_CREQ_STATUS_CODES(_CREQ_STATUS_INDEX)};
+
+typedef struct _creq_StatusLine
+{
+    const char *reason;
+    size_t reason_len;
+    /// Indexed by the minor version, then by creq_LineEnding_t.
+    const char *lines[2][3];
+} _creq_StatusLine_t;
+
+#define _CREQ_STATUS_LINES(minor, code, reason)                                                                        \
+    {"HTTP/1." minor " " #code " " reason "\r", "HTTP/1." minor " " #code " " reason "\n",                             \
+     "HTTP/1." minor " " #code " " reason "\r\n"}
+#define _CREQ_STATUS_ENTRY(code, reason)                                                                               \
+    [_CREQ_STATUS_##code] = {reason, sizeof(reason) - 1,                                                               \
+                             {_CREQ_STATUS_LINES("0", code, reason), _CREQ_STATUS_LINES("1", code, reason)}},
+
+static const _creq_StatusLine_t _creq_status_lines[_CREQ_STATUS_COUNT] = {_CREQ_STATUS_CODES(_CREQ_STATUS_ENTRY)};
+
+/// @return The registered status 'code', or NULL.
+CREQ_PRIVATE(const _creq_StatusLine_t *)
+_creq_status_line_find(int code)
+{
+    if (code < 100 || code > 599 || _creq_status_index[code - 100] == _CREQ_STATUS_NONE)
+    {
+        return NULL;
+    }
+    return &_creq_status_lines[_creq_status_index[code - 100]];
+}
+
+CREQ_PRIVATE(void)
+_creq_view_set_piece(_creq_MessageView_t *view, int idx, const char *str)
+{
+    view->start_line[idx] = str == NULL ? "" : str;
+    view->start_line_len[idx] = str == NULL ? 0 : strlen(str);
+}
+
+CREQ_PRIVATE(void)
+_creq_view_set_slice(_creq_MessageView_t *view, int idx, const char *str, size_t len)
+{
+    view->start_line[idx] = str == NULL ? "" : str;
+    view->start_line_len[idx] = str == NULL ? 0 : len;
+}
+
+CREQ_PRIVATE(void)
+_creq_view_init_common(_creq_MessageView_t *view, creq_Config_t *conf, creq_ConfigType_t confType,
+                       const creq_HeaderField_t *headerVector, const char *body, size_t bodyLen)
+{
+    view->line_ending = _creq_get_line_ending_str(conf, confType);
+    view->line_ending_len = strlen(view->line_ending);
+    view->start_line[_CREQ_START_LINE_PIECES - 1] = view->line_ending;
+    view->start_line_len[_CREQ_START_LINE_PIECES - 1] = view->line_ending_len;
+    view->header_vector = headerVector;
+    view->header_count = cvector_size(headerVector);
+    view->profile_vector = NULL;
+    view->profile_count = 0;
+    view->profile_hidden = 0;
+    view->body = body == NULL ? "" : body;
+    view->body_len = body == NULL ? 0 : bodyLen;
+}
+
+CREQ_PRIVATE(void)
+_creq_view_attach_profile(_creq_MessageView_t *view, creq_HeaderProfile_t *profile, creq_HeaderField_t *headerVector,
+                          creq_HeaderIndex_t *index);
+
+CREQ_PRIVATE(void)
+_creq_view_from_request(_creq_MessageView_t *view, creq_Request_t *req)
+{
+    _creq_view_init_common(view, &req->config, CONF_REQUEST, req->header_vector, req->message_body,
+                           req->message_body_len);
+    _creq_view_attach_profile(view, req->header_profile, req->header_vector, req->header_index);
+    _creq_view_set_piece(view, 0, _creq_get_http_method_str(req->method));
+    _creq_view_set_piece(view, 1, " ");
+    _creq_view_set_slice(view, 2, req->request_target, req->request_target_len);
+    _creq_view_set_piece(view, 3, " ");
+    view->start_line[4] = view->version_buf;
+    view->start_line_len[4] = _creq_format_http_version(req->http_version, view->version_buf);
+}
+
+/// @return The prerendered status line of 'resp', or NULL if it has a custom reason phrase or is not HTTP/1.0 or 1.1.
+CREQ_PRIVATE(const char *)
+_creq_Response_standard_status_line(const creq_Response_t *resp, size_t *len)
+{
+    creq_LineEnding_t ending = resp->config.data.response_config.line_ending;
+    const _creq_StatusLine_t *pStatus = _creq_status_line_find(resp->status_code);
+    if (pStatus == NULL || resp->http_version.major != 1 || (unsigned)resp->http_version.minor > 1 ||
+        (unsigned)ending > LE_CRLF || resp->reason_phrase_len != pStatus->reason_len ||
+        (resp->reason_phrase != pStatus->reason && memcmp(resp->reason_phrase, pStatus->reason, pStatus->reason_len)))
+    {
+        return NULL;
+    }
+    // HTTP/1.x SP 3DIGIT SP reason line-ending
+    *len = 13 + pStatus->reason_len + (ending == LE_CRLF ? 2 : 1);
+    return pStatus->lines[resp->http_version.minor][ending];
+}
+
+CREQ_PRIVATE(void)
+_creq_view_from_response(_creq_MessageView_t *view, creq_Response_t *resp)
+{
+    _creq_view_init_common(view, &resp->config, CONF_RESPONSE, resp->header_vector, resp->message_body,
+                           resp->message_body_len);
+    _creq_view_attach_profile(view, resp->header_profile, resp->header_vector, resp->header_index);
+    size_t lineLen = 0;
+    const char *line = _creq_Response_standard_status_line(resp, &lineLen);
+    if (line != NULL)
+    {
+        _creq_view_set_slice(view, 0, line, lineLen);
+        for (int i = 1; i < _CREQ_START_LINE_PIECES; i++)
+        {
+            _creq_view_set_slice(view, i, "", 0);
+        }
+        return;
+    }
+    view->start_line[0] = view->version_buf;
+    view->start_line_len[0] = _creq_format_http_version(resp->http_version, view->version_buf);
+    _creq_view_set_piece(view, 1, " ");
+    view->start_line[2] = view->status_code_buf;
+    view->start_line_len[2] = _creq_format_int(resp->status_code, view->status_code_buf);
+    _creq_view_set_piece(view, 3, " ");
+    _creq_view_set_slice(view, 4, resp->reason_phrase, resp->reason_phrase_len);
+}
+
+/// @brief Length of a "name: value" line including its line ending.
+CREQ_PRIVATE(size_t)
+_creq_HeaderField_line_length(const creq_HeaderField_t *pField, size_t lineEndingLen)
+{
+    size_t nameLen = 0, separatorLen = 0;
+    _creq_HeaderField_name_piece(pField, &nameLen, &separatorLen);
+    return nameLen + separatorLen + pField->field_value_len + lineEndingLen;
+}
+
+/// @brief Writes a "name: value" line including its line ending and returns the end of the output.
+CREQ_PRIVATE(char *)
+_creq_HeaderField_emit_line(const creq_HeaderField_t *pField, char *dest, const char *lineEnding, size_t lineEndingLen)
+{
+    size_t nameLen = 0, separatorLen = 0;
+    const char *name = _creq_HeaderField_name_piece(pField, &nameLen, &separatorLen);
+    memcpy(dest, name, nameLen);
+    dest += nameLen;
+    memcpy(dest, ": ", separatorLen);
+    dest += separatorLen;
+    memcpy(dest, pField->field_value, pField->field_value_len);
+    dest += pField->field_value_len;
+    memcpy(dest, lineEnding, lineEndingLen);
+    return dest + lineEndingLen;
+}
+
+CREQ_PRIVATE(bool)
+_creq_view_has_no_headers(const _creq_MessageView_t *view)
+{
+    // profile headers are only ever hidden by message headers, or by the chunked encoder when it adds one, so the
+    // block is empty only when both lists are
+    return view->header_count == 0 && view->profile_count == 0;
+}
+
+/// @brief Leaves every profile header with a well-known 'id' out of the view.
+CREQ_PRIVATE(void)
+_creq_view_hide_profile_id(_creq_MessageView_t *view, creq_HeaderId_t id)
+{
+    for (size_t i = 0; i < view->profile_count; i++)
+    {
+        if (view->profile_vector[i].field_id == id)
+            view->profile_hidden |= (uint64_t)1 << i;
+    }
+}
+
+/// @brief Computes the exact number of bytes _creq_view_emit() will write.
+CREQ_PRIVATE(size_t)
+_creq_view_length(const _creq_MessageView_t *view)
+{
+    size_t len = 0;
+    for (int i = 0; i < _CREQ_START_LINE_PIECES; i++)
+    {
+        len += view->start_line_len[i];
+    }
+    for (size_t i = 0; i < view->profile_count; i++)
+    {
+        if (!(view->profile_hidden >> i & 1))
+            len += _creq_HeaderField_line_length(&view->profile_vector[i], view->line_ending_len);
+    }
+    for (size_t i = 0; i < view->header_count; i++)
+    {
+        len += _creq_HeaderField_line_length(&view->header_vector[i], view->line_ending_len);
+    }
+    // a message without headers still gets a line ending in place of the header block
+    if (_creq_view_has_no_headers(view))
+    {
+        len += view->line_ending_len;
+    }
+    len += view->line_ending_len + view->body_len;
+    return len;
+}
+
+/// @brief Writes the message into 'dest', which must hold _creq_view_length() bytes. Returns the end of the output.
+CREQ_PRIVATE(char *)
+_creq_view_emit(const _creq_MessageView_t *view, char *dest)
+{
+    for (int i = 0; i < _CREQ_START_LINE_PIECES; i++)
+    {
+        memcpy(dest, view->start_line[i], view->start_line_len[i]);
+        dest += view->start_line_len[i];
+    }
+    for (size_t i = 0; i < view->profile_count; i++)
+    {
+        if (!(view->profile_hidden >> i & 1))
+            dest = _creq_HeaderField_emit_line(&view->profile_vector[i], dest, view->line_ending,
+                                               view->line_ending_len);
+    }
+    for (size_t i = 0; i < view->header_count; i++)
+    {
+        dest = _creq_HeaderField_emit_line(&view->header_vector[i], dest, view->line_ending, view->line_ending_len);
+    }
+    if (_creq_view_has_no_headers(view))
+    {
+        memcpy(dest, view->line_ending, view->line_ending_len);
+        dest += view->line_ending_len;
+    }
+    memcpy(dest, view->line_ending, view->line_ending_len);
+    dest += view->line_ending_len;
+    memcpy(dest, view->body, view->body_len);
+    return dest + view->body_len;
+}
+
+/// @brief Number of pieces a view is made of. Pieces may be empty.
+CREQ_PRIVATE(size_t)
+_creq_view_piece_count(const _creq_MessageView_t *view)
+{
+    return _CREQ_START_LINE_PIECES + (view->profile_count + view->header_count) * 4 + 3;
+}
+
+/// @brief Random access to the pieces of a view, in output order.
+CREQ_PRIVATE(const char *)
+_creq_view_piece(const _creq_MessageView_t *view, size_t idx, size_t *len)
+{
+    if (idx < _CREQ_START_LINE_PIECES)
+    {
+        *len = view->start_line_len[idx];
+        return view->start_line[idx];
+    }
+    idx -= _CREQ_START_LINE_PIECES;
+    size_t fieldCount = view->profile_count + view->header_count;
+    if (idx < fieldCount * 4)
+    {
+        size_t field = idx / 4;
+        const creq_HeaderField_t *pField = field < view->profile_count
+                                               ? &view->profile_vector[field]
+                                               : &view->header_vector[field - view->profile_count];
+        size_t separatorLen = 0;
+        if (field < view->profile_count && (view->profile_hidden >> field & 1))
+        {
+            *len = 0;
+            return "";
+        }
+        switch (idx % 4)
+        {
+        case 0:
+            return _creq_HeaderField_name_piece(pField, len, &separatorLen);
+        case 1:
+            _creq_HeaderField_name_piece(pField, len, &separatorLen);
+            *len = separatorLen;
+            return ": ";
+        case 2:
+            *len = pField->field_value_len;
+            return pField->field_value;
+        default:
+            *len = view->line_ending_len;
+            return view->line_ending;
+        }
+    }
+    idx -= fieldCount * 4;
+    switch (idx)
+    {
+    case 0:
+        *len = _creq_view_has_no_headers(view) ? view->line_ending_len : 0;
+        return view->line_ending;
+    case 1:
+        *len = view->line_ending_len;
+        return view->line_ending;
+    default:
+        *len = view->body_len;
+        return view->body;
+    }
+}
+
+/// @brief Moves the numeric start-line pieces out of the view into caller-owned storage.
+CREQ_PRIVATE(void)
+_creq_view_relocate_scratch(_creq_MessageView_t *view, creq_IoVecScratch_t *scratch)
+{
+    char *pFree = scratch->data;
+    for (int i = 0; i < _CREQ_START_LINE_PIECES; i++)
+    {
+        if (view->start_line[i] == view->version_buf || view->start_line[i] == view->status_code_buf)
+        {
+            memcpy(pFree, view->start_line[i], view->start_line_len[i]);
+            view->start_line[i] = pFree;
+            pFree += view->start_line_len[i];
+        }
+    }
+}
+
+/// @brief Shared implementation of the *_to_iovec() family. Empty pieces are skipped.
+CREQ_PRIVATE(size_t)
+_creq_view_to_iovec(_creq_MessageView_t *view, creq_IoVec_t *iov, size_t iovCap, creq_IoVecScratch_t *scratch,
+                    size_t *needed)
+{
+    size_t count = 0, total = _creq_view_piece_count(view), len = 0;
+    for (size_t i = 0; i < total; i++)
+    {
+        _creq_view_piece(view, i, &len);
+        if (len != 0)
+        {
+            count++;
+        }
+    }
+    if (needed != NULL)
+    {
+        *needed = count;
+    }
+    if (iov == NULL || scratch == NULL || iovCap < count)
+    {
+        return 0;
+    }
+    _creq_view_relocate_scratch(view, scratch);
+    count = 0;
+    for (size_t i = 0; i < total; i++)
+    {
+        const char *ptr = _creq_view_piece(view, i, &len);
+        if (len != 0)
+        {
+            iov[count].iov_base = (void *)ptr;
+            iov[count].iov_len = len;
+            count++;
+        }
+    }
+    return count;
+}
+
+/// @brief Shared implementation of the *_stringify() family: one exact-sized allocation, no formatting.
+CREQ_PRIVATE(char *)
+_creq_view_stringify(const _creq_MessageView_t *view)
+{
+    size_t len = _creq_view_length(view);
+    char *str = (char *)creq_malloc(sizeof(char) * (len + 1));
+    if (str == NULL)
+    {
+        return NULL;
+    }
+    *_creq_view_emit(view, str) = '\0';
+    return str;
+}
+
+/// @brief Shared implementation of the *_stringify_into() family.
+CREQ_PRIVATE(size_t)
+_creq_view_stringify_into(const _creq_MessageView_t *view, char *buf, size_t cap, size_t *needed)
+{
+    size_t len = _creq_view_length(view);
+    if (needed != NULL)
+    {
+        *needed = len;
+    }
+    if (buf == NULL || cap < len)
+    {
+        return 0;
+    }
+    _creq_view_emit(view, buf);
+    return len;
+}
+
+/*
+ * Serialization cache (creq_*_stringify_cached()).
+ *
+ * The last output is kept along with the byte range of its start line and of each line of header_vector, one segment
+ * per record. Setters mark what they change and segments follow the records as they are added and removed, so the
+ * next output copies clean ranges from the previous one and only formats dirty lines. Profile lines and the body are
+ * copied from their sources on every rebuild. Changes that cannot be told apart, such as parsing, drop all segments.
+ */
+typedef struct _creq_SerialSegment
+{
+    size_t offset;
+    size_t len;
+    bool is_dirty;
+} _creq_SerialSegment_t;
+
+struct creq_SerialCache
+{
+    /// The last output, NUL-terminated.
+    char *buf;
+    size_t len;
+    size_t cap;
+    /// Where the next output is built before it is swapped with buf.
+    char *spare;
+    size_t spare_cap;
+    /// Cleared by every change. buf is handed out as-is while it is set.
+    bool is_clean;
+    /// Cleared when the segments no longer describe buf, so that the next output starts from scratch.
+    bool is_valid;
+    bool is_start_line_dirty;
+    size_t start_line_len;
+    _creq_SerialSegment_t *segments;
+    size_t segment_count;
+    size_t segment_cap;
+};
+
+CREQ_PRIVATE(void)
+_creq_serial_cache_free(creq_SerialCache_t *cache)
+{
+    if (cache != NULL)
+    {
+        creq_free(cache->buf);
+        creq_free(cache->spare);
+        creq_free(cache->segments);
+        creq_free(cache);
+    }
+}
+
+CREQ_PRIVATE(size_t)
+_creq_serial_cache_memory_usage(const creq_SerialCache_t *cache)
+{
+    if (cache == NULL)
+    {
+        return 0;
+    }
+    return sizeof(struct creq_SerialCache) + cache->cap + cache->spare_cap +
+           sizeof(_creq_SerialSegment_t) * cache->segment_cap;
+}
+
+/// @brief Notes a change of the body or the profile, which are copied anew anyway. 'cache' may be NULL.
+CREQ_PRIVATE(void)
+_creq_serial_cache_touch(creq_SerialCache_t *cache)
+{
+    if (cache != NULL)
+    {
+        cache->is_clean = false;
+    }
+}
+
+/// @brief Notes a change that is not tracked per segment. 'cache' may be NULL.
+CREQ_PRIVATE(void)
+_creq_serial_cache_invalidate(creq_SerialCache_t *cache)
+{
+    if (cache != NULL)
+    {
+        cache->is_clean = false;
+        cache->is_valid = false;
+    }
+}
+
+CREQ_PRIVATE(void)
+_creq_serial_cache_touch_start_line(creq_SerialCache_t *cache)
+{
+    if (cache != NULL)
+    {
+        cache->is_clean = false;
+        cache->is_start_line_dirty = true;
+    }
+}
+
+/// @return Whether the segment array holds at least 'count' entries, growing it if needed.
+CREQ_PRIVATE(bool)
+_creq_serial_cache_reserve(creq_SerialCache_t *cache, size_t count)
+{
+    if (count <= cache->segment_cap)
+    {
+        return true;
+    }
+    size_t capacity = cache->segment_cap == 0 ? CREQ_INLINE_HEADER_CAPACITY : cache->segment_cap;
+    while (capacity < count)
+    {
+        capacity *= 2;
+    }
+    _creq_SerialSegment_t *segments =
+        (_creq_SerialSegment_t *)creq_realloc(cache->segments, sizeof(_creq_SerialSegment_t) * capacity);
+    if (segments == NULL)
+    {
+        return false;
+    }
+    cache->segments = segments;
+    cache->segment_cap = capacity;
+    return true;
+}
+
+/// @brief Follows a record appended to header_vector.
+CREQ_PRIVATE(void)
+_creq_serial_cache_header_added(creq_SerialCache_t *cache)
+{
+    if (cache == NULL || !cache->is_valid)
+    {
+        _creq_serial_cache_touch(cache);
+        return;
+    }
+    if (!_creq_serial_cache_reserve(cache, cache->segment_count + 1))
+    {
+        _creq_serial_cache_invalidate(cache);
+        return;
+    }
+    _creq_SerialSegment_t *pSegment = &cache->segments[cache->segment_count++];
+    pSegment->offset = 0;
+    pSegment->len = 0;
+    pSegment->is_dirty = true;
+    cache->is_clean = false;
+}
+
+/// @brief Follows a change to the record at 'idx' of header_vector.
+CREQ_PRIVATE(void)
+_creq_serial_cache_header_changed(creq_SerialCache_t *cache, size_t idx)
+{
+    _creq_serial_cache_touch(cache);
+    if (cache != NULL && cache->is_valid && idx < cache->segment_count)
+    {
+        cache->segments[idx].is_dirty = true;
+    }
+}
+
+/// @brief Follows the record at 'idx' being erased from header_vector.
+CREQ_PRIVATE(void)
+_creq_serial_cache_header_removed(creq_SerialCache_t *cache, size_t idx)
+{
+    _creq_serial_cache_touch(cache);
+    if (cache != NULL && cache->is_valid && idx < cache->segment_count)
+    {
+        memmove(&cache->segments[idx], &cache->segments[idx + 1],
+                sizeof(_creq_SerialSegment_t) * (cache->segment_count - idx - 1));
+        cache->segment_count--;
+    }
+}
+
+/// @brief Follows the record at 'from' moving down to 'to' while header_vector is compacted.
+CREQ_PRIVATE(void)
+_creq_serial_cache_header_moved(creq_SerialCache_t *cache, size_t from, size_t to)
+{
+    if (cache != NULL && cache->is_valid && from < cache->segment_count)
+    {
+        cache->segments[to] = cache->segments[from];
+    }
+}
+
+/// @brief Follows header_vector being cut down to 'count' records once a compaction is done.
+CREQ_PRIVATE(void)
+_creq_serial_cache_headers_truncated(creq_SerialCache_t *cache, size_t count)
+{
+    _creq_serial_cache_touch(cache);
+    if (cache != NULL && cache->is_valid && count < cache->segment_count)
+    {
+        cache->segment_count = count;
+    }
+}
+
+/// @brief Brings the cached output up to date with 'view'. Clean ranges are copied from the previous output.
+/// @return The output, or NULL on allocation failure, in which case the cache starts from scratch next time.
+CREQ_PRIVATE(const char *)
+_creq_serial_cache_build(creq_SerialCache_t *cache, const _creq_MessageView_t *view, size_t *len)
+{
+    bool fromScratch = !cache->is_valid || cache->segment_count != view->header_count;
+    if (fromScratch)
+    {
+        if (!_creq_serial_cache_reserve(cache, view->header_count))
+        {
+            return NULL;
+        }
+        for (size_t i = 0; i < view->header_count; i++)
+        {
+            cache->segments[i].is_dirty = true;
+        }
+        cache->segment_count = view->header_count;
+        cache->is_start_line_dirty = true;
+    }
+    // the previous output must stay intact while it is copied from, so the new one goes into the spare buffer
+    cache->is_valid = false;
+
+    size_t startLen = cache->start_line_len, total = 0;
+    if (cache->is_start_line_dirty)
+    {
+        startLen = 0;
+        for (int i = 0; i < _CREQ_START_LINE_PIECES; i++)
+        {
+            startLen += view->start_line_len[i];
+        }
+    }
+    total += startLen;
+    for (size_t i = 0; i < view->profile_count; i++)
+    {
+        if (!(view->profile_hidden >> i & 1))
+            total += _creq_HeaderField_line_length(&view->profile_vector[i], view->line_ending_len);
+    }
+    for (size_t i = 0; i < view->header_count; i++)
+    {
+        const _creq_SerialSegment_t *pSegment = &cache->segments[i];
+        total += pSegment->is_dirty ? _creq_HeaderField_line_length(&view->header_vector[i], view->line_ending_len)
+                                    : pSegment->len;
+    }
+    if (_creq_view_has_no_headers(view))
+    {
+        total += view->line_ending_len;
+    }
+    total += view->line_ending_len + view->body_len;
+
+    if (fromScratch && cache->spare_cap < total + 1 && cache->cap >= total + 1)
+    {
+        // nothing is copied from the previous output, so its buffer can take the new one
+        char *previous = cache->buf;
+        size_t previousCap = cache->cap;
+        cache->buf = cache->spare;
+        cache->cap = cache->spare_cap;
+        cache->spare = previous;
+        cache->spare_cap = previousCap;
+    }
+    if (cache->spare_cap < total + 1)
+    {
+        char *spare = (char *)creq_realloc(cache->spare, sizeof(char) * (total + 1));
+        if (spare == NULL)
+        {
+            return NULL;
+        }
+        cache->spare = spare;
+        cache->spare_cap = total + 1;
+    }
+
+    char *dest = cache->spare;
+    if (cache->is_start_line_dirty)
+    {
+        for (int i = 0; i < _CREQ_START_LINE_PIECES; i++)
+        {
+            memcpy(dest, view->start_line[i], view->start_line_len[i]);
+            dest += view->start_line_len[i];
+        }
+    }
+    else
+    {
+        memcpy(dest, cache->buf, startLen);
+        dest += startLen;
+    }
+    for (size_t i = 0; i < view->profile_count; i++)
+    {
+        if (!(view->profile_hidden >> i & 1))
+            dest = _creq_HeaderField_emit_line(&view->profile_vector[i], dest, view->line_ending,
+                                               view->line_ending_len);
+    }
+    for (size_t i = 0; i < view->header_count; i++)
+    {
+        _creq_SerialSegment_t *pSegment = &cache->segments[i];
+        char *lineStart = dest;
+        if (pSegment->is_dirty)
+        {
+            dest = _creq_HeaderField_emit_line(&view->header_vector[i], dest, view->line_ending, view->line_ending_len);
+        }
+        else
+        {
+            memcpy(dest, cache->buf + pSegment->offset, pSegment->len);
+            dest += pSegment->len;
+        }
+        pSegment->offset = (size_t)(lineStart - cache->spare);
+        pSegment->len = (size_t)(dest - lineStart);
+        pSegment->is_dirty = false;
+    }
+    if (_creq_view_has_no_headers(view))
+    {
+        memcpy(dest, view->line_ending, view->line_ending_len);
+        dest += view->line_ending_len;
+    }
+    memcpy(dest, view->line_ending, view->line_ending_len);
+    dest += view->line_ending_len;
+    memcpy(dest, view->body, view->body_len);
+    dest[view->body_len] = '\0';
+
+    char *previous = cache->buf;
+    size_t previousCap = cache->cap;
+    cache->buf = cache->spare;
+    cache->cap = cache->spare_cap;
+    cache->spare = previous;
+    cache->spare_cap = previousCap;
+    cache->len = total;
+    cache->start_line_len = startLen;
+    cache->is_start_line_dirty = false;
+    cache->is_valid = true;
+    cache->is_clean = true;
+    if (len != NULL)
+    {
+        *len = total;
+    }
+    return cache->buf;
+}
+
+/*
+ * Header records are stored by value in a cvector. The first CREQ_INLINE_HEADER_CAPACITY of them live in the
+ * header_inline member of the message, laid out exactly like a heap cvector, so cvector_size() and friends work on
+ * either storage. Only a message outgrowing it allocates, from its arena if it has one. While the headers fit inline,
+ * header_vector points into the message itself, which is why messages must never be copied or moved by value.
+ *
+ * With CONF_OPT_HEADER_INDEX, an open-addressing hash table maps each distinct field name (case-insensitively) to the
+ * index of its first occurrence. Appending only ever inserts. Removing a record renumbers the later ones and, if it was
+ * the first of its name, hands its slot to the next record of that name or deletes it by shifting back the rest of its
+ * probe run; either way it costs no more than the erase itself.
+ */
+_Static_assert(offsetof(struct creq_Request, header_inline.fields) - offsetof(struct creq_Request, header_inline) ==
+                   sizeof(size_t) * 2,
+               "inline header storage must be laid out like a cvector");
+_Static_assert(offsetof(struct creq_Response, header_inline.fields) - offsetof(struct creq_Response, header_inline) ==
+                   sizeof(size_t) * 2,
+               "inline header storage must be laid out like a cvector");
+
+struct creq_HeaderIndex
+{
+    size_t mask;
+    size_t used;
+    /// record index + 1 per slot, 0 for an empty slot
+    size_t slots[];
+};
+
+/// @brief Everything that makes up the header set of a request or response.
+typedef struct _creq_HeaderStore
+{
+    creq_HeaderField_t **vec;
+    creq_HeaderField_t *inline_fields;
+    creq_Arena_t *arena;
+    creq_StringBin_t *bin;
+    creq_HeaderIndex_t **index;
+    bool use_index;
+    creq_HeaderProfile_t *profile;
+    /// Cleared by every change to the headers. NULL for lookups only.
+    bool *is_verified;
+    /// Follows every change to the headers. NULL unless the owner has serialized itself into its cache.
+    creq_SerialCache_t *cache;
+} _creq_HeaderStore_t;
+
+#define _CREQ_HEADER_STORE(msg)                                                                                        \
+    {                                                                                                                  \
+        &(msg)->header_vector, (msg)->header_inline.fields, (msg)->arena, (msg)->string_bin, &(msg)->header_index,    \
+            ((msg)->options & CONF_OPT_HEADER_INDEX) != 0, (msg)->header_profile,                                      \
+            &(msg)->is_verified, (msg)->serial_cache                                                                   \
+    }
+
+/// @brief Case-insensitive FNV-1a hash of a field name.
+CREQ_PRIVATE(uint32_t)
+_creq_header_name_hash(const char *name, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)name[i];
+        hash = (hash ^ (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c)) * 16777619u;
+    }
+    return hash;
+}
+
+/// @brief A field name to look for, prepared once per lookup.
+typedef struct _creq_HeaderKey
+{
+    const char *name;
+    size_t len;
+    uint32_t hash;
+    creq_HeaderId_t id;
+} _creq_HeaderKey_t;
+
+CREQ_PRIVATE(_creq_HeaderKey_t)
+_creq_header_key(const char *name, size_t len)
+{
+    _creq_HeaderKey_t key = {name, len, _creq_header_name_hash(name, len), _creq_header_id_n(name, len)};
+    return key;
+}
+
+CREQ_PRIVATE(_creq_HeaderKey_t)
+_creq_header_key_from_id(creq_HeaderId_t id)
+{
+    const _creq_WellKnownHeader_t *pKnown = &_creq_well_known_headers[id];
+    _creq_HeaderKey_t key = {pKnown->name, pKnown->name_len, _creq_header_name_hash(pKnown->name, pKnown->name_len),
+                             id};
+    return key;
+}
+
+/// @brief Well-known names are matched by ID alone; they are classified the same way when records are filled.
+CREQ_PRIVATE(bool)
+_creq_HeaderField_matches(const creq_HeaderField_t *pField, const _creq_HeaderKey_t *key)
+{
+    if (key->id != CREQ_HDR_UNKNOWN)
+    {
+        return pField->field_id == key->id;
+    }
+    return pField->field_name_hash == key->hash && pField->field_name_len == key->len &&
+           _creq_header_name_eq(pField->field_name, key->name, key->len);
+}
+
+/// @brief Fills a header record in memory owned by a message. Literals are stored as-is, others are copied.
+CREQ_PRIVATE(creq_status_t)
+_creq_HeaderField_init(creq_Arena_t *arena, creq_StringBin_t *bin, creq_HeaderField_t *pField, const char *header,
+                       size_t headerLen, const char *value, size_t valueLen, bool is_literal)
+{
+    pField->field_name = is_literal ? (char *)header : _creq_msg_memdup(arena, bin, header, headerLen);
+    pField->field_name_len = headerLen;
+    pField->is_field_name_literal = is_literal;
+    pField->is_field_name_static = false;
+    pField->field_value = is_literal ? (char *)value : _creq_msg_memdup(arena, bin, value, valueLen);
+    pField->field_value_len = valueLen;
+    pField->is_field_value_literal = is_literal;
+    pField->field_name_hash = _creq_header_name_hash(header, headerLen);
+    pField->field_id = _creq_header_id_n(header, headerLen);
+    return pField->field_name == NULL || pField->field_value == NULL ? CREQ_STATUS_FAILED : CREQ_STATUS_SUCC;
+}
+
+/// @brief Fills a header record for a well-known name, whose name is never copied.
+CREQ_PRIVATE(creq_status_t)
+_creq_HeaderField_init_id(creq_Arena_t *arena, creq_StringBin_t *bin, creq_HeaderField_t *pField, creq_HeaderId_t id,
+                          const char *value, size_t valueLen, bool is_literal)
+{
+    const _creq_WellKnownHeader_t *pKnown = &_creq_well_known_headers[id];
+    pField->field_name = (char *)pKnown->name;
+    pField->field_name_len = pKnown->name_len;
+    pField->is_field_name_literal = true;
+    pField->is_field_name_static = true;
+    pField->field_value = is_literal ? (char *)value : _creq_msg_memdup(arena, bin, value, valueLen);
+    pField->field_value_len = valueLen;
+    pField->is_field_value_literal = is_literal;
+    pField->field_name_hash = _creq_header_name_hash(pKnown->name, pKnown->name_len);
+    pField->field_id = id;
+    return pField->field_value == NULL ? CREQ_STATUS_FAILED : CREQ_STATUS_SUCC;
+}
+
+/// @brief Releases the owned strings of a header record, leaving the record itself alone.
+CREQ_PRIVATE(void)
+_creq_HeaderField_clear(creq_Arena_t *arena, creq_StringBin_t *bin, creq_HeaderField_t *pField)
+{
+    if (!pField->is_field_name_literal)
+        _CREQ_MSG_FREE(arena, bin, pField->field_name);
+    if (!pField->is_field_value_literal)
+        _CREQ_MSG_FREE(arena, bin, pField->field_value);
+}
+
+CREQ_PRIVATE(void)
+_creq_header_index_free(_creq_HeaderStore_t *store)
+{
+    if (store->arena == NULL)
+    {
+        CREQ_GUARDED_FREE(*store->index);
+    }
+    *store->index = NULL;
+}
+
+/// @return The index of the first record named 'name' according to the hash index, or -1.
+CREQ_PRIVATE(int)
+_creq_header_index_find(const creq_HeaderIndex_t *index, const creq_HeaderField_t *vec, const _creq_HeaderKey_t *key)
+{
+    for (size_t slot = key->hash & index->mask;; slot = (slot + 1) & index->mask)
+    {
+        size_t entry = index->slots[slot];
+        if (entry == 0)
+        {
+            return -1;
+        }
+        if (_creq_HeaderField_matches(&vec[entry - 1], key))
+        {
+            return (int)(entry - 1);
+        }
+    }
+}
+
+/// @brief Records 'idx' as the first occurrence of its name unless the name is already indexed.
+CREQ_PRIVATE(void)
+_creq_header_index_insert(creq_HeaderIndex_t *index, const creq_HeaderField_t *vec, size_t idx)
+{
+    const creq_HeaderField_t *pField = &vec[idx];
+    _creq_HeaderKey_t key = {pField->field_name, pField->field_name_len, pField->field_name_hash, pField->field_id};
+    for (size_t slot = key.hash & index->mask;; slot = (slot + 1) & index->mask)
+    {
+        size_t entry = index->slots[slot];
+        if (entry == 0)
+        {
+            index->slots[slot] = idx + 1;
+            index->used++;
+            return;
+        }
+        if (_creq_HeaderField_matches(&vec[entry - 1], &key))
+        {
+            return;
+        }
+    }
+}
+
+/// @brief Rebuilds the hash index from scratch, sized for the current header count.
+CREQ_PRIVATE(creq_status_t)
+_creq_header_index_rebuild(_creq_HeaderStore_t *store)
+{
+    size_t count = cvector_size(*store->vec), slotCount = 16;
+    while (slotCount < count * 2 + 2)
+    {
+        slotCount *= 2;
+    }
+    creq_HeaderIndex_t *index = *store->index;
+    if (index == NULL || index->mask + 1 != slotCount)
+    {
+        _creq_header_index_free(store);
+        size_t bytes = sizeof(creq_HeaderIndex_t) + sizeof(size_t) * slotCount;
+        index = (creq_HeaderIndex_t *)(store->arena != NULL ? _creq_Arena_alloc(store->arena, bytes)
+                                                            : creq_malloc(bytes));
+        if (index == NULL)
+        {
+            return CREQ_STATUS_FAILED;
+        }
+        index->mask = slotCount - 1;
+        *store->index = index;
+    }
+    memset(index->slots, 0, sizeof(size_t) * slotCount);
+    index->used = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        _creq_header_index_insert(index, *store->vec, i);
+    }
+    return CREQ_STATUS_SUCC;
+}
+
+/// @brief Brings the hash index up to date for the record at 'idx' being erased. Call it while the record still exists.
+CREQ_PRIVATE(void)
+_creq_header_index_removing(_creq_HeaderStore_t *store, size_t idx)
+{
+    creq_HeaderIndex_t *index = *store->index;
+    if (index == NULL)
+    {
+        return;
+    }
+    const creq_HeaderField_t *vec = *store->vec;
+    const creq_HeaderField_t *pField = &vec[idx];
+    _creq_HeaderKey_t key = {pField->field_name, pField->field_name_len, pField->field_name_hash, pField->field_id};
+    size_t count = cvector_size(vec), hole = index->mask + 1;
+    // the slot of the name is on its probe run; it holds 'idx' only if that is the first occurrence
+    for (size_t slot = key.hash & index->mask; index->slots[slot] != 0; slot = (slot + 1) & index->mask)
+    {
+        if (index->slots[slot] == idx + 1)
+        {
+            hole = slot;
+            break;
+        }
+        if (_creq_HeaderField_matches(&vec[index->slots[slot] - 1], &key))
+        {
+            break;
+        }
+    }
+    if (hole <= index->mask)
+    {
+        size_t next = idx + 1;
+        while (next < count && !_creq_HeaderField_matches(&vec[next], &key))
+        {
+            next++;
+        }
+        if (next < count)
+        {
+            index->slots[hole] = next + 1;
+        }
+        else
+        {
+            // backward-shift deletion keeps every later entry of the probe run reachable from its home slot
+            for (size_t slot = (hole + 1) & index->mask; index->slots[slot] != 0; slot = (slot + 1) & index->mask)
+            {
+                size_t home = vec[index->slots[slot] - 1].field_name_hash & index->mask;
+                if (((slot - home) & index->mask) >= ((slot - hole) & index->mask))
+                {
+                    index->slots[hole] = index->slots[slot];
+                    hole = slot;
+                }
+            }
+            index->slots[hole] = 0;
+            index->used--;
+        }
+    }
+    for (size_t slot = 0; slot <= index->mask; slot++)
+    {
+        if (index->slots[slot] > idx + 1)
+        {
+            index->slots[slot]--;
+        }
+    }
+}
+
+/// @brief Brings the hash index up to date after the record at 'idx' was appended.
+CREQ_PRIVATE(void)
+_creq_header_index_appended(_creq_HeaderStore_t *store, size_t idx)
+{
+    creq_HeaderIndex_t *index = *store->index;
+    if (!store->use_index)
+    {
+        return;
+    }
+    if (index == NULL || (index->used + 1) * 2 > index->mask + 1)
+    {
+        // a failed rebuild leaves no index behind and lookups fall back to scanning
+        _creq_header_index_rebuild(store);
+        return;
+    }
+    _creq_header_index_insert(index, *store->vec, idx);
+}
+
+/// @return The index of the first record named 'name' at or after 'from', or -1.
+CREQ_PRIVATE(int)
+_creq_header_store_find_from(_creq_HeaderStore_t *store, const _creq_HeaderKey_t *key, size_t from)
+{
+    creq_HeaderField_t *vec = *store->vec;
+    if (from == 0 && *store->index != NULL)
+    {
+        return _creq_header_index_find(*store->index, vec, key);
+    }
+    for (size_t i = from; i < cvector_size(vec); i++)
+    {
+        if (_creq_HeaderField_matches(&vec[i], key))
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+CREQ_PRIVATE(int)
+_creq_header_store_find(_creq_HeaderStore_t *store, const char *name)
+{
+    _creq_HeaderKey_t key = _creq_header_key(name, strlen(name));
+    return _creq_header_store_find_from(store, &key, 0);
+}
+
+/// @brief Appends a zero-filled record to a header vector and returns it, or NULL on allocation failure.
+CREQ_PRIVATE(creq_HeaderField_t *)
+_creq_header_store_emplace(_creq_HeaderStore_t *store)
+{
+    creq_HeaderField_t *vec = *store->vec;
+    if (vec == NULL)
+    {
+        vec = store->inline_fields;
+        cvector_set_capacity(vec, CREQ_INLINE_HEADER_CAPACITY);
+        cvector_set_size(vec, 0);
+    }
+    size_t size = cvector_size(vec), capacity = cvector_capacity(vec);
+    if (size >= capacity)
+    {
+        size_t newCapacity = capacity * 2;
+        size_t bytes = sizeof(size_t) * 2 + sizeof(creq_HeaderField_t) * newCapacity;
+        size_t *pNew = NULL;
+        if (store->arena != NULL)
+        {
+            pNew = (size_t *)_creq_Arena_alloc(store->arena, bytes);
+        }
+        else if (vec == store->inline_fields)
+        {
+            pNew = (size_t *)creq_malloc(bytes);
+        }
+        else
+        {
+            pNew = (size_t *)creq_realloc(&((size_t *)vec)[-2], bytes);
+        }
+        if (pNew == NULL)
+        {
+            return NULL;
+        }
+        creq_HeaderField_t *newVec = (creq_HeaderField_t *)&pNew[2];
+        if (store->arena != NULL || vec == store->inline_fields)
+        {
+            memcpy(newVec, vec, sizeof(creq_HeaderField_t) * size);
+        }
+        cvector_set_capacity(newVec, newCapacity);
+        cvector_set_size(newVec, size);
+        vec = newVec;
+    }
+    cvector_set_size(vec, size + 1);
+    *store->vec = vec;
+    memset(&vec[size], 0, sizeof(creq_HeaderField_t));
+    return &vec[size];
+}
+
+/// @brief Marks the owner of the store as changed since it was last validated.
+CREQ_PRIVATE(void)
+_creq_header_store_touch(_creq_HeaderStore_t *store)
+{
+    if (store->is_verified != NULL)
+    {
+        *store->is_verified = false;
+    }
+}
+
+/// @brief Appends a header to a message's header set. A well-known 'id' takes precedence over 'header'.
+CREQ_PRIVATE(creq_status_t)
+_creq_header_store_add(_creq_HeaderStore_t *store, creq_HeaderId_t id, const char *header, size_t headerLen,
+                       const char *value, size_t valueLen, bool is_literal)
+{
+    _creq_header_store_touch(store);
+    creq_HeaderField_t *pField = _creq_header_store_emplace(store);
+    if (pField == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_status_t status =
+        id != CREQ_HDR_UNKNOWN
+            ? _creq_HeaderField_init_id(store->arena, store->bin, pField, id, value, valueLen, is_literal)
+            : _creq_HeaderField_init(store->arena, store->bin, pField, header, headerLen, value, valueLen, is_literal);
+    if (status == CREQ_STATUS_FAILED)
+    {
+        _creq_HeaderField_clear(store->arena, store->bin, pField);
+        cvector_pop_back(*store->vec);
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_header_index_appended(store, cvector_size(*store->vec) - 1);
+    _creq_serial_cache_header_added(store->cache);
+    return CREQ_STATUS_SUCC;
+}
+
+/// @brief Releases and erases the record at 'idx' of a message's header set.
+CREQ_PRIVATE(void)
+_creq_header_store_remove(_creq_HeaderStore_t *store, size_t idx)
+{
+    _creq_header_store_touch(store);
+    _creq_header_index_removing(store, idx);
+    _creq_HeaderField_clear(store->arena, store->bin, &(*store->vec)[idx]);
+    cvector_erase(*store->vec, idx);
+    _creq_serial_cache_header_removed(store->cache, idx);
+}
+
+/// @brief Replaces the value of the first header matching 'key', drops its other occurrences, or appends it.
+CREQ_PRIVATE(creq_status_t)
+_creq_header_store_set(_creq_HeaderStore_t *store, const _creq_HeaderKey_t *key, const char *value, size_t valueLen,
+                       bool is_literal)
+{
+    _creq_header_store_touch(store);
+    int idx = _creq_header_store_find_from(store, key, 0);
+    if (idx < 0)
+    {
+        return _creq_header_store_add(store, key->id, key->name, key->len, value, valueLen, is_literal);
+    }
+    char *newValue = is_literal ? (char *)value : _creq_msg_memdup(store->arena, store->bin, value, valueLen);
+    if (newValue == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_HeaderField_t *pField = &(*store->vec)[idx];
+    if (!pField->is_field_value_literal)
+        _CREQ_MSG_FREE(store->arena, store->bin, pField->field_value);
+    pField->field_value = newValue;
+    pField->field_value_len = valueLen;
+    pField->is_field_value_literal = is_literal;
+    _creq_serial_cache_header_changed(store->cache, (size_t)idx);
+
+    // the other occurrences are dropped in one compacting pass, and the index is rebuilt once if any went
+    creq_HeaderField_t *vec = *store->vec;
+    size_t count = cvector_size(vec), kept = (size_t)idx + 1;
+    for (size_t i = kept; i < count; i++)
+    {
+        if (_creq_HeaderField_matches(&vec[i], key))
+        {
+            _creq_HeaderField_clear(store->arena, store->bin, &vec[i]);
+            continue;
+        }
+        if (kept != i)
+        {
+            vec[kept] = vec[i];
+            _creq_serial_cache_header_moved(store->cache, i, kept);
+        }
+        kept++;
+    }
+    if (kept != count)
+    {
+        cvector_set_size(vec, kept);
+        _creq_serial_cache_headers_truncated(store->cache, kept);
+        if (*store->index != NULL)
+        {
+            // a failed rebuild leaves no index behind and lookups fall back to scanning
+            _creq_header_index_rebuild(store);
+        }
+    }
+    return CREQ_STATUS_SUCC;
+}
+
+/// @brief Releases every record of a message's header set and any storage it allocated.
+CREQ_PRIVATE(void)
+_creq_header_store_free(_creq_HeaderStore_t *store)
+{
+    creq_HeaderField_t *vec = *store->vec;
+    for (size_t i = 0; i < cvector_size(vec); i++)
+    {
+        _creq_HeaderField_clear(store->arena, store->bin, &vec[i]);
+    }
+    if (vec != store->inline_fields && store->arena == NULL)
+    {
+        cvector_free(vec);
+    }
+    _creq_header_index_free(store);
+}
+
+/// @brief Empties a message's header set. On the heap the spilled vector and the index are kept and the owned strings
+/// go to the string bin; in an arena everything is dropped, to be reclaimed by rewinding the arena.
+CREQ_PRIVATE(void)
+_creq_header_store_reset(_creq_HeaderStore_t *store)
+{
+    creq_HeaderField_t *vec = *store->vec;
+    if (store->arena != NULL)
+    {
+        *store->vec = NULL;
+        *store->index = NULL;
+        return;
+    }
+    for (size_t i = 0; i < cvector_size(vec); i++)
+    {
+        if (!vec[i].is_field_name_literal)
+            _creq_StringBin_put(store->bin, vec[i].field_name, vec[i].field_name_len + 1);
+        if (!vec[i].is_field_value_literal)
+            _creq_StringBin_put(store->bin, vec[i].field_value, vec[i].field_value_len + 1);
+    }
+    if (vec != NULL)
+    {
+        cvector_set_size(vec, 0);
+    }
+    if (*store->index != NULL)
+    {
+        memset((*store->index)->slots, 0, sizeof(size_t) * ((*store->index)->mask + 1));
+        (*store->index)->used = 0;
+    }
+}
+
+/// @return The heap bytes of a header set outside an arena: the spilled vector, the index and the owned strings.
+CREQ_PRIVATE(size_t)
+_creq_header_store_memory_usage(const _creq_HeaderStore_t *store)
+{
+    creq_HeaderField_t *vec = *store->vec;
+    size_t bytes = 0;
+    for (size_t i = 0; i < cvector_size(vec); i++)
+    {
+        bytes += _creq_slice_memory_usage(vec[i].field_name, vec[i].field_name_len, vec[i].is_field_name_literal);
+        bytes += _creq_slice_memory_usage(vec[i].field_value, vec[i].field_value_len, vec[i].is_field_value_literal);
+    }
+    if (vec != NULL && vec != store->inline_fields)
+    {
+        bytes += sizeof(size_t) * 2 + sizeof(creq_HeaderField_t) * cvector_capacity(vec);
+    }
+    if (*store->index != NULL)
+    {
+        bytes += sizeof(creq_HeaderIndex_t) + sizeof(size_t) * ((*store->index)->mask + 1);
+    }
+    return bytes;
+}
+
+/*
+ * Header profiles. A profile is one immutable allocation: the header records followed by copies of their strings.
+ * Messages only hold a reference, so attaching one copies nothing. A message header hides every profile header of the
+ * same name; which ones are hidden is worked out each time a message is serialized.
+ */
+
+#ifndef __STDC_NO_ATOMICS__
+typedef atomic_size_t _creq_RefCount_t;
+#define _CREQ_REF_INIT(ref, value) atomic_init(&(ref), (value))
+#define _CREQ_REF_RETAIN(ref) atomic_fetch_add_explicit(&(ref), 1, memory_order_relaxed)
+/// Evaluates to true when the last reference is dropped.
+#define _CREQ_REF_RELEASE(ref) (atomic_fetch_sub_explicit(&(ref), 1, memory_order_acq_rel) == 1)
+#else
+typedef size_t _creq_RefCount_t;
+#define _CREQ_REF_INIT(ref, value) ((ref) = (value))
+#define _CREQ_REF_RETAIN(ref) ((ref)++)
+#define _CREQ_REF_RELEASE(ref) (--(ref) == 0)
+#endif
+
+struct creq_HeaderProfile
+{
+    _creq_RefCount_t refcount;
+    size_t count;
+    creq_HeaderField_t fields[];
+};
+
+CREQ_PRIVATE(int)
+_creq_HeaderProfile_find_from(const creq_HeaderProfile_t *profile, const _creq_HeaderKey_t *key, size_t from)
+{
+    for (size_t i = from; i < profile->count; i++)
+    {
+        if (_creq_HeaderField_matches(&profile->fields[i], key))
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+CREQ_PRIVATE(void)
+_creq_view_attach_profile(_creq_MessageView_t *view, creq_HeaderProfile_t *profile, creq_HeaderField_t *headerVector,
+                          creq_HeaderIndex_t *index)
+{
+    if (profile == NULL)
+    {
+        return;
+    }
+    view->profile_vector = profile->fields;
+    view->profile_count = profile->count;
+    if (headerVector == NULL)
+    {
+        return;
+    }
+    // Only the lookups are needed here, which never write through the store.
+    _creq_HeaderStore_t store = {&headerVector, NULL, NULL, NULL, &index, index != NULL, NULL, NULL, NULL};
+    for (size_t i = 0; i < profile->count; i++)
+    {
+        const creq_HeaderField_t *pField = &profile->fields[i];
+        _creq_HeaderKey_t key = {pField->field_name, pField->field_name_len, pField->field_name_hash, pField->field_id};
+        if (_creq_header_store_find_from(&store, &key, 0) >= 0)
+        {
+            view->profile_hidden |= (uint64_t)1 << i;
+        }
+    }
+}
+
+/*
+ * A profile outlives the message it is made from, so every string is copied into it, literal or not: a "literal" only
+ * has to outlive its message, and some point into the message itself (the Date value lives in date_buf). Only the
+ * static names of well-known headers are shared.
+ */
+CREQ_PRIVATE(creq_HeaderProfile_t *)
+_creq_HeaderProfile_create(const creq_HeaderField_t *vec)
+{
+    size_t count = cvector_size(vec), bytes = sizeof(creq_HeaderProfile_t) + sizeof(creq_HeaderField_t) * count;
+    if (count > CREQ_HEADER_PROFILE_MAX_FIELDS)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        bytes += (vec[i].is_field_name_static ? 0 : vec[i].field_name_len + 1) +
+                 vec[i].field_value_len + 1;
+    }
+    creq_HeaderProfile_t *profile = (creq_HeaderProfile_t *)creq_malloc(bytes);
+    if (profile == NULL)
+    {
+        return NULL;
+    }
+    _CREQ_REF_INIT(profile->refcount, 1);
+    profile->count = count;
+    char *strings = (char *)&profile->fields[count];
+    for (size_t i = 0; i < count; i++)
+    {
+        creq_HeaderField_t *pField = &profile->fields[i];
+        *pField = vec[i];
+        if (!vec[i].is_field_name_static)
+        {
+            memcpy(strings, vec[i].field_name, vec[i].field_name_len);
+            strings[vec[i].field_name_len] = '\0';
+            pField->field_name = strings;
+            strings += vec[i].field_name_len + 1;
+        }
+        memcpy(strings, vec[i].field_value, vec[i].field_value_len);
+        strings[vec[i].field_value_len] = '\0';
+        pField->field_value = strings;
+        strings += vec[i].field_value_len + 1;
+        // the strings belong to the profile as a whole
+        pField->is_field_name_literal = true;
+        pField->is_field_value_literal = true;
+    }
+    return profile;
+}
+
+CREQ_PUBLIC(creq_HeaderProfile_t *)
+creq_HeaderProfile_create_from_request(creq_Request_t *req)
+{
+    return req == NULL ? NULL : _creq_HeaderProfile_create(req->header_vector);
+}
+
+CREQ_PUBLIC(creq_HeaderProfile_t *)
+creq_HeaderProfile_create_from_response(creq_Response_t *resp)
+{
+    return resp == NULL ? NULL : _creq_HeaderProfile_create(resp->header_vector);
+}
+
+CREQ_PUBLIC(creq_HeaderProfile_t *)
+creq_HeaderProfile_retain(creq_HeaderProfile_t *profile)
+{
+    if (profile != NULL)
+    {
+        _CREQ_REF_RETAIN(profile->refcount);
+    }
+    return profile;
+}
+
+CREQ_PUBLIC(void)
+creq_HeaderProfile_release(creq_HeaderProfile_t *profile)
+{
+    if (profile != NULL && _CREQ_REF_RELEASE(profile->refcount))
+    {
+        creq_free(profile);
+    }
+}
+
+CREQ_PUBLIC(size_t)
+creq_HeaderProfile_get_count(const creq_HeaderProfile_t *profile)
+{
+    return profile == NULL ? 0 : profile->count;
+}
+
+/// @return The index of the record 'header' points to, or -1 if it is not part of the vector.
+CREQ_PRIVATE(int)
+_creq_header_vector_index_of(creq_HeaderField_t *vec, const creq_HeaderField_t *header)
+{
+    size_t size = cvector_size(vec);
+    if (size == 0 || header < vec || header >= vec + size)
+    {
+        return -1;
+    }
+    return (int)(header - vec);
+}
+
+/// @brief Looks a header up in a message's own headers.
+CREQ_PRIVATE(creq_HeaderField_t *)
+_creq_header_store_lookup_own(_creq_HeaderStore_t *store, const _creq_HeaderKey_t *key)
+{
+    int idx = *store->vec == NULL ? -1 : _creq_header_store_find_from(store, key, 0);
+    return idx < 0 ? NULL : &(*store->vec)[idx];
+}
+
+/// @brief Looks a header up in a message, then in its profile, which the message's own headers override. Nothing is
+/// copied or changed, and the result may belong to the shared profile, hence const.
+CREQ_PRIVATE(const creq_HeaderField_t *)
+_creq_header_store_lookup(_creq_HeaderStore_t *store, const _creq_HeaderKey_t *key)
+{
+    const creq_HeaderField_t *pField = _creq_header_store_lookup_own(store, key);
+    int idx;
+    if (pField == NULL && store->profile != NULL && (idx = _creq_HeaderProfile_find_from(store->profile, key, 0)) >= 0)
+    {
+        pField = &store->profile->fields[idx];
+    }
+    return pField;
+}
+
+/// @brief Shared implementation of the *_header_iter_next() family.
+CREQ_PRIVATE(creq_HeaderField_t *)
+_creq_header_store_iter_next(_creq_HeaderStore_t *store, creq_HeaderIter_t *iter)
+{
+    if (iter->name == NULL)
+    {
+        return NULL;
+    }
+    _creq_HeaderKey_t key = {iter->name, iter->name_len, iter->name_hash, iter->name_id};
+    int idx = _creq_header_store_find_from(store, &key, iter->next_index);
+    if (idx < 0)
+    {
+        iter->name = NULL;
+        return NULL;
+    }
+    iter->next_index = (size_t)idx + 1;
+    return &(*store->vec)[idx];
+}
+
+#ifdef CREQ_POSIX_IO
+/*
+ * Output to file descriptors. Blocking descriptors are assumed: EINTR is retried, any other error is reported.
+ *
+ * Sockets are written with MSG_NOSIGNAL where it exists, so a peer that has gone away fails the write with EPIPE
+ * instead of raising SIGPIPE. Other descriptors make the first attempt fail with ENOTSOCK and are written normally.
+ * sendfile() has no such flag and still raises SIGPIPE on a closed socket; only the caller can ignore the signal.
+ * Files are mapped at most _CREQ_MAP_WINDOW bytes at a time, so a huge body never takes up as much address space.
+ */
+
+#define _CREQ_MAP_WINDOW ((size_t)1 << 20)
+
+/// @brief writev() without SIGPIPE on sockets. At most CREQ_IOV_MAX entries are taken.
+CREQ_PRIVATE(ssize_t)
+_creq_fd_writev(int fd, const creq_IoVec_t *iov, size_t count)
+{
+    count = count < CREQ_IOV_MAX ? count : CREQ_IOV_MAX;
+#ifdef MSG_NOSIGNAL
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec *)iov;
+    msg.msg_iovlen = count;
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent >= 0 || errno != ENOTSOCK)
+    {
+        return sent;
+    }
+#endif
+    return writev(fd, iov, (int)count);
+}
+
+/// @brief write() without SIGPIPE on sockets.
+CREQ_PRIVATE(ssize_t)
+_creq_fd_write(int fd, const char *buf, size_t len)
+{
+#ifdef MSG_NOSIGNAL
+    ssize_t sent = send(fd, buf, len, MSG_NOSIGNAL);
+    if (sent >= 0 || errno != ENOTSOCK)
+    {
+        return sent;
+    }
+#endif
+    return write(fd, buf, len);
+}
+
+/// @brief Writes a whole I/O vector, resuming after partial writes. The entries are consumed in the process.
+CREQ_PRIVATE(creq_status_t)
+_creq_fd_writev_all(int fd, creq_IoVec_t *iov, size_t count)
+{
+    while (count > 0)
+    {
+        ssize_t written = _creq_fd_writev(fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return CREQ_STATUS_FAILED;
+        }
+        size_t left = (size_t)written;
+        while (count > 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PRIVATE(creq_status_t)
+_creq_fd_write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t written = _creq_fd_write(fd, buf, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return CREQ_STATUS_FAILED;
+        }
+        buf += written;
+        len -= (size_t)written;
+    }
+    return CREQ_STATUS_SUCC;
+}
+
+/// @return Whether the file holds the whole range. Mapping past its end would raise SIGBUS on access.
+CREQ_PRIVATE(bool)
+_creq_fd_holds_range(int fd, uint64_t offset, size_t len)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0)
+    {
+        return false;
+    }
+    uint64_t size = (uint64_t)st.st_size;
+    return len <= size && offset <= size - len;
+}
+
+/// @brief Copies a file range to 'outFd' in the kernel: sendfile() on Linux, read-only mappings of one window at a
+/// time elsewhere or when sendfile() does not support the descriptors.
+CREQ_PRIVATE(creq_status_t)
+_creq_fd_send_file(int outFd, int inFd, uint64_t offset, size_t len)
+{
+    if (len == 0)
+    {
+        return CREQ_STATUS_SUCC;
+    }
+#ifdef __linux__
+    off_t off = (off_t)offset;
+    size_t left = len;
+    while (left > 0)
+    {
+        ssize_t sent = sendfile(outFd, inFd, &off, left);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EINVAL || errno == ENOSYS) && left == len)
+                break;
+            return CREQ_STATUS_FAILED;
+        }
+        if (sent == 0)
+        {
+            return CREQ_STATUS_FAILED; // The file is shorter than the range.
+        }
+        left -= (size_t)sent;
+    }
+    if (left == 0)
+    {
+        return CREQ_STATUS_SUCC;
+    }
+#endif
+    if (!_creq_fd_holds_range(inFd, offset, len))
+    {
+        return CREQ_STATUS_FAILED; // The file is shorter than the range.
+    }
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    while (len > 0)
+    {
+        // only the first window can start off a page boundary
+        size_t delta = (size_t)(offset % pageSize);
+        size_t mapLen = len + delta < _CREQ_MAP_WINDOW ? len + delta : _CREQ_MAP_WINDOW;
+        void *map = mmap(NULL, mapLen, PROT_READ, MAP_SHARED, inFd, (off_t)(offset - delta));
+        if (map == MAP_FAILED)
+        {
+            return CREQ_STATUS_FAILED;
+        }
+        creq_status_t status = _creq_fd_write_all(outFd, (const char *)map + delta, mapLen - delta);
+        munmap(map, mapLen);
+        if (status == CREQ_STATUS_FAILED)
+        {
+            return CREQ_STATUS_FAILED;
+        }
+        offset += mapLen - delta;
+        len -= mapLen - delta;
+    }
+    return CREQ_STATUS_SUCC;
+}
+
+/// @brief Copies as much of a file range to 'outFd' as one call takes, the same way as _creq_fd_send_file(). A mapping
+/// covers one window at most, so a call never writes more than _CREQ_MAP_WINDOW bytes that way.
+/// @return The bytes copied, 0 if the file is shorter than the range, or -1 with errno set.
+CREQ_PRIVATE(ssize_t)
+_creq_fd_send_file_some(int outFd, int inFd, uint64_t offset, size_t len)
+{
+#ifdef __linux__
+    off_t off = (off_t)offset;
+    ssize_t sent = sendfile(outFd, inFd, &off, len);
+    if (sent >= 0 || (errno != EINVAL && errno != ENOSYS))
+    {
+        return sent;
+    }
+#endif
+    if (!_creq_fd_holds_range(inFd, offset, len))
+    {
+        return 0;
+    }
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    size_t delta = (size_t)(offset % pageSize);
+    size_t mapLen = len + delta < _CREQ_MAP_WINDOW ? len + delta : _CREQ_MAP_WINDOW;
+    void *map = mmap(NULL, mapLen, PROT_READ, MAP_SHARED, inFd, (off_t)(offset - delta));
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+    ssize_t written = _creq_fd_write(outFd, (const char *)map + delta, mapLen - delta);
+    int savedErrno = errno;
+    munmap(map, mapLen);
+    errno = savedErrno;
+    return written;
+}
+#endif // CREQ_POSIX_IO
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_HeaderField_create(char *header, char *value)
+{
+    if (header == NULL || value == NULL)
+    {
+        return NULL;
+    }
+    creq_HeaderField_t *pNewHeader = _creq_header_pool_get();
+    if (pNewHeader != NULL && _creq_HeaderField_init(NULL, NULL, pNewHeader, header, strlen(header), value,
+                                                     strlen(value), false) == CREQ_STATUS_FAILED)
+    {
+        creq_HeaderField_free(&pNewHeader);
+    }
+    return pNewHeader;
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_HeaderField_create_literal(const char *header_s, const char *value_s)
+{
+    if (header_s == NULL || value_s == NULL)
+    {
+        return NULL;
+    }
+    creq_HeaderField_t *pNewHeader = _creq_header_pool_get();
+    if (pNewHeader != NULL)
+    {
+        _creq_HeaderField_init(NULL, NULL, pNewHeader, header_s, strlen(header_s), value_s, strlen(value_s), true);
+    }
+    return pNewHeader;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_HeaderField_free(creq_HeaderField_t **ptrToFieldPtr)
+{
+    if (ptrToFieldPtr == NULL || *ptrToFieldPtr == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_HeaderField_t *pField = *ptrToFieldPtr;
+    if (!pField->is_field_name_literal)
+    {
+        CREQ_GUARDED_FREE(pField->field_name);
+        pField->field_name = NULL;
+    }
+    if (!pField->is_field_value_literal)
+    {
+        CREQ_GUARDED_FREE(pField->field_value);
+        pField->field_value = NULL;
+    }
+    _creq_header_pool_put(pField);
+    *ptrToFieldPtr = NULL;
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(creq_Request_t *)
+creq_Request_create(creq_Config_t *conf)
+{
+    return creq_Request_create_with_options(conf, 0);
+}
+
+CREQ_PUBLIC(creq_Request_t *)
+creq_Request_create_with_options(creq_Config_t *conf, unsigned options)
+{
+    creq_Config_t config;
+    if (conf != NULL && conf->config_type == CONF_REQUEST)
+    {
+        config = *conf;
+    }
+    else
+    {
+        config.config_type = CONF_REQUEST;
+        config.data.request_config.line_ending = LE_CRLF;
+    }
+
+    creq_Arena_t *arena = NULL;
+    creq_Request_t *pRequest = NULL;
+    if (options & CONF_OPT_ARENA)
+    {
+        arena = _creq_Arena_create();
+        if (arena == NULL)
+        {
+            return NULL;
+        }
+        pRequest = (creq_Request_t *)_creq_Arena_alloc(arena, sizeof(struct creq_Request));
+        if (pRequest == NULL)
+        {
+            _creq_Arena_destroy(arena);
+            return NULL;
+        }
+        _creq_Arena_set_mark(arena);
+    }
+    else
+    {
+        pRequest = (creq_Request_t *)_creq_malloc_n_init(sizeof(struct creq_Request));
+    }
+    if (pRequest == NULL)
+    {
+        return NULL;
+    }
+    pRequest->config = config;
+    pRequest->options = options;
+    pRequest->arena = arena;
+    pRequest->method = _METH_UNKNOWN;
+    pRequest->is_request_target_literal = false;
+    pRequest->request_target = NULL;
+    pRequest->request_target_len = 0;
+    pRequest->http_version.major = 0;
+    pRequest->http_version.minor = 0;
+    pRequest->header_vector = NULL;
+    pRequest->header_profile = NULL;
+    pRequest->is_message_body_literal = false;
+    pRequest->is_message_body_transferred = false;
+    pRequest->message_body = NULL;
+    pRequest->message_body_len = 0;
+    pRequest->is_verified = false;
+    pRequest->serial_cache = NULL;
+    pRequest->string_bin = NULL;
+
+    return pRequest;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_free(creq_Request_t *req)
+{
+    if (req != NULL)
+    {
+        creq_HeaderProfile_release(req->header_profile);
+        _creq_serial_cache_free(req->serial_cache);
+        // the strings still lent out are freed with the fields below, with no record left to update
+        _creq_StringBin_free(req->string_bin);
+        req->string_bin = NULL;
+        if (req->arena != NULL)
+        {
+            // everything, including the object itself, lives in the arena
+            _creq_Arena_destroy(req->arena);
+            return CREQ_STATUS_SUCC;
+        }
+        // free pointer members
+        if (!req->is_request_target_literal)
+            CREQ_GUARDED_FREE(req->request_target);
+        if (!req->is_message_body_literal)
+            CREQ_GUARDED_FREE(req->message_body);
+        _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+        _creq_header_store_free(&store);
+        // finally
+        creq_free(req);
+        return CREQ_STATUS_SUCC;
+    }
+    return CREQ_STATUS_FAILED;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_reset(creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    if (req->arena == NULL && req->string_bin == NULL && (req->string_bin = _creq_StringBin_create()) == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_HeaderProfile_release(req->header_profile);
+    req->header_profile = NULL;
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    _creq_header_store_reset(&store);
+    if (req->arena != NULL)
+    {
+        _creq_Arena_rewind(req->arena);
+    }
+    else
+    {
+        if (!req->is_request_target_literal && req->request_target != NULL)
+            _creq_StringBin_put(req->string_bin, req->request_target, req->request_target_len + 1);
+        if (!req->is_message_body_literal && req->message_body != NULL)
+            _creq_StringBin_put(req->string_bin, req->message_body,
+                                req->message_body_len + (req->is_message_body_transferred ? 0 : 1));
+    }
+    req->method = _METH_UNKNOWN;
+    req->is_request_target_literal = false;
+    req->request_target = NULL;
+    req->request_target_len = 0;
+    req->http_version.major = 0;
+    req->http_version.minor = 0;
+    req->is_message_body_literal = false;
+    req->is_message_body_transferred = false;
+    req->message_body = NULL;
+    req->message_body_len = 0;
+    req->is_verified = false;
+    _creq_serial_cache_invalidate(req->serial_cache);
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Request_memory_usage(const creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return 0;
+    }
+    if (req->arena != NULL)
+    {
+        return _creq_Arena_memory_usage(req->arena) + _creq_serial_cache_memory_usage(req->serial_cache);
+    }
+    creq_Request_t *pReq = (creq_Request_t *)req;
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(pReq);
+    return sizeof(struct creq_Request) + _creq_header_store_memory_usage(&store) +
+           _creq_serial_cache_memory_usage(req->serial_cache) + _creq_StringBin_memory_usage(req->string_bin) +
+           _creq_slice_memory_usage(req->request_target, req->request_target_len, req->is_request_target_literal) +
+           _creq_slice_memory_usage(req->message_body, req->message_body_len, req->is_message_body_literal);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_http_method(creq_Request_t *req, creq_HttpMethod_t method)
+{
+    if (req == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    req->method = method;
+    req->is_verified = false;
+    _creq_serial_cache_touch_start_line(req->serial_cache);
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(creq_HttpMethod_t)
+creq_Request_get_http_method(creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return _METH_UNKNOWN;
+    }
+    return req->method;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_target(creq_Request_t *req, char *requestTarget, bool is_literal)
+{
+    return creq_Request_set_target_n(req, requestTarget, requestTarget == NULL ? 0 : strlen(requestTarget),
+                                     is_literal);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_target_n(creq_Request_t *req, const char *requestTarget, size_t len, bool is_literal)
+{
+    if (req == NULL || (requestTarget == NULL && len != 0))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    req->is_verified = false;
+    _creq_serial_cache_touch_start_line(req->serial_cache);
+    return _creq_slice_set(req->arena, req->string_bin, &req->request_target, &req->request_target_len,
+                           &req->is_request_target_literal, requestTarget, len, is_literal ? OWN_BORROW : OWN_COPY);
+}
+
+CREQ_PUBLIC(char *)
+creq_Request_get_target(creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return NULL;
+    }
+    return req->request_target;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Request_get_target_len(creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return 0;
+    }
+    return req->request_target_len;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_http_version(creq_Request_t *req, int major, int minor)
+{
+    if (req == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    req->http_version.major = major;
+    req->http_version.minor = minor;
+    req->is_verified = false;
+    _creq_serial_cache_touch_start_line(req->serial_cache);
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(creq_HttpVersion_t)
+creq_Request_get_http_version(creq_Request_t *req)
+{
+    creq_HttpVersion_t obj;
+    obj.major = -1;
+    obj.minor = -1;
+    if (req == NULL)
+    {
+        return obj;
+    }
+    obj.major = req->http_version.major;
+    obj.minor = req->http_version.minor;
+    return obj;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_add_header(creq_Request_t *req, char *header, char *value, bool is_literal)
+{
+    if (header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Request_add_header_n(req, header, strlen(header), value, strlen(value), is_literal);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_add_header_n(creq_Request_t *req, const char *header, size_t header_len, const char *value,
+                          size_t value_len, bool is_literal)
+{
+    if (req == NULL || header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    return _creq_header_store_add(&store, CREQ_HDR_UNKNOWN, header, header_len, value, value_len, is_literal);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_add_header_id(creq_Request_t *req, creq_HeaderId_t id, char *value, bool is_literal)
+{
+    if (req == NULL || id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    return _creq_header_store_add(&store, id, NULL, 0, value, strlen(value), is_literal);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_header(creq_Request_t *req, char *header, char *value, bool is_literal)
+{
+    if (header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Request_set_header_n(req, header, strlen(header), value, strlen(value), is_literal);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_header_n(creq_Request_t *req, const char *header, size_t header_len, const char *value,
+                          size_t value_len, bool is_literal)
+{
+    if (req == NULL || header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    _creq_HeaderKey_t key = _creq_header_key(header, header_len);
+    return _creq_header_store_set(&store, &key, value, value_len, is_literal);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Request_search_for_header(creq_Request_t *req, char *header)
+{
+    if (req == NULL || header == NULL)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    _creq_HeaderKey_t key = _creq_header_key(header, strlen(header));
+    return _creq_header_store_lookup_own(&store, &key);
+}
+
+CREQ_PUBLIC(const creq_HeaderField_t *)
+creq_Request_lookup_header(const creq_Request_t *req, const char *header)
+{
+    if (req == NULL || header == NULL)
+    {
+        return NULL;
+    }
+    // lookups never write through the store
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE((creq_Request_t *)req);
+    _creq_HeaderKey_t key = _creq_header_key(header, strlen(header));
+    return _creq_header_store_lookup(&store, &key);
+}
+
+CREQ_PUBLIC(const creq_HeaderField_t *)
+creq_Request_lookup_header_id(const creq_Request_t *req, creq_HeaderId_t id)
+{
+    if (req == NULL || id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE((creq_Request_t *)req);
+    _creq_HeaderKey_t key = _creq_header_key_from_id(id);
+    return _creq_header_store_lookup(&store, &key);
+}
+
+CREQ_PUBLIC(int)
+creq_Request_search_for_header_index(creq_Request_t *req, char *header)
+{
+    if (req == NULL || req->header_vector == NULL || header == NULL)
+    {
+        return -1;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    return _creq_header_store_find(&store, header);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Request_search_for_header_id(creq_Request_t *req, creq_HeaderId_t id)
+{
+    if (req == NULL || id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    _creq_HeaderKey_t key = _creq_header_key_from_id(id);
+    return _creq_header_store_lookup_own(&store, &key);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Request_header_iter_begin(creq_Request_t *req, creq_HeaderIter_t *iter, char *header)
+{
+    if (iter == NULL)
+    {
+        return NULL;
+    }
+    iter->name = header;
+    iter->name_len = header == NULL ? 0 : strlen(header);
+    iter->name_hash = header == NULL ? 0 : _creq_header_name_hash(header, iter->name_len);
+    iter->name_id = header == NULL ? CREQ_HDR_UNKNOWN : _creq_header_id_n(header, iter->name_len);
+    iter->next_index = 0;
+    return creq_Request_header_iter_next(req, iter);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Request_header_iter_next(creq_Request_t *req, creq_HeaderIter_t *iter)
+{
+    if (req == NULL || iter == NULL)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    return _creq_header_store_iter_next(&store, iter);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_remove_header(creq_Request_t *req, char *header)
+{
+    if (req == NULL || header == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    int idx = creq_Request_search_for_header_index(req, header);
+    if (idx >= 0)
+    {
+        _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+        _creq_header_store_remove(&store, idx);
+        return CREQ_STATUS_SUCC;
+    }
+    return CREQ_STATUS_FAILED;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_remove_header_direct(creq_Request_t *req, creq_HeaderField_t *header)
+{
+    if (req == NULL || header == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    int idx = _creq_header_vector_index_of(req->header_vector, header);
+    if (idx >= 0)
+    {
+        _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+        _creq_header_store_remove(&store, idx);
+        return CREQ_STATUS_SUCC;
+    }
+    return CREQ_STATUS_FAILED;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_message_body(creq_Request_t *req, char *msg, bool is_literal)
+{
+    if (req == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Request_set_message_body_bytes(req, msg, msg == NULL ? 0 : strlen(msg),
+                                               is_literal ? OWN_BORROW : OWN_COPY);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_message_body_bytes(creq_Request_t *req, const void *ptr, size_t len, creq_Ownership_t ownership)
+{
+    if (req == NULL || (ptr == NULL && len != 0))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_serial_cache_touch(req->serial_cache);
+    req->is_message_body_transferred = ownership == OWN_TRANSFER && req->arena == NULL;
+    return _creq_slice_set(req->arena, req->string_bin, &req->message_body, &req->message_body_len,
+                           &req->is_message_body_literal, ptr, len, ownership);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_update_content_len(creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    char content_len_s[_CREQ_NUM_BUF_LEN];
+    size_t content_len_len = _creq_format_uint(req->message_body_len, content_len_s);
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    _creq_HeaderKey_t key = _creq_header_key_from_id(CREQ_HDR_CONTENT_LENGTH);
+    // content_len_s is never a literal.
+    return _creq_header_store_set(&store, &key, content_len_s, content_len_len, false);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_message_body_content_len(creq_Request_t *req, char *msg, bool is_literal)
+{
+    if (creq_Request_set_message_body(req, msg, is_literal) == CREQ_STATUS_FAILED)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Request_update_content_len(req);
+}
+
+CREQ_PUBLIC(char *)
+creq_Request_get_message_body(creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return NULL;
+    }
+    return req->message_body;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Request_set_header_profile(creq_Request_t *req, creq_HeaderProfile_t *profile)
+{
+    if (req == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_HeaderProfile_retain(profile);
+    creq_HeaderProfile_release(req->header_profile);
+    req->header_profile = profile;
+    req->is_verified = false;
+    _creq_serial_cache_touch(req->serial_cache);
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Request_get_message_body_len(creq_Request_t *req)
+{
+    if (req == NULL)
+    {
+        return 0;
+    }
+    return req->message_body_len;
+}
+
+/// @brief Whether the object may be serialized: always, unless CONF_OPT_VALIDATE asks for it to be valid first.
+CREQ_PRIVATE(bool)
+_creq_Request_may_emit(creq_Request_t *req)
+{
+    return !(req->options & CONF_OPT_VALIDATE) ||
+           creq_Request_validate(req) == CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(char *)
+creq_Request_stringify(creq_Request_t *req)
+{
+    if (req == NULL || !_creq_Request_may_emit(req))
+    {
+        return NULL;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_request(&view, req);
+    return _creq_view_stringify(&view);
+}
+
+CREQ_PUBLIC(const char *)
+creq_Request_stringify_cached(creq_Request_t *req, size_t *len)
+{
+    if (len != NULL)
+        *len = 0;
+    if (req == NULL || !_creq_Request_may_emit(req))
+        return NULL;
+    if (req->serial_cache == NULL)
+    {
+        req->serial_cache = (creq_SerialCache_t *)_creq_malloc_n_init(sizeof(struct creq_SerialCache));
+        if (req->serial_cache == NULL)
+            return NULL;
+    }
+    creq_SerialCache_t *cache = req->serial_cache;
+    if (cache->is_clean)
+    {
+        if (len != NULL)
+            *len = cache->len;
+        return cache->buf;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_request(&view, req);
+    return _creq_serial_cache_build(cache, &view, len);
+}
+
+CREQ_PUBLIC(size_t)
+creq_Request_stringify_into(creq_Request_t *req, char *buf, size_t cap, size_t *needed)
+{
+    if (req == NULL || !_creq_Request_may_emit(req))
+    {
+        if (needed != NULL)
+            *needed = 0;
+        return 0;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_request(&view, req);
+    return _creq_view_stringify_into(&view, buf, cap, needed);
+}
+
+CREQ_PUBLIC(size_t)
+creq_Request_to_iovec(creq_Request_t *req, creq_IoVec_t *iov, size_t iov_cap, creq_IoVecScratch_t *scratch,
+                      size_t *needed)
+{
+    if (req == NULL || !_creq_Request_may_emit(req))
+    {
+        if (needed != NULL)
+            *needed = 0;
+        return 0;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_request(&view, req);
+    return _creq_view_to_iovec(&view, iov, iov_cap < CREQ_IOV_MAX ? iov_cap : CREQ_IOV_MAX, scratch, needed);
+}
+
+/// @brief Sizes a batch, request by request. Returns false if a request cannot be serialized.
+CREQ_PRIVATE(bool)
+_creq_Request_batch_size(creq_Request_t *const *reqs, size_t count, bool isIoVec, size_t *offsets, size_t *total)
+{
+    *total = 0;
+    if (reqs == NULL || count == 0)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (reqs[i] == NULL || !_creq_Request_may_emit(reqs[i]))
+        {
+            *total = 0;
+            return false;
+        }
+        _creq_MessageView_t view;
+        _creq_view_from_request(&view, reqs[i]);
+        size_t len = 0;
+        if (isIoVec)
+            _creq_view_to_iovec(&view, NULL, 0, NULL, &len);
+        else
+            len = _creq_view_length(&view);
+        if (offsets != NULL)
+            offsets[i] = *total;
+        *total += len;
+    }
+    if (offsets != NULL)
+        offsets[count] = *total;
+    return true;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Request_stringify_batch(creq_Request_t *const *reqs, size_t count, char *buf, size_t cap, size_t *offsets,
+                             size_t *needed)
+{
+    size_t total = 0;
+    bool sized = _creq_Request_batch_size(reqs, count, false, offsets, &total);
+    if (needed != NULL)
+    {
+        *needed = total;
+    }
+    if (!sized || buf == NULL || cap < total)
+    {
+        return 0;
+    }
+    char *dest = buf;
+    for (size_t i = 0; i < count; i++)
+    {
+        _creq_MessageView_t view;
+        _creq_view_from_request(&view, reqs[i]);
+        dest = _creq_view_emit(&view, dest);
+    }
+    return total;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Request_to_iovec_batch(creq_Request_t *const *reqs, size_t count, creq_IoVec_t *iov, size_t iov_cap,
+                            creq_IoVecScratch_t *scratches, size_t *offsets, size_t *needed)
+{
+    size_t total = 0;
+    bool sized = _creq_Request_batch_size(reqs, count, true, offsets, &total);
+    if (needed != NULL)
+    {
+        *needed = total;
+    }
+    if (!sized || iov == NULL || scratches == NULL || iov_cap < total || total > CREQ_IOV_MAX)
+    {
+        return 0;
+    }
+    size_t filled = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        _creq_MessageView_t view;
+        _creq_view_from_request(&view, reqs[i]);
+        filled += _creq_view_to_iovec(&view, iov + filled, iov_cap - filled, &scratches[i], NULL);
+    }
+    return filled;
+}
+
+CREQ_PUBLIC(creq_Response_t *)
+creq_Response_create(creq_Config_t *conf)
+{
+    return creq_Response_create_with_options(conf, 0);
+}
+
+CREQ_PUBLIC(creq_Response_t *)
+creq_Response_create_with_options(creq_Config_t *conf, unsigned options)
+{
+    creq_Config_t config;
+    if (conf != NULL && conf->config_type == CONF_RESPONSE)
+    {
+        config = *conf;
+    }
+    else
+    {
+        config.config_type = CONF_RESPONSE;
+        config.data.response_config.line_ending = LE_CRLF;
+    }
+
+    creq_Arena_t *arena = NULL;
+    creq_Response_t *pResponse = NULL;
+    if (options & CONF_OPT_ARENA)
+    {
+        arena = _creq_Arena_create();
+        if (arena == NULL)
+        {
+            return NULL;
+        }
+        pResponse = (creq_Response_t *)_creq_Arena_alloc(arena, sizeof(struct creq_Response));
+        if (pResponse == NULL)
+        {
+            _creq_Arena_destroy(arena);
+            return NULL;
+        }
+        _creq_Arena_set_mark(arena);
+    }
+    else
+    {
+        pResponse = (creq_Response_t *)_creq_malloc_n_init(sizeof(struct creq_Response));
+    }
+    if (pResponse == NULL)
+    {
+        return NULL;
+    }
+    pResponse->config = config;
+    pResponse->options = options;
+    pResponse->arena = arena;
+
+    pResponse->http_version.major = 0;
+    pResponse->http_version.minor = 0;
+    pResponse->status_code = 0;
+    pResponse->reason_phrase = NULL;
+    pResponse->reason_phrase_len = 0;
+    pResponse->is_reason_phrase_literal = false;
+    pResponse->message_body = NULL;
+    pResponse->message_body_len = 0;
+    pResponse->is_verified = false;
+    pResponse->serial_cache = NULL;
+    pResponse->string_bin = NULL;
+    pResponse->is_message_body_literal = false;
+    pResponse->is_message_body_transferred = false;
+    pResponse->body_file.fd = -1;
+    pResponse->body_file.offset = 0;
+    pResponse->body_file.len = 0;
+    pResponse->header_vector = NULL;
+    pResponse->header_profile = NULL;
+
+    return pResponse;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_free(creq_Response_t *resp)
+{
+    if (resp != NULL)
+    {
+        creq_HeaderProfile_release(resp->header_profile);
+        _creq_serial_cache_free(resp->serial_cache);
+        _creq_StringBin_free(resp->string_bin);
+        resp->string_bin = NULL;
+        if (resp->arena != NULL)
+        {
+            // everything, including the object itself, lives in the arena
+            _creq_Arena_destroy(resp->arena);
+            return CREQ_STATUS_SUCC;
+        }
+        // free pointer members
+        if (!resp->is_reason_phrase_literal)
+            CREQ_GUARDED_FREE(resp->reason_phrase);
+        if (!resp->is_message_body_literal)
+            CREQ_GUARDED_FREE(resp->message_body);
+        _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+        _creq_header_store_free(&store);
+        // finally
+        creq_free(resp);
+        return CREQ_STATUS_SUCC;
+    }
+    return CREQ_STATUS_FAILED;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_reset(creq_Response_t *resp)
+{
+    if (resp == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    if (resp->arena == NULL && resp->string_bin == NULL && (resp->string_bin = _creq_StringBin_create()) == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_HeaderProfile_release(resp->header_profile);
+    resp->header_profile = NULL;
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_header_store_reset(&store);
+    if (resp->arena != NULL)
+    {
+        _creq_Arena_rewind(resp->arena);
+    }
+    else
+    {
+        if (!resp->is_reason_phrase_literal && resp->reason_phrase != NULL)
+            _creq_StringBin_put(resp->string_bin, resp->reason_phrase, resp->reason_phrase_len + 1);
+        if (!resp->is_message_body_literal && resp->message_body != NULL)
+            _creq_StringBin_put(resp->string_bin, resp->message_body,
+                                resp->message_body_len + (resp->is_message_body_transferred ? 0 : 1));
+    }
+    resp->http_version.major = 0;
+    resp->http_version.minor = 0;
+    resp->status_code = 0;
+    resp->reason_phrase = NULL;
+    resp->reason_phrase_len = 0;
+    resp->is_reason_phrase_literal = false;
+    resp->message_body = NULL;
+    resp->message_body_len = 0;
+    resp->is_message_body_literal = false;
+    resp->is_message_body_transferred = false;
+    resp->body_file.fd = -1;
+    resp->body_file.offset = 0;
+    resp->body_file.len = 0;
+    resp->is_verified = false;
+    _creq_serial_cache_invalidate(resp->serial_cache);
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Response_memory_usage(const creq_Response_t *resp)
+{
+    if (resp == NULL)
+    {
+        return 0;
+    }
+    if (resp->arena != NULL)
+    {
+        return _creq_Arena_memory_usage(resp->arena) + _creq_serial_cache_memory_usage(resp->serial_cache);
+    }
+    creq_Response_t *pResp = (creq_Response_t *)resp;
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(pResp);
+    return sizeof(struct creq_Response) + _creq_header_store_memory_usage(&store) +
+           _creq_serial_cache_memory_usage(resp->serial_cache) + _creq_StringBin_memory_usage(resp->string_bin) +
+           _creq_slice_memory_usage(resp->reason_phrase, resp->reason_phrase_len, resp->is_reason_phrase_literal) +
+           _creq_slice_memory_usage(resp->message_body, resp->message_body_len, resp->is_message_body_literal);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_http_version(creq_Response_t *resp, int major, int minor)
+{
+    if (resp == NULL)
+        return CREQ_STATUS_FAILED;
+
+    resp->http_version.major = major;
+    resp->http_version.minor = minor;
+    resp->is_verified = false;
+    _creq_serial_cache_touch_start_line(resp->serial_cache);
+
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(creq_HttpVersion_t)
+creq_Response_get_http_version(creq_Response_t *resp)
+{
+    creq_HttpVersion_t obj;
+    obj.major = -1;
+    obj.minor = -1;
+    if (resp == NULL)
+    {
+        return obj;
+    }
+    obj.major = resp->http_version.major;
+    obj.minor = resp->http_version.minor;
+    return obj;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_status_code(creq_Response_t *resp, int status)
+{
+    if (resp == NULL)
+        return CREQ_STATUS_FAILED;
+    resp->status_code = status;
+    resp->is_verified = false;
+    _creq_serial_cache_touch_start_line(resp->serial_cache);
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_status(creq_Response_t *resp, int status)
+{
+    const _creq_StatusLine_t *pStatus = _creq_status_line_find(status);
+    if (resp == NULL || pStatus == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    resp->status_code = status;
+    return creq_Response_set_reason_phrase_literal_n(resp, pStatus->reason, pStatus->reason_len);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_reason_phrase(creq_Response_t *resp, char *reason)
+{
+    return creq_Response_set_reason_phrase_n(resp, reason, reason == NULL ? 0 : strlen(reason));
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_reason_phrase_n(creq_Response_t *resp, const char *reason, size_t len)
+{
+    if (resp == NULL || (reason == NULL && len != 0))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    resp->is_verified = false;
+    _creq_serial_cache_touch_start_line(resp->serial_cache);
+    return _creq_slice_set(resp->arena, resp->string_bin, &resp->reason_phrase, &resp->reason_phrase_len,
+                           &resp->is_reason_phrase_literal, reason, len, OWN_COPY);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_reason_phrase_literal(creq_Response_t *resp, const char *reason_s)
+{
+    return creq_Response_set_reason_phrase_literal_n(resp, reason_s, reason_s == NULL ? 0 : strlen(reason_s));
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_reason_phrase_literal_n(creq_Response_t *resp, const char *reason_s, size_t len)
+{
+    if (resp == NULL || (reason_s == NULL && len != 0))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    resp->is_verified = false;
+    _creq_serial_cache_touch_start_line(resp->serial_cache);
+    return _creq_slice_set(resp->arena, resp->string_bin, &resp->reason_phrase, &resp->reason_phrase_len,
+                           &resp->is_reason_phrase_literal, reason_s, len, OWN_BORROW);
+}
+
+CREQ_PUBLIC(int)
+creq_Response_get_status_code(creq_Response_t *resp)
+{
+    if (resp == NULL)
+        return 0;
+    return resp->status_code;
+}
+
+CREQ_PUBLIC(char *)
+creq_Response_get_reason_phrase(creq_Response_t *resp)
+{
+    if (resp == NULL)
+        return NULL;
+    return resp->reason_phrase;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Response_get_reason_phrase_len(creq_Response_t *resp)
+{
+    if (resp == NULL)
+        return 0;
+    return resp->reason_phrase_len;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header(creq_Response_t *resp, char *header, char *value)
+{
+    if (header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Response_add_header_n(resp, header, strlen(header), value, strlen(value));
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header_n(creq_Response_t *resp, const char *header, size_t header_len, const char *value,
+                           size_t value_len)
+{
+    if (resp == NULL || header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    return _creq_header_store_add(&store, CREQ_HDR_UNKNOWN, header, header_len, value, value_len, false);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header_literal(creq_Response_t *resp, const char *header_s, const char *value_s)
+{
+    if (header_s == NULL || value_s == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Response_add_header_literal_n(resp, header_s, strlen(header_s), value_s, strlen(value_s));
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header_literal_n(creq_Response_t *resp, const char *header_s, size_t header_len, const char *value_s,
+                                   size_t value_len)
+{
+    if (resp == NULL || header_s == NULL || value_s == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    return _creq_header_store_add(&store, CREQ_HDR_UNKNOWN, header_s, header_len, value_s, value_len, true);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header_id(creq_Response_t *resp, creq_HeaderId_t id, char *value)
+{
+    if (resp == NULL || id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    return _creq_header_store_add(&store, id, NULL, 0, value, strlen(value), false);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_header_id_literal(creq_Response_t *resp, creq_HeaderId_t id, const char *value_s)
+{
+    if (resp == NULL || id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT || value_s == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    return _creq_header_store_add(&store, id, NULL, 0, value_s, strlen(value_s), true);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_header(creq_Response_t *resp, char *header, char *value)
+{
+    if (header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Response_set_header_n(resp, header, strlen(header), value, strlen(value));
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_header_n(creq_Response_t *resp, const char *header, size_t header_len, const char *value,
+                           size_t value_len)
+{
+    if (resp == NULL || header == NULL || value == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_HeaderKey_t key = _creq_header_key(header, header_len);
+    return _creq_header_store_set(&store, &key, value, value_len, false);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_header_literal(creq_Response_t *resp, const char *header_s, const char *value_s)
+{
+    if (header_s == NULL || value_s == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Response_set_header_literal_n(resp, header_s, strlen(header_s), value_s, strlen(value_s));
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_header_literal_n(creq_Response_t *resp, const char *header_s, size_t header_len, const char *value_s,
+                                   size_t value_len)
+{
+    if (resp == NULL || header_s == NULL || value_s == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_HeaderKey_t key = _creq_header_key(header_s, header_len);
+    return _creq_header_store_set(&store, &key, value_s, value_len, true);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Response_search_for_header(creq_Response_t *resp, char *header)
+{
+    if (resp == NULL || header == NULL)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_HeaderKey_t key = _creq_header_key(header, strlen(header));
+    return _creq_header_store_lookup_own(&store, &key);
+}
+
+CREQ_PUBLIC(const creq_HeaderField_t *)
+creq_Response_lookup_header(const creq_Response_t *resp, const char *header)
+{
+    if (resp == NULL || header == NULL)
+    {
+        return NULL;
+    }
+    // lookups never write through the store
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE((creq_Response_t *)resp);
+    _creq_HeaderKey_t key = _creq_header_key(header, strlen(header));
+    return _creq_header_store_lookup(&store, &key);
+}
+
+CREQ_PUBLIC(const creq_HeaderField_t *)
+creq_Response_lookup_header_id(const creq_Response_t *resp, creq_HeaderId_t id)
+{
+    if (resp == NULL || id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE((creq_Response_t *)resp);
+    _creq_HeaderKey_t key = _creq_header_key_from_id(id);
+    return _creq_header_store_lookup(&store, &key);
 }
 
 CREQ_PUBLIC(int)
-creq_Request_search_for_header_index(creq_Request_t *req, char *header)
+creq_Response_search_for_header_index(creq_Response_t *resp, char *header)
+{
+    if (resp == NULL || resp->header_vector == NULL || header == NULL)
+    {
+        return -1;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    return _creq_header_store_find(&store, header);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Response_search_for_header_id(creq_Response_t *resp, creq_HeaderId_t id)
+{
+    if (resp == NULL || id <= CREQ_HDR_UNKNOWN || id >= _CREQ_HDR_COUNT)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_HeaderKey_t key = _creq_header_key_from_id(id);
+    return _creq_header_store_lookup_own(&store, &key);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Response_header_iter_begin(creq_Response_t *resp, creq_HeaderIter_t *iter, char *header)
+{
+    if (iter == NULL)
+    {
+        return NULL;
+    }
+    iter->name = header;
+    iter->name_len = header == NULL ? 0 : strlen(header);
+    iter->name_hash = header == NULL ? 0 : _creq_header_name_hash(header, iter->name_len);
+    iter->name_id = header == NULL ? CREQ_HDR_UNKNOWN : _creq_header_id_n(header, iter->name_len);
+    iter->next_index = 0;
+    return creq_Response_header_iter_next(resp, iter);
+}
+
+CREQ_PUBLIC(creq_HeaderField_t *)
+creq_Response_header_iter_next(creq_Response_t *resp, creq_HeaderIter_t *iter)
+{
+    if (resp == NULL || iter == NULL)
+    {
+        return NULL;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    return _creq_header_store_iter_next(&store, iter);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_remove_header(creq_Response_t *resp, char *header)
+{
+    if (resp == NULL || header == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    int idx = creq_Response_search_for_header_index(resp, header);
+    if (idx >= 0)
+    {
+        _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+        _creq_header_store_remove(&store, idx);
+        return CREQ_STATUS_SUCC;
+    }
+    return CREQ_STATUS_FAILED;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_remove_header_direct(creq_Response_t *resp, creq_HeaderField_t *header)
+{
+    if (resp == NULL || header == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    int idx = _creq_header_vector_index_of(resp->header_vector, header);
+    if (idx >= 0)
+    {
+        _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+        _creq_header_store_remove(&store, idx);
+        return CREQ_STATUS_SUCC;
+    }
+    return CREQ_STATUS_FAILED;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_message_body(creq_Response_t *resp, char *msg)
+{
+    return creq_Response_set_message_body_bytes(resp, msg, msg == NULL ? 0 : strlen(msg), OWN_COPY);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_message_body_bytes(creq_Response_t *resp, const void *ptr, size_t len, creq_Ownership_t ownership)
+{
+    if (resp == NULL || (ptr == NULL && len != 0))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    resp->body_file.fd = -1;
+    _creq_serial_cache_touch(resp->serial_cache);
+    resp->is_message_body_transferred = ownership == OWN_TRANSFER && resp->arena == NULL;
+    return _creq_slice_set(resp->arena, resp->string_bin, &resp->message_body, &resp->message_body_len,
+                           &resp->is_message_body_literal, ptr, len, ownership);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_body_file(creq_Response_t *resp, int fd, uint64_t offset, size_t len)
+{
+    if (resp == NULL || fd < 0)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_Response_set_message_body_bytes(resp, NULL, 0, OWN_COPY);
+    resp->body_file.fd = fd;
+    resp->body_file.offset = offset;
+    resp->body_file.len = len;
+    return creq_Response_update_content_len(resp);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_update_content_len(creq_Response_t *resp)
+{
+    if (resp == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    size_t content_len = resp->body_file.fd >= 0 ? resp->body_file.len : resp->message_body_len;
+    char content_len_s[_CREQ_NUM_BUF_LEN];
+    size_t content_len_len = _creq_format_uint(content_len, content_len_s);
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_HeaderKey_t key = _creq_header_key_from_id(CREQ_HDR_CONTENT_LENGTH);
+    return _creq_header_store_set(&store, &key, content_len_s, content_len_len, false);
+}
+
+/*
+ * Date header, RFC 7231 Section 7.1.1.1:
+ *
+ *   IMF-fixdate  = day-name "," SP date1 SP time-of-day SP GMT
+ *   date1        = day SP month SP year ; e.g., 02 Jun 1982
+ *
+ * The last date formatted is shared by all threads through a sequence lock: the text is stored as atomic words, a
+ * writer makes the sequence odd while it rewrites them, and a reader that sees the sequence change retries by
+ * formatting the date itself. Only one writer at a time gets in; the others leave the update to it.
+ */
+#define _CREQ_DATE_WORDS ((CREQ_HTTP_DATE_LEN + 7) / 8)
+
+/// @brief Formats 'second', counted from the epoch, as an IMF-fixdate. Writes no NUL terminator.
+CREQ_PRIVATE(void)
+_creq_format_imf_fixdate(long long second, char *out)
+{
+    static const char dayNames[] = "ThuFriSatSunMonTueWed"; // 1970-01-01 was a Thursday
+    static const char monthNames[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    long long day = second / 86400, secondOfDay = second % 86400;
+    if (secondOfDay < 0)
+    {
+        secondOfDay += 86400;
+        day--;
+    }
+    int weekday = (int)(((day % 7) + 7) % 7);
+    // proleptic Gregorian date from the day count, with years starting on March 1st
+    long long shifted = day + 719468;
+    long long era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+    unsigned dayOfEra = (unsigned)(shifted - era * 146097);
+    unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+    unsigned monthDay = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    unsigned month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    long long year = (long long)yearOfEra + era * 400 + (month <= 2);
+    unsigned yearDigits = (unsigned)(((year % 10000) + 10000) % 10000);
+    unsigned fields[] = {(unsigned)(secondOfDay / 3600), (unsigned)(secondOfDay / 60 % 60),
+                         (unsigned)(secondOfDay % 60)};
+
+    memcpy(out, dayNames + weekday * 3, 3);
+    out[3] = ',';
+    out[4] = ' ';
+    out[5] = (char)('0' + monthDay / 10);
+    out[6] = (char)('0' + monthDay % 10);
+    out[7] = ' ';
+    memcpy(out + 8, monthNames + (month - 1) * 3, 3);
+    out[11] = ' ';
+    out[12] = (char)('0' + yearDigits / 1000);
+    out[13] = (char)('0' + yearDigits / 100 % 10);
+    out[14] = (char)('0' + yearDigits / 10 % 10);
+    out[15] = (char)('0' + yearDigits % 10);
+    for (int i = 0; i < 3; i++)
+    {
+        out[16 + i * 3] = i == 0 ? ' ' : ':';
+        out[17 + i * 3] = (char)('0' + fields[i] / 10);
+        out[18 + i * 3] = (char)('0' + fields[i] % 10);
+    }
+    memcpy(out + 25, " GMT", 4);
+}
+
+#ifndef __STDC_NO_ATOMICS__
+static struct
+{
+    /// Odd while a writer rewrites the entry.
+    atomic_uint_fast64_t seq;
+    atomic_llong second;
+    atomic_uint_fast64_t words[_CREQ_DATE_WORDS];
+} _creq_date_cache;
+
+/// @return Whether the cache held the date of 'second', which is then copied into 'out'.
+CREQ_PRIVATE(bool)
+_creq_date_cache_read(long long second, char *out)
+{
+    uint_fast64_t seq = atomic_load_explicit(&_creq_date_cache.seq, memory_order_acquire);
+    if ((seq & 1) != 0 || atomic_load_explicit(&_creq_date_cache.second, memory_order_relaxed) != second)
+    {
+        return false;
+    }
+    uint_fast64_t words[_CREQ_DATE_WORDS];
+    for (int i = 0; i < _CREQ_DATE_WORDS; i++)
+    {
+        words[i] = atomic_load_explicit(&_creq_date_cache.words[i], memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&_creq_date_cache.seq, memory_order_relaxed) != seq)
+    {
+        return false;
+    }
+    char text[sizeof(words)];
+    for (int i = 0; i < _CREQ_DATE_WORDS; i++)
+    {
+        for (int b = 0; b < 8; b++)
+        {
+            text[i * 8 + b] = (char)(words[i] >> (b * 8) & 0xff);
+        }
+    }
+    memcpy(out, text, CREQ_HTTP_DATE_LEN);
+    return true;
+}
+
+CREQ_PRIVATE(void)
+_creq_date_cache_publish(long long second, const char *date)
+{
+    uint_fast64_t seq = atomic_load_explicit(&_creq_date_cache.seq, memory_order_relaxed);
+    if ((seq & 1) != 0 || !atomic_compare_exchange_strong_explicit(&_creq_date_cache.seq, &seq, seq + 1,
+                                                                   memory_order_acquire, memory_order_relaxed))
+    {
+        return;
+    }
+    atomic_thread_fence(memory_order_release);
+    char text[_CREQ_DATE_WORDS * 8] = {0};
+    memcpy(text, date, CREQ_HTTP_DATE_LEN);
+    for (int i = 0; i < _CREQ_DATE_WORDS; i++)
+    {
+        uint_fast64_t word = 0;
+        for (int b = 0; b < 8; b++)
+        {
+            word |= (uint_fast64_t)(unsigned char)text[i * 8 + b] << (b * 8);
+        }
+        atomic_store_explicit(&_creq_date_cache.words[i], word, memory_order_relaxed);
+    }
+    atomic_store_explicit(&_creq_date_cache.second, second, memory_order_relaxed);
+    atomic_store_explicit(&_creq_date_cache.seq, seq + 2, memory_order_release);
+}
+#else
+// Without atomics every thread keeps its own copy.
+static _CREQ_THREAD_LOCAL long long _creq_date_cache_second = 0;
+static _CREQ_THREAD_LOCAL char _creq_date_cache_text[CREQ_HTTP_DATE_LEN];
+
+CREQ_PRIVATE(bool)
+_creq_date_cache_read(long long second, char *out)
+{
+    if (_creq_date_cache_second != second)
+    {
+        return false;
+    }
+    memcpy(out, _creq_date_cache_text, CREQ_HTTP_DATE_LEN);
+    return true;
+}
+
+CREQ_PRIVATE(void)
+_creq_date_cache_publish(long long second, const char *date)
+{
+    memcpy(_creq_date_cache_text, date, CREQ_HTTP_DATE_LEN);
+    _creq_date_cache_second = second;
+}
+#endif
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_add_date_header(creq_Response_t *resp)
+{
+    if (resp == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    long long now = (long long)time(NULL);
+    if (!_creq_date_cache_read(now, resp->date_buf))
+    {
+        _creq_format_imf_fixdate(now, resp->date_buf);
+        _creq_date_cache_publish(now, resp->date_buf);
+    }
+    resp->date_buf[CREQ_HTTP_DATE_LEN] = '\0';
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_HeaderKey_t key = _creq_header_key_from_id(CREQ_HDR_DATE);
+    return _creq_header_store_set(&store, &key, resp->date_buf, CREQ_HTTP_DATE_LEN, true);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_message_body_content_len(creq_Response_t *resp, char *msg)
+{
+    if (creq_Response_set_message_body(resp, msg) == CREQ_STATUS_FAILED)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Response_update_content_len(resp);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_message_body_literal(creq_Response_t *resp, const char *msg_s)
+{
+    return creq_Response_set_message_body_bytes(resp, msg_s, msg_s == NULL ? 0 : strlen(msg_s), OWN_BORROW);
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_message_body_literal_content_len(creq_Response_t *resp, const char *msg_s)
+{
+    if (creq_Response_set_message_body_literal(resp, msg_s) == CREQ_STATUS_FAILED)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    return creq_Response_update_content_len(resp);
+}
+
+CREQ_PUBLIC(char *)
+creq_Response_get_message_body(creq_Response_t *resp)
+{
+    if (resp == NULL)
+        return NULL;
+    return resp->message_body;
+}
+
+CREQ_PUBLIC(creq_status_t)
+creq_Response_set_header_profile(creq_Response_t *resp, creq_HeaderProfile_t *profile)
+{
+    if (resp == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    creq_HeaderProfile_retain(profile);
+    creq_HeaderProfile_release(resp->header_profile);
+    resp->header_profile = profile;
+    resp->is_verified = false;
+    _creq_serial_cache_touch(resp->serial_cache);
+    return CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(size_t)
+creq_Response_get_message_body_len(creq_Response_t *resp)
+{
+    if (resp == NULL)
+        return 0;
+    return resp->message_body_len;
+}
+
+/// @brief Whether the object may be serialized: always, unless CONF_OPT_VALIDATE asks for it to be valid first.
+CREQ_PRIVATE(bool)
+_creq_Response_may_emit(creq_Response_t *resp)
+{
+    return !(resp->options & CONF_OPT_VALIDATE) ||
+           creq_Response_validate(resp) == CREQ_STATUS_SUCC;
+}
+
+CREQ_PUBLIC(char *)
+creq_Response_stringify(creq_Response_t *resp)
+{
+    if (resp == NULL || !_creq_Response_may_emit(resp))
+        return NULL;
+    _creq_MessageView_t view;
+    _creq_view_from_response(&view, resp);
+    return _creq_view_stringify(&view);
+}
+
+CREQ_PUBLIC(const char *)
+creq_Response_stringify_cached(creq_Response_t *resp, size_t *len)
+{
+    if (len != NULL)
+        *len = 0;
+    if (resp == NULL || !_creq_Response_may_emit(resp))
+        return NULL;
+    if (resp->serial_cache == NULL)
+    {
+        resp->serial_cache = (creq_SerialCache_t *)_creq_malloc_n_init(sizeof(struct creq_SerialCache));
+        if (resp->serial_cache == NULL)
+            return NULL;
+    }
+    creq_SerialCache_t *cache = resp->serial_cache;
+    if (cache->is_clean)
+    {
+        if (len != NULL)
+            *len = cache->len;
+        return cache->buf;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_response(&view, resp);
+    return _creq_serial_cache_build(cache, &view, len);
+}
+
+CREQ_PUBLIC(size_t)
+creq_Response_stringify_into(creq_Response_t *resp, char *buf, size_t cap, size_t *needed)
+{
+    if (resp == NULL || !_creq_Response_may_emit(resp))
+    {
+        if (needed != NULL)
+            *needed = 0;
+        return 0;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_response(&view, resp);
+    return _creq_view_stringify_into(&view, buf, cap, needed);
+}
+
+CREQ_PUBLIC(size_t)
+creq_Response_to_iovec(creq_Response_t *resp, creq_IoVec_t *iov, size_t iov_cap, creq_IoVecScratch_t *scratch,
+                       size_t *needed)
+{
+    if (resp == NULL || !_creq_Response_may_emit(resp))
+    {
+        if (needed != NULL)
+            *needed = 0;
+        return 0;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_response(&view, resp);
+    return _creq_view_to_iovec(&view, iov, iov_cap < CREQ_IOV_MAX ? iov_cap : CREQ_IOV_MAX, scratch, needed);
+}
+
+/*
+ * Chunked transfer coding, RFC 7230 Section 4.1:
+ *
+ *   chunked-body = *chunk last-chunk trailer-part CRLF
+ *   chunk        = chunk-size [ chunk-ext ] CRLF chunk-data CRLF
+ *   last-chunk   = 1*("0") [ chunk-ext ] CRLF
+ *
+ * Chunk lines use the line ending configured for the response. No chunk extensions are generated.
+ */
+
+/// @brief Writes the size line of a chunk and returns its length. 'out' must hold CREQ_CHUNK_MAX_OVERHEAD chars.
+CREQ_PRIVATE(size_t)
+_creq_chunk_size_line(const creq_ChunkedEncoder_t *enc, size_t size, char *out)
+{
+    size_t len = _creq_format_hex(size, out);
+    memcpy(out + len, enc->line_ending, enc->line_ending_len);
+    return len + enc->line_ending_len;
+}
+
+/// @return The last Transfer-Encoding field a response emits, its own headers hiding those of its profile, or NULL.
+CREQ_PRIVATE(const creq_HeaderField_t *)
+_creq_Response_last_coding(const creq_Response_t *resp)
+{
+    for (size_t i = cvector_size(resp->header_vector); i-- > 0;)
+    {
+        if (resp->header_vector[i].field_id == CREQ_HDR_TRANSFER_ENCODING)
+            return &resp->header_vector[i];
+    }
+    for (size_t i = resp->header_profile == NULL ? 0 : resp->header_profile->count; i-- > 0;)
+    {
+        if (resp->header_profile->fields[i].field_id == CREQ_HDR_TRANSFER_ENCODING)
+            return &resp->header_profile->fields[i];
+    }
+    return NULL;
+}
+
+/// @brief Tells whether the last coding of a Transfer-Encoding list is chunked, compared case-insensitively.
+CREQ_PRIVATE(bool)
+_creq_codings_end_with_chunked(const char *value, size_t len)
+{
+    while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t'))
+    {
+        len--;
+    }
+    size_t start = len;
+    while (start > 0 && value[start - 1] != ',' && value[start - 1] != ' ' && value[start - 1] != '\t')
+    {
+        start--;
+    }
+    return len - start == 7 && _creq_header_name_eq(value + start, "chunked", 7);
+}
+
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_begin(creq_ChunkedEncoder_t *enc, creq_Response_t *resp, char *buf, size_t cap, size_t *needed)
+{
+    if (needed != NULL)
+        *needed = 0;
+    if (enc == NULL || resp == NULL || !_creq_Response_may_emit(resp))
+    {
+        return 0;
+    }
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    _creq_HeaderKey_t lengthKey = _creq_header_key_from_id(CREQ_HDR_CONTENT_LENGTH);
+    const creq_HeaderField_t *pCoding = _creq_Response_last_coding(resp);
+    bool hasCoding = pCoding != NULL;
+    if (hasCoding && !_creq_codings_end_with_chunked(pCoding->field_value, pCoding->field_value_len))
+    {
+        // chunked framing after a head announcing another final coding would be a malformed message
+        return 0;
+    }
+
+    // The head is sized as it will be, so that a call that only sizes it or fails leaves the headers alone.
+    _creq_MessageView_t view;
+    _creq_view_from_response(&view, resp);
+    _creq_view_hide_profile_id(&view, CREQ_HDR_CONTENT_LENGTH);
+    view.body = "";
+    view.body_len = 0;
+    size_t total = _creq_view_length(&view);
+    for (size_t i = 0; i < view.header_count; i++)
+    {
+        if (view.header_vector[i].field_id == CREQ_HDR_CONTENT_LENGTH)
+            total -= _creq_HeaderField_line_length(&view.header_vector[i], view.line_ending_len);
+    }
+    if (!hasCoding)
+    {
+        creq_HeaderField_t coding;
+        _creq_HeaderField_init_id(NULL, NULL, &coding, CREQ_HDR_TRANSFER_ENCODING, "chunked", 7, true);
+        total += _creq_HeaderField_line_length(&coding, view.line_ending_len);
+        if (_creq_view_has_no_headers(&view))
+            total -= view.line_ending_len;
+    }
+    if (needed != NULL)
+        *needed = total;
+    if (buf == NULL || cap < total)
+    {
+        return 0;
+    }
+
+    if (!hasCoding &&
+        _creq_header_store_add(&store, CREQ_HDR_TRANSFER_ENCODING, NULL, 0, "chunked", 7, true) == CREQ_STATUS_FAILED)
+    {
+        return 0;
+    }
+    for (int idx; (idx = _creq_header_store_find_from(&store, &lengthKey, 0)) >= 0;)
+    {
+        _creq_header_store_remove(&store, (size_t)idx);
+    }
+    _creq_view_from_response(&view, resp);
+    _creq_view_hide_profile_id(&view, CREQ_HDR_CONTENT_LENGTH);
+    view.body = "";
+    view.body_len = 0;
+    enc->line_ending = view.line_ending;
+    enc->line_ending_len = view.line_ending_len;
+    enc->is_finished = false;
+    enc->is_validating = (resp->options & CONF_OPT_VALIDATE) != 0;
+    return _creq_view_stringify_into(&view, buf, cap, needed);
+}
+
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_write_chunk(creq_ChunkedEncoder_t *enc, const void *data, size_t len, char *buf, size_t cap,
+                                size_t *needed)
 {
-    if (req == NULL || req->header_vector == NULL || header == NULL)
+    if (needed != NULL)
+        *needed = 0;
+    if (enc == NULL || enc->is_finished || len == 0 || data == NULL)
     {
-        return -1;
+        return 0;
     }
-    for (int i = 0; i < cvector_size(req->header_vector); ++i)
+    char sizeLine[CREQ_CHUNK_MAX_OVERHEAD];
+    size_t sizeLineLen = _creq_chunk_size_line(enc, len, sizeLine);
+    size_t total = sizeLineLen + len + enc->line_ending_len;
+    if (needed != NULL)
+        *needed = total;
+    if (buf == NULL || cap < total)
     {
-        if (!strcmp(req->header_vector[i]->field_name, header))
-        {
-            return i;
-        }
+        return 0;
     }
-    return -1;
+    memcpy(buf, sizeLine, sizeLineLen);
+    memcpy(buf + sizeLineLen, data, len);
+    memcpy(buf + sizeLineLen + len, enc->line_ending, enc->line_ending_len);
+    return total;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_remove_header(creq_Request_t *req, char *header)
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_pull_chunk(creq_ChunkedEncoder_t *enc, creq_ChunkSource_t source, void *user_data, char *buf,
+                               size_t cap, size_t *offset)
 {
-    if (req == NULL || header == NULL)
+    if (enc == NULL || enc->is_finished || source == NULL || buf == NULL || offset == NULL)
     {
-        return CREQ_STATUS_FAILED;
+        return 0;
     }
-    int idx = creq_Request_search_for_header_index(req, header);
-    if (idx >= 0)
+    // The size line is right-aligned in a reserved prefix so that the data is produced in place and never moved.
+    size_t reserved = 2 * sizeof(size_t) + enc->line_ending_len;
+    if (cap <= reserved + enc->line_ending_len)
     {
-        creq_HeaderField_t *pNode = req->header_vector[idx];
-        creq_HeaderField_free(&pNode);
-        cvector_erase(req->header_vector, idx);
-        return CREQ_STATUS_SUCC;
+        return 0;
     }
-    return CREQ_STATUS_FAILED;
+    size_t len = source(user_data, buf + reserved, cap - reserved - enc->line_ending_len);
+    if (len == 0)
+    {
+        return 0;
+    }
+    char sizeLine[CREQ_CHUNK_MAX_OVERHEAD];
+    size_t sizeLineLen = _creq_chunk_size_line(enc, len, sizeLine);
+    *offset = reserved - sizeLineLen;
+    memcpy(buf + *offset, sizeLine, sizeLineLen);
+    memcpy(buf + reserved + len, enc->line_ending, enc->line_ending_len);
+    return sizeLineLen + len + enc->line_ending_len;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_remove_header_direct(creq_Request_t *req, creq_HeaderField_t *header)
+CREQ_PRIVATE(bool)
+_creq_validate_headers(const creq_HeaderField_t *fields, size_t count);
+
+CREQ_PUBLIC(size_t)
+creq_ChunkedEncoder_finish(creq_ChunkedEncoder_t *enc, creq_HeaderField_t *const *trailers, size_t trailer_count,
+                           char *buf, size_t cap, size_t *needed)
 {
-    if (req == NULL || header == NULL)
+    if (needed != NULL)
+        *needed = 0;
+    if (enc == NULL || enc->is_finished || (trailers == NULL && trailer_count != 0))
     {
-        return CREQ_STATUS_FAILED;
+        return 0;
     }
-    for (int i = 0; i < cvector_size(req->header_vector); ++i)
+    size_t total = 1 + enc->line_ending_len * 2;
+    for (size_t i = 0; i < trailer_count; i++)
     {
-        if (req->header_vector[i] == header)
+        if (enc->is_validating && !_creq_validate_headers(trailers[i], 1))
         {
-            creq_HeaderField_t *pNode = req->header_vector[i];
-            creq_HeaderField_free(&pNode);
-            cvector_erase(req->header_vector, i);
-            return CREQ_STATUS_SUCC;
+            return 0;
         }
+        total += _creq_HeaderField_line_length(trailers[i], enc->line_ending_len);
     }
-
-    return CREQ_STATUS_FAILED;
+    if (needed != NULL)
+        *needed = total;
+    if (buf == NULL || cap < total)
+    {
+        return 0;
+    }
+    char *dest = buf + _creq_chunk_size_line(enc, 0, buf);
+    for (size_t i = 0; i < trailer_count; i++)
+    {
+        dest = _creq_HeaderField_emit_line(trailers[i], dest, enc->line_ending, enc->line_ending_len);
+    }
+    memcpy(dest, enc->line_ending, enc->line_ending_len);
+    enc->is_finished = true;
+    return total;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_set_message_body(creq_Request_t *req, char *msg, bool is_literal)
+/*
+ * Message templates. Compiling walks the pieces of a message view: runs of constant pieces are concatenated into one
+ * buffer and each slot splits them. Rendering alternates memcpy() of a constant run and of a slot value.
+ */
+
+typedef struct _creq_TemplateRun
 {
-    if (req == NULL)
+    size_t offset;
+    size_t len;
+    /// Index of the slot following the run, or -1 after the last run.
+    int slot;
+} _creq_TemplateRun_t;
+
+struct creq_Template
+{
+    size_t slot_count;
+    /// Slot whose value is the body, or -1 if the body is constant.
+    int body_slot;
+    /// Length of the body when it is constant.
+    size_t constant_body_len;
+    size_t run_count;
+    char *constant;
+    size_t constant_len;
+    creq_TemplateSlotKind_t *slot_kinds;
+    _creq_TemplateRun_t runs[];
+};
+
+/// @brief Compiles a view whose slots are given as piece indices.
+CREQ_PRIVATE(creq_Template_t *)
+_creq_Template_compile(const _creq_MessageView_t *view, const creq_TemplateSlot_t *slots, const size_t *slotPieces,
+                       size_t slotCount)
+{
+    size_t pieceCount = _creq_view_piece_count(view), constantLen = 0, len = 0;
+    for (size_t i = 0; i < pieceCount; i++)
     {
-        return CREQ_STATUS_FAILED;
+        _creq_view_piece(view, i, &len);
+        constantLen += len;
     }
-    if (is_literal)
+    size_t bytes = sizeof(creq_Template_t) + sizeof(_creq_TemplateRun_t) * (slotCount + 1) +
+                   sizeof(creq_TemplateSlotKind_t) * slotCount + constantLen;
+    creq_Template_t *tpl = (creq_Template_t *)creq_malloc(bytes);
+    if (tpl == NULL)
     {
-        if (!req->is_message_body_literal)
-            CREQ_GUARDED_FREE(req->message_body);
-        if (msg == NULL)
+        return NULL;
+    }
+    tpl->slot_count = slotCount;
+    tpl->body_slot = -1;
+    tpl->constant_body_len = view->body_len;
+    tpl->run_count = 0;
+    tpl->slot_kinds = (creq_TemplateSlotKind_t *)&tpl->runs[slotCount + 1];
+    tpl->constant = (char *)&tpl->slot_kinds[slotCount];
+    tpl->constant_len = 0;
+
+    _creq_TemplateRun_t *pRun = &tpl->runs[0];
+    pRun->offset = 0;
+    pRun->len = 0;
+    for (size_t i = 0; i < pieceCount; i++)
+    {
+        int slot = -1;
+        for (size_t s = 0; s < slotCount; s++)
         {
-            req->message_body = NULL;
-            return CREQ_STATUS_SUCC;
+            if (slotPieces[s] == i)
+            {
+                slot = (int)s;
+                break;
+            }
         }
-        req->message_body = (char *)msg;
-        req->is_message_body_literal = true;
+        const char *piece = _creq_view_piece(view, i, &len);
+        if (slot < 0)
+        {
+            memcpy(tpl->constant + tpl->constant_len, piece, len);
+            tpl->constant_len += len;
+            pRun->len += len;
+            continue;
+        }
+        pRun->slot = slot;
+        pRun++;
+        pRun->offset = tpl->constant_len;
+        pRun->len = 0;
     }
-    else
+    pRun->slot = -1;
+    tpl->run_count = (size_t)(pRun - tpl->runs) + 1;
+    for (size_t s = 0; s < slotCount; s++)
     {
-        if (!req->is_message_body_literal)
-            CREQ_GUARDED_FREE(req->message_body);
-        if (msg == NULL)
+        tpl->slot_kinds[s] = slots[s].kind;
+        if (slots[s].kind == TPL_SLOT_BODY)
         {
-            req->message_body = NULL;
-            return CREQ_STATUS_SUCC;
+            tpl->body_slot = (int)s;
         }
-        char *pMsgCopy = _creq_malloc_strcpy(msg);
-        req->message_body = pMsgCopy;
-        req->is_message_body_literal = false;
     }
-    return CREQ_STATUS_SUCC;
+    return tpl;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Request_set_message_body_content_len(creq_Request_t *req, char *msg, bool is_literal)
+/// @brief Maps a header slot to the piece of its value. Returns false if the message itself lacks the header.
+CREQ_PRIVATE(bool)
+_creq_Template_header_piece(const _creq_MessageView_t *view, _creq_HeaderStore_t *store,
+                            const creq_TemplateSlot_t *pSlot, size_t *piece)
 {
-    if (creq_Request_set_message_body(req, msg, is_literal) == CREQ_STATUS_FAILED)
+    if (pSlot->kind == TPL_SLOT_HEADER_VALUE && pSlot->header == NULL)
     {
-        return CREQ_STATUS_FAILED;
+        return false;
     }
-    creq_Request_remove_header(req, "Content-Length");
-    size_t content_len = strlen(req->message_body);
-    char *content_len_s = NULL;
-    int content_len_s_len = snprintf(NULL, 0, "%zu", content_len);
-    content_len_s = (char *)_creq_malloc_n_init(sizeof(char) * (content_len_s_len + 1));
-    snprintf(content_len_s, content_len_s_len + 1, "%zu", content_len);
-    creq_Request_add_header(req, "Content-Length", content_len_s, false); // content_len_s is never a literal.
-    CREQ_GUARDED_FREE(content_len_s);
-    return CREQ_STATUS_SUCC;
+    _creq_HeaderKey_t key = pSlot->kind == TPL_SLOT_CONTENT_LENGTH
+                                ? _creq_header_key_from_id(CREQ_HDR_CONTENT_LENGTH)
+                                : _creq_header_key(pSlot->header, strlen(pSlot->header));
+    int idx = _creq_header_store_find_from(store, &key, 0);
+    if (idx < 0)
+    {
+        return false;
+    }
+    *piece = _CREQ_START_LINE_PIECES + (view->profile_count + (size_t)idx) * 4 + 2;
+    return true;
 }
 
-CREQ_PUBLIC(char *)
-creq_Request_get_message_body(creq_Request_t *req)
+/// @brief Resolves every slot to a distinct piece. 'targetPiece' is 0 for messages without a target.
+CREQ_PRIVATE(bool)
+_creq_Template_resolve(const _creq_MessageView_t *view, _creq_HeaderStore_t *store, size_t targetPiece,
+                       const creq_TemplateSlot_t *slots, size_t slotCount, size_t *slotPieces)
 {
-    if (req == NULL)
+    for (size_t s = 0; s < slotCount; s++)
+    {
+        switch (slots[s].kind)
+        {
+        case TPL_SLOT_TARGET:
+            if (targetPiece == 0)
+                return false;
+            slotPieces[s] = targetPiece;
+            break;
+        case TPL_SLOT_HEADER_VALUE:
+        case TPL_SLOT_CONTENT_LENGTH:
+            if (!_creq_Template_header_piece(view, store, &slots[s], &slotPieces[s]))
+                return false;
+            break;
+        case TPL_SLOT_BODY:
+            slotPieces[s] = _creq_view_piece_count(view) - 1;
+            break;
+        default:
+            return false;
+        }
+        for (size_t t = 0; t < s; t++)
+        {
+            if (slotPieces[t] == slotPieces[s])
+                return false;
+        }
+    }
+    return true;
+}
+
+#define _CREQ_TEMPLATE_MAX_SLOTS 64
+
+CREQ_PUBLIC(creq_Template_t *)
+creq_Template_compile_request(creq_Request_t *req, const creq_TemplateSlot_t *slots, size_t slot_count)
+{
+    size_t slotPieces[_CREQ_TEMPLATE_MAX_SLOTS];
+    if (req == NULL || (slots == NULL && slot_count != 0) || slot_count > _CREQ_TEMPLATE_MAX_SLOTS ||
+        !_creq_Request_may_emit(req))
     {
         return NULL;
     }
-    return req->message_body;
+    _creq_MessageView_t view;
+    _creq_view_from_request(&view, req);
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    if (!_creq_Template_resolve(&view, &store, 2, slots, slot_count, slotPieces))
+    {
+        return NULL;
+    }
+    return _creq_Template_compile(&view, slots, slotPieces, slot_count);
 }
 
-CREQ_PUBLIC(char *)
-creq_Request_stringify(creq_Request_t *req)
+CREQ_PUBLIC(creq_Template_t *)
+creq_Template_compile_response(creq_Response_t *resp, const creq_TemplateSlot_t *slots, size_t slot_count)
 {
-    if (req == NULL)
+    size_t slotPieces[_CREQ_TEMPLATE_MAX_SLOTS];
+    if (resp == NULL || (slots == NULL && slot_count != 0) || slot_count > _CREQ_TEMPLATE_MAX_SLOTS ||
+        !_creq_Response_may_emit(resp))
+    {
+        return NULL;
+    }
+    _creq_MessageView_t view;
+    _creq_view_from_response(&view, resp);
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    if (!_creq_Template_resolve(&view, &store, 0, slots, slot_count, slotPieces))
     {
         return NULL;
     }
-    char *request_line_s = NULL, *headers_s = NULL, *body_s = NULL;
+    return _creq_Template_compile(&view, slots, slotPieces, slot_count);
+}
+
+CREQ_PUBLIC(size_t)
+creq_Template_render(const creq_Template_t *tpl, const creq_TemplateValue_t *values, char *buf, size_t cap,
+                     size_t *needed)
+{
+    if (needed != NULL)
+        *needed = 0;
+    if (tpl == NULL || (values == NULL && tpl->slot_count != 0))
+    {
+        return 0;
+    }
+    char contentLen[_CREQ_NUM_BUF_LEN];
+    size_t bodyLen = tpl->body_slot >= 0 ? values[tpl->body_slot].len : tpl->constant_body_len;
+    size_t contentLenLen = _creq_format_uint(bodyLen, contentLen);
+    size_t total = tpl->constant_len;
+    for (size_t s = 0; s < tpl->slot_count; s++)
+    {
+        total += tpl->slot_kinds[s] == TPL_SLOT_CONTENT_LENGTH ? contentLenLen : values[s].len;
+    }
+    if (needed != NULL)
+        *needed = total;
+    if (buf == NULL || cap < total)
+    {
+        return 0;
+    }
+    char *dest = buf;
+    for (size_t r = 0; r < tpl->run_count; r++)
+    {
+        const _creq_TemplateRun_t *pRun = &tpl->runs[r];
+        memcpy(dest, tpl->constant + pRun->offset, pRun->len);
+        dest += pRun->len;
+        if (pRun->slot < 0)
+        {
+            break;
+        }
+        if (tpl->slot_kinds[pRun->slot] == TPL_SLOT_CONTENT_LENGTH)
+        {
+            memcpy(dest, contentLen, contentLenLen);
+            dest += contentLenLen;
+        }
+        else if (values[pRun->slot].len != 0)
+        {
+            memcpy(dest, values[pRun->slot].data, values[pRun->slot].len);
+            dest += values[pRun->slot].len;
+        }
+    }
+    return total;
+}
+
+CREQ_PUBLIC(void)
+creq_Template_free(creq_Template_t *tpl)
+{
+    creq_free(tpl);
+}
+
+/*
+ * Syntax validation, RFC 7230. Every byte class is one bit of a 256-entry table. Runs of 16 bytes or more are first
+ * checked 32 or 16 bytes at a time with SIMD compares, field names through a nibble-indexed table lookup under AVX2.
+ * Blocks the vector check rejects go through the scalar table.
+ */
+
+enum
+{
+    /// tchar: methods and field names
+    _CREQ_CC_TCHAR = 1,
+    /// field-vchar, obs-text, SP and HTAB: field values and reason phrases
+    _CREQ_CC_TEXT = 2,
+    /// VCHAR: request targets
+    _CREQ_CC_TARGET = 4
+};
+
+static const unsigned char _creq_char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    2, 7, 6, 7, 7, 7, 7, 7, 6, 6, 7, 7, 6, 7, 7, 6, // 0x20
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 6, 6, 6, // 0x30
+    6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, // 0x40
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 7, 7, // 0x50
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, // 0x60
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 7, 6, 7, 0, // 0x70
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0x80
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0x90
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xA0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xB0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xC0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xD0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xE0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, // 0xF0
+};
+
+_CREQ_INLINE(bool)
+_creq_is_class_scalar(const char *s, size_t len, unsigned cls)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!(_creq_char_class[(unsigned char)s[i]] & cls))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef _CREQ_SIMD_SSE2
+/// @brief Whether 16 bytes are all in class 'cls'. May answer false for tchars other than letters, digits and '-'.
+_CREQ_INLINE(bool)
+_creq_sse2_block_is_class(const char *s, unsigned cls)
+{
+    const __m128i v = _mm_loadu_si128((const __m128i *)s);
+    __m128i bad;
+    if (cls == _CREQ_CC_TCHAR)
+    {
+        // no byte shuffle before SSSE3, so only the characters of nearly every real field name are recognized here
+        const __m128i alpha = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        const __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        __m128i ok = _mm_cmpeq_epi8(_mm_max_epu8(alpha, _mm_set1_epi8(25)), _mm_set1_epi8(25));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(_mm_max_epu8(digit, _mm_set1_epi8(9)), _mm_set1_epi8(9)));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+        return _mm_movemask_epi8(ok) == 0xFFFF;
+    }
+    if (cls == _CREQ_CC_TEXT)
+    {
+        // CTLs but HTAB, and DEL
+        const __m128i ctlMax = _mm_set1_epi8(0x1F);
+        bad = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                               _mm_cmpeq_epi8(_mm_max_epu8(v, ctlMax), ctlMax));
+    }
+    else
+    {
+        // signed compare: anything below '!' or from 0x80 on
+        bad = _mm_cmpgt_epi8(_mm_set1_epi8(0x21), v);
+    }
+    return _mm_movemask_epi8(_mm_or_si128(bad, _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7F)))) == 0;
+}
+#endif
+
+#ifdef _CREQ_SIMD_AVX2_RUNTIME
+// Code for another target cannot be inlined into the callers, so the AVX2 path is entered through one real call.
+#define _CREQ_AVX2_INLINE(type) __attribute__((target("avx2"))) _CREQ_INLINE(type)
+#define _CREQ_AVX2_ENTRY(type) __attribute__((target("avx2"), noinline)) static type
+#define _CREQ_HAS_AVX2() __builtin_cpu_supports("avx2")
+#elif defined(_CREQ_SIMD_AVX2)
+#define _CREQ_AVX2_INLINE(type) _CREQ_INLINE(type)
+#define _CREQ_AVX2_ENTRY(type) _CREQ_INLINE(type)
+#define _CREQ_HAS_AVX2() 1
+#endif
 
-    const char *line_ending_s = _creq_get_line_ending_str(&req->config, CONF_REQUEST);
-    const char *http_meth_s = _creq_get_http_method_str(req->method);
-    char *http_version_s = _creq_get_http_version_str(req->http_version.major, req->http_version.minor);
+#ifdef _CREQ_SIMD_AVX2
+/// @brief Whether 32 bytes are all in class 'cls'.
+_CREQ_AVX2_INLINE(bool)
+_creq_avx2_block_is_class(const char *s, unsigned cls)
+{
+    const __m256i v = _mm256_loadu_si256((const __m256i *)s);
+    __m256i bad;
+    if (cls == _CREQ_CC_TCHAR)
+    {
+        // a byte is a tchar iff the bit its high nibble selects is set in the entry of its low nibble
+        const __m256i loTable = _mm256_setr_epi8(0x3a, 0x3f, 0x3e, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3e, 0x3e, 0x3d, 0x15,
+                                                 0x34, 0x15, 0x3d, 0x1c, 0x3a, 0x3f, 0x3e, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f,
+                                                 0x3e, 0x3e, 0x3d, 0x15, 0x34, 0x15, 0x3d, 0x1c);
+        const __m256i hiTable = _mm256_setr_epi8(0, 0, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        __m256i lo = _mm256_shuffle_epi8(loTable, _mm256_and_si256(v, nibble));
+        __m256i hi = _mm256_shuffle_epi8(hiTable, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256())) == 0;
+    }
+    if (cls == _CREQ_CC_TEXT)
+    {
+        const __m256i ctlMax = _mm256_set1_epi8(0x1F);
+        bad = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                                  _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctlMax), ctlMax));
+    }
+    else
+    {
+        bad = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x21), v);
+    }
+    return _mm256_movemask_epi8(_mm256_or_si256(bad, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7F)))) == 0;
+}
 
-    int request_line_len =
-        snprintf(NULL, 0, _creq_FMT_REQUEST_LINE, http_meth_s, req->request_target, http_version_s, line_ending_s);
-    request_line_s = (char *)_creq_malloc_n_init(sizeof(char) * (request_line_len + 1));
-    snprintf(request_line_s, request_line_len + 1, _creq_FMT_REQUEST_LINE, http_meth_s, req->request_target,
-             http_version_s, line_ending_s);
-    CREQ_GUARDED_FREE(http_version_s);
-    // we now have a request_line_s string. Others are garbage now, except for line_ending_s
+/// @brief Checks the whole 32-byte blocks at the start of 's'.
+/// @return The number of bytes checked, or SIZE_MAX as soon as one is not in class 'cls'.
+_CREQ_AVX2_INLINE(size_t)
+_creq_avx2_prefix_is_class(const char *s, size_t len, unsigned cls)
+{
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        if (!_creq_avx2_block_is_class(s + i, cls) && !_creq_is_class_scalar(s + i, 32, cls))
+        {
+            return SIZE_MAX;
+        }
+    }
+    return i;
+}
 
-    size_t header_list_len = cvector_size(req->header_vector);
-    if (header_list_len != 0)
+/// @brief _creq_avx2_prefix_is_class() with the class folded in as a constant, as the entry to the AVX2 path.
+_CREQ_AVX2_ENTRY(size_t)
+_creq_avx2_prefix_is_class_any(const char *s, size_t len, unsigned cls)
+{
+    switch (cls)
     {
-        size_t idx = 0;
-        int str_len = 0;
-        cvector_VECTOR(creq_HeaderField_t *) hv = req->header_vector;
+    case _CREQ_CC_TCHAR:
+        return _creq_avx2_prefix_is_class(s, len, _CREQ_CC_TCHAR);
+    case _CREQ_CC_TEXT:
+        return _creq_avx2_prefix_is_class(s, len, _CREQ_CC_TEXT);
+    default:
+        return _creq_avx2_prefix_is_class(s, len, _CREQ_CC_TARGET);
+    }
+}
+#endif
 
-        for (idx = 0; idx < header_list_len; idx++)
+/// @brief Whether every byte of 's' is in class 'cls'. A block the vector check rejects is checked again byte by
+/// byte, and a short tail is covered by one last block overlapping the previous one.
+_CREQ_INLINE(bool)
+_creq_is_class(const char *s, size_t len, unsigned cls)
+{
+    size_t i = 0;
+#ifdef _CREQ_SIMD_AVX2
+    if (len >= 32 && _CREQ_HAS_AVX2())
+    {
+        i = _creq_avx2_prefix_is_class_any(s, len, cls);
+        if (i == SIZE_MAX)
         {
-            str_len += snprintf(NULL, 0, _creq_FMT_HEADER, hv[idx]->field_name, hv[idx]->field_value, line_ending_s);
+            return false;
         }
-        headers_s = (char *)_creq_malloc_n_init(sizeof(char) * (str_len + 1));
-        for (idx = 0; idx < header_list_len; idx++)
+    }
+#endif
+#ifdef _CREQ_SIMD_SSE2
+    for (; i + 16 <= len; i += 16)
+    {
+        if (!_creq_sse2_block_is_class(s + i, cls) && !_creq_is_class_scalar(s + i, 16, cls))
         {
-            char *str;
-            int len = snprintf(NULL, 0, _creq_FMT_HEADER, hv[idx]->field_name, hv[idx]->field_value, line_ending_s);
-            str = (char *)_creq_malloc_n_init(sizeof(char) * (len + 1));
-            snprintf(str, len + 1, _creq_FMT_HEADER, hv[idx]->field_name, hv[idx]->field_value, line_ending_s);
-            strcat(headers_s, str);
-            CREQ_GUARDED_FREE(str);
+            return false;
         }
     }
+    if (i < len && len >= 16)
+    {
+        return _creq_sse2_block_is_class(s + len - 16, cls) || _creq_is_class_scalar(s + len - 16, 16, cls);
+    }
+#endif
+    return _creq_is_class_scalar(s + i, len - i, cls);
+}
 
-    body_s = req->message_body;
+CREQ_PRIVATE(bool)
+_creq_is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
 
-    char *full_req_s = NULL;
-    int full_req_len =
-        snprintf(NULL, 0, _creq_FMT_FULL_REQUEST, request_line_s, headers_s == NULL ? line_ending_s : headers_s,
-                 line_ending_s, body_s == NULL ? "" : body_s);
-    full_req_s = (char *)_creq_malloc_n_init(sizeof(char) * (full_req_len + 1));
-    snprintf(full_req_s, full_req_len + 1, _creq_FMT_FULL_REQUEST, request_line_s,
-             headers_s == NULL ? line_ending_s : headers_s, line_ending_s, body_s == NULL ? "" : body_s);
+/// @brief Whether 's' is a run of field-vchar and whitespace, as field values and reason phrases must be.
+CREQ_PRIVATE(bool)
+_creq_is_field_text(const char *s, size_t len)
+{
+    return _creq_is_class(s, len, _CREQ_CC_TEXT);
+}
 
-    CREQ_GUARDED_FREE(request_line_s);
-    CREQ_GUARDED_FREE(headers_s);
+/// @brief Whether 's' is a token, RFC 7230 Section 3.2.6, as methods and field names must be.
+CREQ_PRIVATE(bool)
+_creq_is_token(const char *s, size_t len)
+{
+    return len != 0 && _creq_is_class(s, len, _CREQ_CC_TCHAR);
+}
 
-    return full_req_s;
+/// @brief Whether a request target is non-empty and made of VCHAR only. Its finer URI syntax is not checked.
+CREQ_PRIVATE(bool)
+_creq_is_target(const char *s, size_t len)
+{
+    return len != 0 && _creq_is_class(s, len, _CREQ_CC_TARGET);
 }
 
-CREQ_PUBLIC(creq_Response_t *)
-creq_Response_create(creq_Config_t *conf)
+CREQ_PRIVATE(bool)
+_creq_validate_headers(const creq_HeaderField_t *fields, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const creq_HeaderField_t *pField = &fields[i];
+        if (!_creq_is_token(pField->field_name, pField->field_name_len) ||
+            (pField->field_value_len != 0 && pField->field_value == NULL) ||
+            !_creq_is_field_text(pField->field_value, pField->field_value_len))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+CREQ_PRIVATE(bool)
+_creq_validate_http_version(creq_HttpVersion_t version)
 {
-    creq_Response_t *pResponse = (creq_Response_t *)_creq_malloc_n_init(sizeof(struct creq_Response));
+    return version.major <= 9 && version.minor <= 9;
+}
 
-    if (conf != NULL && conf->config_type == CONF_RESPONSE)
+CREQ_PUBLIC(creq_status_t)
+creq_Request_validate(creq_Request_t *req)
+{
+    if (req == NULL)
     {
-        pResponse->config = *conf;
+        return CREQ_STATUS_FAILED;
     }
-    else
+    if (req->is_verified)
     {
-        creq_Config_t config;
-        config.config_type = CONF_RESPONSE;
-        config.data.response_config.line_ending = LE_CRLF;
-        pResponse->config = config;
+        return CREQ_STATUS_SUCC;
     }
+    if (_creq_get_http_method_str(req->method) == NULL || req->request_target == NULL ||
+        !_creq_is_target(req->request_target, req->request_target_len) ||
+        !_creq_validate_http_version(req->http_version) ||
+        !_creq_validate_headers(req->header_vector, cvector_size(req->header_vector)) ||
+        (req->header_profile != NULL &&
+         !_creq_validate_headers(req->header_profile->fields, req->header_profile->count)))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    req->is_verified = true;
+    return CREQ_STATUS_SUCC;
+}
 
-    pResponse->http_version.major = 0;
-    pResponse->http_version.minor = 0;
-    pResponse->status_code = 0;
-    pResponse->reason_phrase = NULL;
-    pResponse->is_reason_phrase_literal = false;
-    pResponse->message_body = NULL;
-    pResponse->is_message_body_literal = false;
-    pResponse->header_vector = NULL;
+CREQ_PUBLIC(creq_status_t)
+creq_Response_validate(creq_Response_t *resp)
+{
+    if (resp == NULL)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    if (resp->is_verified)
+    {
+        return CREQ_STATUS_SUCC;
+    }
+    if (resp->status_code < 100 || resp->status_code > 999 || !_creq_validate_http_version(resp->http_version) ||
+        (resp->reason_phrase == NULL && resp->reason_phrase_len != 0) ||
+        !_creq_is_field_text(resp->reason_phrase, resp->reason_phrase_len) ||
+        !_creq_validate_headers(resp->header_vector, cvector_size(resp->header_vector)) ||
+        (resp->header_profile != NULL &&
+         !_creq_validate_headers(resp->header_profile->fields, resp->header_profile->count)))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    resp->is_verified = true;
+    return CREQ_STATUS_SUCC;
+}
+
+/*
+ * Incremental parsing. Every call resumes at parser->consumed, the first line not parsed yet, and parser->scanned
+ * remembers how much of that line has already been searched for its LF, so no byte is scanned twice while waiting for
+ * more input. Slices stored into the message point into the caller's buffer and are moved along with it.
+ */
+
+enum
+{
+    _CREQ_PARSE_START_LINE,
+    _CREQ_PARSE_HEADERS,
+    /// request body, stored once it is all there
+    _CREQ_PARSE_BODY,
+    /// the rest are streamed response bodies
+    _CREQ_PARSE_BODY_LENGTH,
+    _CREQ_PARSE_CHUNK_SIZE,
+    _CREQ_PARSE_CHUNK_DATA,
+    _CREQ_PARSE_CHUNK_DATA_END,
+    _CREQ_PARSE_TRAILERS,
+    _CREQ_PARSE_BODY_CLOSE,
+    _CREQ_PARSE_DONE
+};
+
+CREQ_PUBLIC(void)
+creq_Parser_init(creq_Parser_t *parser, const creq_ParseLimits_t *limits)
+{
+    if (parser == NULL)
+    {
+        return;
+    }
+    memset(parser, 0, sizeof(*parser));
+    if (limits != NULL)
+    {
+        parser->limits = *limits;
+    }
+    if (parser->limits.max_header_count == 0)
+    {
+        parser->limits.max_header_count = CREQ_PARSE_DEFAULT_MAX_HEADERS;
+    }
+    if (parser->limits.max_line_len == 0)
+    {
+        parser->limits.max_line_len = CREQ_PARSE_DEFAULT_MAX_LINE_LEN;
+    }
+    parser->error = PARSE_ERR_NONE;
+    parser->request_method = _METH_UNKNOWN;
+    parser->on_body = NULL;
+    parser->user_data = NULL;
+    parser->state = _CREQ_PARSE_START_LINE;
+    parser->base = NULL;
+}
+
+CREQ_PUBLIC(void)
+creq_Parser_init_response(creq_Parser_t *parser, const creq_ParseLimits_t *limits, creq_HttpMethod_t request_method,
+                          creq_BodySink_t on_body, void *user_data)
+{
+    if (parser == NULL)
+    {
+        return;
+    }
+    creq_Parser_init(parser, limits);
+    parser->request_method = request_method;
+    parser->on_body = on_body;
+    parser->user_data = user_data;
+}
+
+CREQ_PRIVATE(creq_status_t)
+_creq_parse_fail(creq_Parser_t *parser, creq_ParseError_t error)
+{
+    parser->error = error;
+    return CREQ_STATUS_FAILED;
+}
+
+/// @brief Takes the next complete line. The line ending is not part of *line.
+/// @retval CREQ_STATUS_INCOMPLETE No LF yet. What has been searched is remembered.
+CREQ_PRIVATE(creq_status_t)
+_creq_parse_next_line(creq_Parser_t *parser, const char *buf, size_t len, const char **line, size_t *lineLen)
+{
+    const char *start = buf + parser->consumed;
+    size_t avail = len - parser->consumed;
+    size_t window = avail < parser->limits.max_line_len ? avail : parser->limits.max_line_len;
+    const char *lf = (const char *)memchr(start + parser->scanned, '\n', window - parser->scanned);
+    if (lf == NULL)
+    {
+        if (avail >= parser->limits.max_line_len)
+        {
+            return _creq_parse_fail(parser, PARSE_ERR_LINE_TOO_LONG);
+        }
+        parser->scanned = avail;
+        return CREQ_STATUS_INCOMPLETE;
+    }
+    size_t n = (size_t)(lf - start);
+    parser->consumed += n + 1;
+    parser->scanned = 0;
+    if (n > 0 && start[n - 1] == '\r')
+    {
+        n--;
+    }
+    *line = start;
+    *lineLen = n;
+    return CREQ_STATUS_SUCC;
+}
+
+/// @brief Parses "HTTP/" DIGIT "." DIGIT.
+CREQ_PRIVATE(bool)
+_creq_parse_http_version(const char *s, size_t len, creq_HttpVersion_t *version)
+{
+    if (len != 8 || memcmp(s, "HTTP/", 5) != 0 || !_creq_is_digit(s[5]) || s[6] != '.' || !_creq_is_digit(s[7]))
+    {
+        return false;
+    }
+    version->major = (unsigned)(s[5] - '0');
+    version->minor = (unsigned)(s[7] - '0');
+    return true;
+}
 
-    return pResponse;
+/// @brief Parses a Content-Length value into parser->body_len. Repeated fields must agree.
+CREQ_PRIVATE(creq_status_t)
+_creq_parse_content_length(creq_Parser_t *parser, const char *value, size_t len)
+{
+    uint64_t n = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!_creq_is_digit(value[i]) || n > (UINT64_MAX - 9) / 10)
+        {
+            return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+        }
+        n = n * 10 + (uint64_t)(value[i] - '0');
+    }
+    if (len == 0 || n > SIZE_MAX || (parser->has_body_len && parser->body_len != n))
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+    }
+    parser->body_len = n;
+    parser->has_body_len = true;
+    return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Response_free(creq_Response_t *resp)
+/// @brief Parses a non-empty header line and appends it to the store as borrowed slices.
+CREQ_PRIVATE(creq_status_t)
+_creq_parse_header_line(creq_Parser_t *parser, _creq_HeaderStore_t *store, const char *line, size_t lineLen)
 {
-    if (resp != NULL)
+    // obs-fold is rejected, as RFC 7230 Section 3.2.4 allows outside of message/http
+    const char *colon = (const char *)memchr(line, ':', lineLen);
+    if (colon == NULL || !_creq_is_token(line, (size_t)(colon - line)))
     {
-        // free pointer members
-        if (!resp->is_reason_phrase_literal)
-            CREQ_GUARDED_FREE(resp->reason_phrase);
-        if (!resp->is_message_body_literal)
-            CREQ_GUARDED_FREE(resp->message_body);
-        creq_HeaderField_t *pHeader = NULL;
-        size_t szNowSize = cvector_size(resp->header_vector);
-        while (szNowSize > 0)
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+    }
+    const char *value = colon + 1, *end = line + lineLen;
+    while (value < end && (*value == ' ' || *value == '\t'))
+    {
+        value++;
+    }
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t'))
+    {
+        end--;
+    }
+    if (!_creq_is_field_text(value, (size_t)(end - value)))
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+    }
+    if (parser->header_count >= parser->limits.max_header_count)
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_TOO_MANY_HEADERS);
+    }
+    if (_creq_header_store_add(store, CREQ_HDR_UNKNOWN, line, (size_t)(colon - line), value, (size_t)(end - value),
+                               true) != CREQ_STATUS_SUCC)
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_NO_MEMORY);
+    }
+    parser->header_count++;
+    switch ((*store->vec)[cvector_size(*store->vec) - 1].field_id)
+    {
+    case CREQ_HDR_CONTENT_LENGTH:
+        return _creq_parse_content_length(parser, value, (size_t)(end - value));
+    case CREQ_HDR_TRANSFER_ENCODING:
+    {
+        // only the last coding decides whether the body is chunked, RFC 7230 Section 3.3.3
+        const char *coding = end;
+        while (coding > value && coding[-1] != ',' && coding[-1] != ' ' && coding[-1] != '\t')
         {
-            pHeader = resp->header_vector[szNowSize - 1];
-            cvector_pop_back(resp->header_vector);
-            creq_HeaderField_free(&pHeader);
-            szNowSize = cvector_size(resp->header_vector);
+            coding--;
         }
-        cvector_free(resp->header_vector);
-        // finally
-        free(resp);
+        parser->has_transfer_coding = true;
+        parser->is_chunked = end - coding == 7 && _creq_header_name_eq(coding, "chunked", 7);
+        return CREQ_STATUS_SUCC;
+    }
+    default:
         return CREQ_STATUS_SUCC;
     }
-    return CREQ_STATUS_FAILED;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Response_set_http_version(creq_Response_t *resp, int major, int minor)
+/// @brief Moves a slice from the buffer of the previous call to the same offset in 'buf'.
+CREQ_PRIVATE(char *)
+_creq_parse_rebase(const creq_Parser_t *parser, const char *buf, const char *ptr)
 {
-    if (resp == NULL)
-        return CREQ_STATUS_FAILED;
-
-    resp->http_version.major = major;
-    resp->http_version.minor = minor;
-
-    return CREQ_STATUS_SUCC;
+    return (char *)buf + ((uintptr_t)ptr - (uintptr_t)parser->base);
 }
 
-CREQ_PUBLIC(creq_HttpVersion_t)
-creq_Response_get_http_version(creq_Response_t *resp)
+/// @brief Moves every slice stored so far to 'buf' if the caller's buffer has moved.
+CREQ_PRIVATE(void)
+_creq_parse_rebase_headers(creq_Parser_t *parser, creq_HeaderField_t *headerVector, const char *buf)
 {
-    creq_HttpVersion_t obj;
-    obj.major = -1;
-    obj.minor = -1;
-    if (resp == NULL)
+    for (size_t i = parser->first_header; i < parser->first_header + parser->header_count; i++)
     {
-        return obj;
+        headerVector[i].field_name = _creq_parse_rebase(parser, buf, headerVector[i].field_name);
+        headerVector[i].field_value = _creq_parse_rebase(parser, buf, headerVector[i].field_value);
     }
-    obj.major = resp->http_version.major;
-    obj.minor = resp->http_version.minor;
-    return obj;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Response_set_status_code(creq_Response_t *resp, int status)
+CREQ_PRIVATE(creq_HttpMethod_t)
+_creq_http_method_from_str(const char *s, size_t len)
 {
-    if (resp == NULL)
-        return CREQ_STATUS_FAILED;
-    resp->status_code = status;
-    return CREQ_STATUS_SUCC;
+    for (int meth = 0; meth < _METH_UNKNOWN; meth++)
+    {
+        const char *name = _creq_get_http_method_str((creq_HttpMethod_t)meth);
+        if (strlen(name) == len && memcmp(name, s, len) == 0)
+        {
+            return (creq_HttpMethod_t)meth;
+        }
+    }
+    return _METH_UNKNOWN;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Response_set_reason_phrase(creq_Response_t *resp, char *reason)
+CREQ_PRIVATE(creq_status_t)
+_creq_Request_parse_start_line(creq_Parser_t *parser, creq_Request_t *req, const char *line, size_t lineLen)
 {
-    if (resp == NULL)
+    const char *end = line + lineLen;
+    const char *method = line;
+    const char *target = (const char *)memchr(line, ' ', lineLen);
+    if (target == NULL || !_creq_is_token(method, (size_t)(target - method)))
     {
-        return CREQ_STATUS_FAILED;
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
     }
-    if (!resp->is_reason_phrase_literal)
-        CREQ_GUARDED_FREE(resp->reason_phrase);
-    if (reason == NULL)
+    target++;
+    const char *version = target;
+    while (version < end && (unsigned char)*version > 0x20 && *version != 0x7F)
     {
-        resp->reason_phrase = NULL;
-        return CREQ_STATUS_SUCC;
+        version++;
     }
-    char *pReasonCopy = _creq_malloc_strcpy(reason);
-    resp->reason_phrase = pReasonCopy;
-    resp->is_reason_phrase_literal = false;
+    creq_HttpVersion_t httpVersion;
+    if (version == target || version == end || *version != ' ' ||
+        !_creq_parse_http_version(version + 1, (size_t)(end - version - 1), &httpVersion))
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+    }
+    req->method = _creq_http_method_from_str(method, (size_t)(target - 1 - method));
+    req->http_version = httpVersion;
+    if (creq_Request_set_target_n(req, target, (size_t)(version - target), true) != CREQ_STATUS_SUCC)
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_NO_MEMORY);
+    }
+    parser->first_header = cvector_size(req->header_vector);
+    parser->state = _CREQ_PARSE_HEADERS;
     return CREQ_STATUS_SUCC;
 }
 
 CREQ_PUBLIC(creq_status_t)
-creq_Response_set_reason_phrase_literal(creq_Response_t *resp, const char *reason_s)
+creq_Request_parse(creq_Parser_t *parser, creq_Request_t *req, const char *buf, size_t len)
 {
-    if (resp == NULL)
+    if (parser == NULL)
     {
         return CREQ_STATUS_FAILED;
     }
-    if (!resp->is_reason_phrase_literal)
-        CREQ_GUARDED_FREE(resp->reason_phrase);
-    if (reason_s == NULL)
+    if (parser->error != PARSE_ERR_NONE)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    if (parser->state == _CREQ_PARSE_DONE)
     {
-        resp->reason_phrase = NULL;
         return CREQ_STATUS_SUCC;
     }
-    resp->reason_phrase = (char *)reason_s;
-    resp->is_reason_phrase_literal = true;
-    return CREQ_STATUS_SUCC;
-}
-
-CREQ_PUBLIC(int)
-creq_Response_get_status_code(creq_Response_t *resp)
-{
-    if (resp == NULL)
-        return 0;
-    return resp->status_code;
-}
+    if (req == NULL || (buf == NULL && len != 0) || len < parser->consumed)
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_ARGUMENT);
+    }
+    if (parser->base != NULL && parser->base != buf && parser->state != _CREQ_PARSE_START_LINE)
+    {
+        req->request_target = _creq_parse_rebase(parser, buf, req->request_target);
+        _creq_parse_rebase_headers(parser, req->header_vector, buf);
+    }
+    parser->base = buf;
+    req->is_verified = false;
+    _creq_serial_cache_invalidate(req->serial_cache);
 
-CREQ_PUBLIC(char *)
-creq_Response_get_reason_phrase(creq_Response_t *resp)
-{
-    if (resp == NULL)
-        return NULL;
-    return resp->reason_phrase;
-}
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(req);
+    while (parser->state != _CREQ_PARSE_BODY)
+    {
+        const char *line = NULL;
+        size_t lineLen = 0;
+        creq_status_t status = _creq_parse_next_line(parser, buf, len, &line, &lineLen);
+        if (status != CREQ_STATUS_SUCC)
+        {
+            return status;
+        }
+        if (parser->state == _CREQ_PARSE_START_LINE)
+        {
+            // empty lines before the request line are ignored, RFC 7230 Section 3.5
+            status = lineLen == 0 ? CREQ_STATUS_SUCC : _creq_Request_parse_start_line(parser, req, line, lineLen);
+        }
+        else if (lineLen == 0)
+        {
+            parser->head_len = parser->consumed;
+            parser->state = _CREQ_PARSE_BODY;
+            if (parser->has_transfer_coding)
+            {
+                return _creq_parse_fail(parser, PARSE_ERR_UNSUPPORTED);
+            }
+        }
+        else
+        {
+            status = _creq_parse_header_line(parser, &store, line, lineLen);
+        }
+        if (status != CREQ_STATUS_SUCC)
+        {
+            return status;
+        }
+    }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Response_add_header(creq_Response_t *resp, char *header, char *value)
-{
-    if (resp == NULL || header == NULL || value == NULL)
+    if (len - parser->consumed < parser->body_len)
     {
-        return CREQ_STATUS_FAILED;
+        return CREQ_STATUS_INCOMPLETE;
+    }
+    if (parser->body_len != 0 &&
+        creq_Request_set_message_body_bytes(req, buf + parser->consumed, (size_t)parser->body_len, OWN_BORROW) !=
+            CREQ_STATUS_SUCC)
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_NO_MEMORY);
     }
-    creq_HeaderField_t *pNewHeader = creq_HeaderField_create(header, value);
-    cvector_push_back(resp->header_vector, pNewHeader);
+    parser->consumed += (size_t)parser->body_len;
+    parser->state = _CREQ_PARSE_DONE;
     return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Response_add_header_literal(creq_Response_t *resp, const char *header_s, const char *value_s)
+CREQ_PRIVATE(creq_status_t)
+_creq_Response_parse_start_line(creq_Parser_t *parser, creq_Response_t *resp, const char *line, size_t lineLen)
 {
-    if (resp == NULL || header_s == NULL || value_s == NULL)
+    creq_HttpVersion_t httpVersion;
+    // a missing reason phrase is tolerated even without the space before it
+    if (lineLen < 12 || line[8] != ' ' || !_creq_parse_http_version(line, 8, &httpVersion) ||
+        !_creq_is_digit(line[9]) || !_creq_is_digit(line[10]) || !_creq_is_digit(line[11]) ||
+        (lineLen > 12 && line[12] != ' '))
     {
-        return CREQ_STATUS_FAILED;
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+    }
+    const char *reason = lineLen > 12 ? line + 13 : line + 12;
+    size_t reasonLen = (size_t)(line + lineLen - reason);
+    if (!_creq_is_field_text(reason, reasonLen))
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+    }
+    resp->http_version = httpVersion;
+    resp->status_code = (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0');
+    if (creq_Response_set_reason_phrase_literal_n(resp, reason, reasonLen) != CREQ_STATUS_SUCC)
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_NO_MEMORY);
     }
-    creq_HeaderField_t *pNewHeader = creq_HeaderField_create_literal(header_s, value_s);
-    cvector_push_back(resp->header_vector, pNewHeader);
+    parser->first_header = cvector_size(resp->header_vector);
+    parser->state = _CREQ_PARSE_HEADERS;
     return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(creq_HeaderField_t *)
-creq_Response_search_for_header(creq_Response_t *resp, char *header)
+/// @brief Picks how the body of a response is delimited, RFC 7230 Section 3.3.3.
+CREQ_PRIVATE(int)
+_creq_Response_body_state(const creq_Parser_t *parser, int statusCode)
 {
-    if (resp == NULL || resp->header_vector == NULL || header == NULL)
+    if ((statusCode >= 100 && statusCode < 200) || statusCode == 204 || statusCode == 304 ||
+        parser->request_method == METH_HEAD || (parser->request_method == METH_CONNECT && statusCode / 100 == 2))
     {
-        return NULL;
+        return _CREQ_PARSE_DONE;
+    }
+    if (parser->has_transfer_coding)
+    {
+        return parser->is_chunked ? _CREQ_PARSE_CHUNK_SIZE : _CREQ_PARSE_BODY_CLOSE;
+    }
+    if (parser->has_body_len)
+    {
+        return parser->body_len == 0 ? _CREQ_PARSE_DONE : _CREQ_PARSE_BODY_LENGTH;
     }
+    return _CREQ_PARSE_BODY_CLOSE;
+}
 
-    for (int i = 0; i < cvector_size(resp->header_vector); ++i)
+/// @brief Parses the chunk-size of a chunk line. Extensions are skipped.
+CREQ_PRIVATE(creq_status_t)
+_creq_parse_chunk_size(creq_Parser_t *parser, const char *line, size_t lineLen)
+{
+    uint64_t n = 0;
+    size_t i = 0;
+    for (; i < lineLen; i++)
     {
-        if (!strcmp(resp->header_vector[i]->field_name, header))
+        char c = line[i], lower = (char)(c | 0x20);
+        unsigned digit;
+        if (_creq_is_digit(c))
+            digit = (unsigned)(c - '0');
+        else if (lower >= 'a' && lower <= 'f')
+            digit = (unsigned)(lower - 'a' + 10);
+        else
+            break;
+        if (n > UINT64_MAX >> 4)
         {
-            return resp->header_vector[i];
+            return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
         }
+        n = n << 4 | digit;
     }
-    return NULL;
+    if (i == 0 || (i < lineLen && line[i] != ';' && line[i] != ' ' && line[i] != '\t'))
+    {
+        return _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+    }
+    parser->body_len = n;
+    parser->state = n == 0 ? _CREQ_PARSE_TRAILERS : _CREQ_PARSE_CHUNK_DATA;
+    return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(int)
-creq_Response_search_for_header_index(creq_Response_t *resp, char *header)
+CREQ_PRIVATE(creq_status_t)
+_creq_parse_deliver(creq_Parser_t *parser, const char *data, size_t len)
 {
-    if (resp == NULL || resp->header_vector == NULL || header == NULL)
+    if (len != 0 && parser->on_body != NULL && parser->on_body(parser->user_data, data, len) != CREQ_STATUS_SUCC)
     {
-        return -1;
+        return _creq_parse_fail(parser, PARSE_ERR_ABORTED);
     }
-    for (int i = 0; i < cvector_size(resp->header_vector); ++i)
+    parser->consumed += len;
+    return CREQ_STATUS_SUCC;
+}
+
+/// @brief Streams a response body to the callback until it or the input ends.
+CREQ_PRIVATE(creq_status_t)
+_creq_parse_body(creq_Parser_t *parser, const char *buf, size_t len)
+{
+    const char *line = NULL;
+    size_t lineLen = 0;
+    creq_status_t status = CREQ_STATUS_SUCC;
+    while (status == CREQ_STATUS_SUCC)
     {
-        if (!strcmp(resp->header_vector[i]->field_name, header))
+        size_t avail = len - parser->consumed;
+        switch (parser->state)
+        {
+        case _CREQ_PARSE_BODY_LENGTH:
+        case _CREQ_PARSE_CHUNK_DATA:
         {
-            return i;
+            size_t n = avail < parser->body_len ? avail : (size_t)parser->body_len;
+            status = _creq_parse_deliver(parser, buf + parser->consumed, n);
+            parser->body_len -= n;
+            if (status != CREQ_STATUS_SUCC || parser->body_len != 0)
+            {
+                return status == CREQ_STATUS_SUCC ? CREQ_STATUS_INCOMPLETE : status;
+            }
+            parser->state = parser->state == _CREQ_PARSE_BODY_LENGTH ? _CREQ_PARSE_DONE : _CREQ_PARSE_CHUNK_DATA_END;
+            break;
+        }
+        case _CREQ_PARSE_BODY_CLOSE:
+            status = _creq_parse_deliver(parser, buf + parser->consumed, avail);
+            return status == CREQ_STATUS_SUCC ? CREQ_STATUS_INCOMPLETE : status;
+        case _CREQ_PARSE_CHUNK_SIZE:
+            status = _creq_parse_next_line(parser, buf, len, &line, &lineLen);
+            if (status == CREQ_STATUS_SUCC)
+                status = _creq_parse_chunk_size(parser, line, lineLen);
+            break;
+        case _CREQ_PARSE_CHUNK_DATA_END:
+            status = _creq_parse_next_line(parser, buf, len, &line, &lineLen);
+            if (status == CREQ_STATUS_SUCC)
+            {
+                parser->state = _CREQ_PARSE_CHUNK_SIZE;
+                if (lineLen != 0)
+                    status = _creq_parse_fail(parser, PARSE_ERR_SYNTAX);
+            }
+            break;
+        case _CREQ_PARSE_TRAILERS:
+            status = _creq_parse_next_line(parser, buf, len, &line, &lineLen);
+            if (status == CREQ_STATUS_SUCC && lineLen == 0)
+                parser->state = _CREQ_PARSE_DONE;
+            break;
+        default:
+            return CREQ_STATUS_SUCC;
         }
     }
-    return -1;
+    return status;
 }
 
 CREQ_PUBLIC(creq_status_t)
-creq_Response_remove_header(creq_Response_t *resp, char *header)
+creq_Response_parse(creq_Parser_t *parser, creq_Response_t *resp, const char *buf, size_t len)
 {
-    if (resp == NULL || header == NULL)
+    if (parser == NULL)
     {
         return CREQ_STATUS_FAILED;
     }
-    int idx = creq_Response_search_for_header_index(resp, header);
-    if (idx >= 0)
+    if (parser->error != PARSE_ERR_NONE)
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    if (parser->state == _CREQ_PARSE_DONE)
     {
-        creq_HeaderField_t *pNode = resp->header_vector[idx];
-        creq_HeaderField_free(&pNode);
-        cvector_erase(resp->header_vector, idx);
         return CREQ_STATUS_SUCC;
     }
-    return CREQ_STATUS_FAILED;
-}
-
-CREQ_PUBLIC(creq_status_t)
-creq_Response_remove_header_direct(creq_Response_t *resp, creq_HeaderField_t *header)
-{
-    if (resp == NULL || header == NULL)
+    if (resp == NULL || (buf == NULL && len != 0) || len < parser->consumed)
     {
-        return CREQ_STATUS_FAILED;
+        return _creq_parse_fail(parser, PARSE_ERR_ARGUMENT);
     }
-    for (int i = 0; i < cvector_size(resp->header_vector); ++i)
+    if (parser->base != NULL && parser->base != buf && parser->state != _CREQ_PARSE_START_LINE)
     {
-        if (resp->header_vector[i] == header)
+        resp->reason_phrase = _creq_parse_rebase(parser, buf, resp->reason_phrase);
+        _creq_parse_rebase_headers(parser, resp->header_vector, buf);
+    }
+    parser->base = buf;
+    resp->is_verified = false;
+    _creq_serial_cache_invalidate(resp->serial_cache);
+
+    _creq_HeaderStore_t store = _CREQ_HEADER_STORE(resp);
+    while (parser->state == _CREQ_PARSE_START_LINE || parser->state == _CREQ_PARSE_HEADERS)
+    {
+        const char *line = NULL;
+        size_t lineLen = 0;
+        creq_status_t status = _creq_parse_next_line(parser, buf, len, &line, &lineLen);
+        if (status != CREQ_STATUS_SUCC)
         {
-            creq_HeaderField_t *pNode = resp->header_vector[i];
-            creq_HeaderField_free(&pNode);
-            cvector_erase(resp->header_vector, i);
-            return CREQ_STATUS_SUCC;
+            return status;
+        }
+        if (parser->state == _CREQ_PARSE_START_LINE)
+        {
+            status = _creq_Response_parse_start_line(parser, resp, line, lineLen);
+        }
+        else if (lineLen == 0)
+        {
+            parser->head_len = parser->consumed;
+            parser->state = _creq_Response_body_state(parser, resp->status_code);
+        }
+        else
+        {
+            status = _creq_parse_header_line(parser, &store, line, lineLen);
+        }
+        if (status != CREQ_STATUS_SUCC)
+        {
+            return status;
         }
     }
-
-    return CREQ_STATUS_FAILED;
+    return _creq_parse_body(parser, buf, len);
 }
 
 CREQ_PUBLIC(creq_status_t)
-creq_Response_set_message_body(creq_Response_t *resp, char *msg)
+creq_Parser_eof(creq_Parser_t *parser)
 {
-    if (resp == NULL)
+    if (parser == NULL || parser->error != PARSE_ERR_NONE)
     {
         return CREQ_STATUS_FAILED;
     }
-    if (!resp->is_message_body_literal)
-        CREQ_GUARDED_FREE(resp->message_body);
-    if (msg == NULL)
+    if (parser->state == _CREQ_PARSE_BODY_CLOSE || parser->state == _CREQ_PARSE_DONE)
     {
-        resp->message_body = NULL;
+        parser->state = _CREQ_PARSE_DONE;
         return CREQ_STATUS_SUCC;
     }
-    char *pMsgCopy = _creq_malloc_strcpy(msg);
-    resp->message_body = pMsgCopy;
-    resp->is_message_body_literal = false;
-    return CREQ_STATUS_SUCC;
+    return _creq_parse_fail(parser, PARSE_ERR_TRUNCATED);
 }
 
-CREQ_PUBLIC(creq_status_t)
-creq_Response_set_message_body_content_len(creq_Response_t *resp, char *msg)
+CREQ_PUBLIC(size_t)
+creq_Parser_compact(creq_Parser_t *parser, char *buf, size_t len)
 {
-    if (creq_Response_set_message_body(resp, msg) == CREQ_STATUS_FAILED)
+    if (parser == NULL || buf == NULL || parser->state < _CREQ_PARSE_BODY || parser->state == _CREQ_PARSE_DONE ||
+        len < parser->consumed)
     {
-        return CREQ_STATUS_FAILED;
+        return len;
     }
-    creq_Response_remove_header(resp, "Content-Length");
-    size_t content_len = strlen(resp->message_body);
-    char *content_len_s = NULL;
-    int content_len_s_len = snprintf(NULL, 0, "%zu", content_len);
-    content_len_s = (char *)_creq_malloc_n_init(sizeof(char) * (content_len_s_len + 1));
-    snprintf(content_len_s, content_len_s_len + 1, "%zu", content_len);
-    creq_Response_add_header(resp, "Content-Length", content_len_s);
-    CREQ_GUARDED_FREE(content_len_s);
-    return CREQ_STATUS_SUCC;
+    memmove(buf + parser->head_len, buf + parser->consumed, len - parser->consumed);
+    len -= parser->consumed - parser->head_len;
+    parser->consumed = parser->head_len;
+    return len;
 }
 
+#ifdef CREQ_POSIX_IO
 CREQ_PUBLIC(creq_status_t)
-creq_Response_set_message_body_literal(creq_Response_t *resp, const char *msg_s)
+creq_Response_send(creq_Response_t *resp, int fd)
 {
-    if (resp == NULL)
+    if (resp == NULL || fd < 0 || !_creq_Response_may_emit(resp))
     {
         return CREQ_STATUS_FAILED;
     }
-    if (!resp->is_message_body_literal)
-        CREQ_GUARDED_FREE(resp->message_body);
-    if (msg_s == NULL)
+    _creq_MessageView_t view;
+    _creq_view_from_response(&view, resp);
+    creq_IoVecScratch_t scratch;
+    size_t count = 0;
+    _creq_view_to_iovec(&view, NULL, 0, NULL, &count);
+    creq_IoVec_t stackIov[64];
+    creq_IoVec_t *iov = count <= sizeof(stackIov) / sizeof(stackIov[0])
+                            ? stackIov
+                            : (creq_IoVec_t *)creq_malloc(sizeof(creq_IoVec_t) * count);
+    if (iov == NULL)
     {
-        resp->message_body = NULL;
-        return CREQ_STATUS_SUCC;
+        return CREQ_STATUS_FAILED;
     }
-    resp->message_body = (char *)msg_s;
-    resp->is_message_body_literal = true;
-    return CREQ_STATUS_SUCC;
+    _creq_view_to_iovec(&view, iov, count, &scratch, NULL);
+    creq_status_t status = _creq_fd_writev_all(fd, iov, count);
+    if (iov != stackIov)
+    {
+        creq_free(iov);
+    }
+    if (status == CREQ_STATUS_SUCC && resp->body_file.fd >= 0)
+    {
+        status = _creq_fd_send_file(fd, resp->body_file.fd, resp->body_file.offset, resp->body_file.len);
+    }
+    return status;
 }
 
+/*
+ * Resumable writer. Every call captures the message into a view again, which allocates nothing, and hands the pieces
+ * from the recorded position onwards to writev(). The position is advanced by what the descriptor took.
+ */
+#define _CREQ_WRITER_IOV_LEN (CREQ_IOV_MAX < 64 ? CREQ_IOV_MAX : 64)
+
 CREQ_PUBLIC(creq_status_t)
-creq_Response_set_message_body_literal_content_len(creq_Response_t *resp, const char *msg_s)
+creq_Writer_init_request(creq_Writer_t *writer, creq_Request_t *req)
 {
-    if (creq_Response_set_message_body_literal(resp, msg_s) == CREQ_STATUS_FAILED)
+    if (writer == NULL || req == NULL || !_creq_Request_may_emit(req))
     {
         return CREQ_STATUS_FAILED;
     }
-    creq_Response_remove_header(resp, "Content-Length");
-    size_t content_len = strlen(resp->message_body);
-    char *content_len_s = NULL;
-    int content_len_s_len = snprintf(NULL, 0, "%zu", content_len);
-    content_len_s = (char *)_creq_malloc_n_init(sizeof(char) * (content_len_s_len + 1));
-    snprintf(content_len_s, content_len_s_len + 1, "%zu", content_len);
-    creq_Response_add_header(resp, "Content-Length", content_len_s);
-    CREQ_GUARDED_FREE(content_len_s);
+    memset(writer, 0, sizeof(creq_Writer_t));
+    writer->request = req;
     return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(char *)
-creq_Response_get_message_body(creq_Response_t *resp)
+CREQ_PUBLIC(creq_status_t)
+creq_Writer_init_response(creq_Writer_t *writer, creq_Response_t *resp)
 {
-    if (resp == NULL)
-        return NULL;
-    return resp->message_body;
+    if (writer == NULL || resp == NULL || !_creq_Response_may_emit(resp))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    memset(writer, 0, sizeof(creq_Writer_t));
+    writer->response = resp;
+    return CREQ_STATUS_SUCC;
 }
 
-CREQ_PUBLIC(char *)
-creq_Response_stringify(creq_Response_t *resp)
+/// @brief Moves a writer 'len' bytes further into the pieces of 'view'.
+CREQ_PRIVATE(void)
+_creq_Writer_advance(creq_Writer_t *writer, const _creq_MessageView_t *view, size_t pieceCount, size_t len)
 {
-    if (resp == NULL)
-        return NULL;
-    char *status_line_s = NULL, *headers_s = NULL, *body_s = NULL;
-
-    const char *line_ending_s = _creq_get_line_ending_str(&resp->config, CONF_RESPONSE);
-    char *http_version_s = _creq_get_http_version_str(resp->http_version.major, resp->http_version.minor);
-
-    int status_line_len =
-        snprintf(NULL, 0, _creq_FMT_STATUS_LINE, http_version_s, resp->status_code, resp->reason_phrase, line_ending_s);
-    status_line_s = (char *)_creq_malloc_n_init(sizeof(char) * (status_line_len + 1));
-    snprintf(status_line_s, status_line_len + 1, _creq_FMT_STATUS_LINE, http_version_s, resp->status_code,
-             resp->reason_phrase, line_ending_s);
-    CREQ_GUARDED_FREE(http_version_s);
-
-    size_t header_list_len = cvector_size(resp->header_vector);
-    if (header_list_len != 0)
+    writer->written += len;
+    while (len > 0 && writer->piece < pieceCount)
     {
-        size_t idx = 0;
-        int str_len = 0;
-        cvector_VECTOR(creq_HeaderField_t *) hv = resp->header_vector;
+        size_t pieceLen = 0;
+        _creq_view_piece(view, writer->piece, &pieceLen);
+        size_t rest = pieceLen - writer->piece_offset;
+        if (len < rest)
+        {
+            writer->piece_offset += len;
+            return;
+        }
+        len -= rest;
+        writer->piece++;
+        writer->piece_offset = 0;
+    }
+}
 
-        for (idx = 0; idx < header_list_len; idx++)
+CREQ_PUBLIC(creq_status_t)
+creq_Writer_write(creq_Writer_t *writer, int fd)
+{
+    if (writer == NULL || fd < 0 || (writer->request == NULL) == (writer->response == NULL))
+    {
+        return CREQ_STATUS_FAILED;
+    }
+    if (writer->is_finished)
+    {
+        return CREQ_STATUS_SUCC;
+    }
+    _creq_MessageView_t view;
+    if (writer->request != NULL)
+    {
+        _creq_view_from_request(&view, writer->request);
+    }
+    else
+    {
+        _creq_view_from_response(&view, writer->response);
+    }
+    size_t pieceCount = _creq_view_piece_count(&view);
+    while (writer->piece < pieceCount)
+    {
+        creq_IoVec_t iov[_CREQ_WRITER_IOV_LEN];
+        size_t count = 0, len = 0;
+        for (size_t i = writer->piece; i < pieceCount && count < _CREQ_WRITER_IOV_LEN; i++)
         {
-            str_len += snprintf(NULL, 0, _creq_FMT_HEADER, hv[idx]->field_name, hv[idx]->field_value, line_ending_s);
+            const char *ptr = _creq_view_piece(&view, i, &len);
+            size_t skip = i == writer->piece ? writer->piece_offset : 0;
+            if (len > skip)
+            {
+                iov[count].iov_base = (void *)(ptr + skip);
+                iov[count].iov_len = len - skip;
+                count++;
+            }
         }
-        headers_s = (char *)_creq_malloc_n_init(sizeof(char) * (str_len + 1));
-        for (idx = 0; idx < header_list_len; idx++)
+        if (count == 0)
         {
-            char *str;
-            int len = snprintf(NULL, 0, _creq_FMT_HEADER, hv[idx]->field_name, hv[idx]->field_value, line_ending_s);
-            str = (char *)_creq_malloc_n_init(sizeof(char) * (len + 1));
-            snprintf(str, len + 1, _creq_FMT_HEADER, hv[idx]->field_name, hv[idx]->field_value, line_ending_s);
-            strcat(headers_s, str);
-            CREQ_GUARDED_FREE(str);
+            // only empty pieces are left
+            writer->piece = pieceCount;
+            writer->piece_offset = 0;
+            break;
         }
+        ssize_t written = _creq_fd_writev(fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? CREQ_STATUS_INCOMPLETE : CREQ_STATUS_FAILED;
+        }
+        _creq_Writer_advance(writer, &view, pieceCount, (size_t)written);
     }
 
-    body_s = resp->message_body;
-
-    char *full_resp_s = NULL;
-    int full_resp_len =
-        snprintf(NULL, 0, _creq_FMT_FULL_RESPONSE, status_line_s, headers_s == NULL ? line_ending_s : headers_s,
-                 line_ending_s, body_s == NULL ? "" : body_s);
-    full_resp_s = (char *)_creq_malloc_n_init(sizeof(char) * (full_resp_len + 1));
-    snprintf(full_resp_s, full_resp_len + 1, _creq_FMT_FULL_RESPONSE, status_line_s,
-             headers_s == NULL ? line_ending_s : headers_s, line_ending_s, body_s == NULL ? "" : body_s);
-
-    CREQ_GUARDED_FREE(status_line_s);
-    CREQ_GUARDED_FREE(headers_s);
-
-    return full_resp_s;
+    creq_Response_t *resp = writer->response;
+    while (resp != NULL && resp->body_file.fd >= 0 && writer->file_offset < resp->body_file.len)
+    {
+        ssize_t sent = _creq_fd_send_file_some(fd, resp->body_file.fd, resp->body_file.offset + writer->file_offset,
+                                               resp->body_file.len - writer->file_offset);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? CREQ_STATUS_INCOMPLETE : CREQ_STATUS_FAILED;
+        }
+        if (sent == 0)
+        {
+            return CREQ_STATUS_FAILED; // The file is shorter than the range.
+        }
+        writer->file_offset += (size_t)sent;
+        writer->written += (uint64_t)sent;
+    }
+    writer->is_finished = true;
+    return CREQ_STATUS_SUCC;
 }
+#endif // CREQ_POSIX_IO
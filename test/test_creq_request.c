@@ -1,5 +1,8 @@
 #include "creq.h"
 #include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 void test_creq_Request_BasicOperations()
 {
@@ -103,6 +106,340 @@ void test_creq_Request_ContentLenReplacement()
     creq_Request_free(req);
 }
 
+void test_creq_Request_StringifyInto()
+{
+    creq_Request_t *req = NULL;
+    creq_Config_t req_conf = {0};
+    req_conf.config_type = CONF_REQUEST;
+    req_conf.data.request_config.line_ending = LE_CRLF;
+
+    req = creq_Request_create(&req_conf);
+    creq_Request_set_http_method(req, METH_POST);
+    creq_Request_set_http_version(req, 1, 1);
+    creq_Request_set_target(req, "/login", true);
+    creq_Request_add_header(req, "Host", "www.my-site.com", true);
+    creq_Request_add_header(req, "Connection", "close", false);
+    creq_Request_set_message_body_content_len(req, "user=CSharperMantle&mood=happy", true);
+
+    char *expected = creq_Request_stringify(req);
+    size_t expected_len = strlen(expected);
+    size_t needed = 0;
+    char small[16];
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_stringify_into(req, small, sizeof(small), &needed));
+    TEST_ASSERT_EQUAL_UINT(expected_len, needed);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_stringify_into(req, NULL, 0, &needed));
+    TEST_ASSERT_EQUAL_UINT(expected_len, needed);
+
+    char buf[256];
+    memset(buf, 'x', sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT(expected_len, creq_Request_stringify_into(req, buf, needed, NULL));
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, expected_len);
+    TEST_ASSERT_EQUAL_INT('x', buf[expected_len]);
+
+    free(expected);
+    creq_Request_free(req);
+}
+
+void test_creq_Request_ToIoVec()
+{
+    creq_Request_t *req = NULL;
+    creq_Config_t req_conf = {0};
+    req_conf.config_type = CONF_REQUEST;
+    req_conf.data.request_config.line_ending = LE_LF;
+
+    req = creq_Request_create(&req_conf);
+    creq_Request_set_http_method(req, METH_GET);
+    creq_Request_set_http_version(req, 1, 1);
+    creq_Request_set_target(req, "/index.html", true);
+
+    creq_IoVec_t iov[8];
+    creq_IoVecScratch_t scratch;
+    size_t needed = 0;
+    size_t count = creq_Request_to_iovec(req, iov, 8, &scratch, &needed);
+    TEST_ASSERT_EQUAL_UINT(8, count);
+    TEST_ASSERT_EQUAL_PTR(scratch.data, iov[4].iov_base);
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.1", iov[4].iov_base, iov[4].iov_len);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_to_iovec(req, iov, 8, NULL, &needed));
+
+    creq_Request_free(req);
+}
+
+void test_creq_Request_ArenaMode()
+{
+    creq_Request_t *req = NULL, *heap_req = NULL;
+    creq_Config_t req_conf = {0};
+    req_conf.config_type = CONF_REQUEST;
+    req_conf.data.request_config.line_ending = LE_CRLF;
+    heap_req = creq_Request_create(&req_conf);
+    req = creq_Request_create_with_options(&req_conf, CONF_OPT_ARENA);
+    TEST_ASSERT_NOT_NULL(req->arena);
+    TEST_ASSERT_NULL(heap_req->arena);
+
+    creq_Request_t *reqs[2] = {req, heap_req};
+    for (int r = 0; r < 2; r++)
+    {
+        char name[32], value[64];
+        creq_Request_set_http_method(reqs[r], METH_PUT);
+        creq_Request_set_http_version(reqs[r], 1, 1);
+        creq_Request_set_target(reqs[r], "/replaced", false);
+        creq_Request_set_target(reqs[r], "/upload", false);
+        for (int i = 0; i < 100; i++)
+        {
+            sprintf(name, "X-Header-%d", i);
+            sprintf(value, "%d-some-longer-header-value-to-fill-the-arena", i);
+            creq_Request_add_header(reqs[r], name, value, false);
+        }
+        creq_Request_remove_header(reqs[r], "X-Header-42");
+        creq_Request_set_message_body_content_len(reqs[r], "payload", false);
+    }
+    TEST_ASSERT_EQUAL_INT(-1, creq_Request_search_for_header_index(req, "X-Header-42"));
+    TEST_ASSERT_EQUAL_STRING("7", creq_Request_search_for_header(req, "Content-Length")->field_value);
+
+    char *expected = creq_Request_stringify(heap_req);
+    char *actual = creq_Request_stringify(req);
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+    free(expected);
+    free(actual);
+
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_free(req));
+    creq_Request_free(heap_req);
+}
+
+static size_t alloc_count = 0, free_count = 0;
+
+static void *counting_malloc(size_t size, void *user_data)
+{
+    ++*(size_t *)user_data;
+    alloc_count++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *user_data)
+{
+    ++*(size_t *)user_data;
+    if (ptr == NULL)
+        alloc_count++;
+    return realloc(ptr, size);
+}
+
+static void counting_free(void *ptr, void *user_data)
+{
+    (void)user_data;
+    free_count++;
+    free(ptr);
+}
+
+void test_creq_Request_AllocatorHooks()
+{
+    size_t calls = 0;
+    creq_Allocator_t allocator = {counting_malloc, counting_realloc, counting_free, &calls};
+    creq_Allocator_t bad = {counting_malloc, NULL, counting_free, &calls};
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_set_allocator(&bad));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_set_allocator(&allocator));
+    alloc_count = free_count = 0;
+
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_Request_set_http_method(req, METH_GET);
+    creq_Request_set_target(req, "/", false);
+    for (int i = 0; i < 20; i++)
+    {
+        creq_Request_add_header(req, "X-Copied", "value", false);
+    }
+    char *str = creq_Request_stringify(req);
+    creq_free(str);
+    creq_Request_free(req);
+
+    TEST_ASSERT_GREATER_THAN(40, calls);
+    TEST_ASSERT_EQUAL_UINT(alloc_count, free_count);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_set_allocator(NULL));
+}
+
+void test_creq_Request_HeaderFieldPool()
+{
+    creq_HeaderField_pool_set_limit(4);
+    creq_HeaderField_t *first = creq_HeaderField_create("Host", "example.com");
+    creq_HeaderField_t *recycled = first;
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_HeaderField_free(&first));
+    TEST_ASSERT_NULL(first);
+
+    creq_HeaderField_t *second = creq_HeaderField_create_literal("Accept", "*/*");
+    TEST_ASSERT_EQUAL_PTR(recycled, second);
+    TEST_ASSERT_EQUAL_STRING("Accept", second->field_name);
+    TEST_ASSERT_TRUE(second->is_field_name_literal);
+    creq_HeaderField_free(&second);
+
+    creq_HeaderField_pool_drain();
+    creq_HeaderField_pool_set_limit(0);
+}
+
+void test_creq_Request_InlineHeaderStorage()
+{
+    size_t calls = 0;
+    creq_Allocator_t allocator = {counting_malloc, counting_realloc, counting_free, &calls};
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_set_allocator(&allocator);
+
+    for (int i = 0; i < CREQ_INLINE_HEADER_CAPACITY; i++)
+    {
+        creq_Request_add_header(req, "X-Literal", "value", true);
+    }
+    TEST_ASSERT_EQUAL_UINT(0, calls);
+    TEST_ASSERT_EQUAL_PTR(req->header_inline.fields, req->header_vector);
+
+    creq_Request_add_header(req, "Host", "www.example.com", true);
+    TEST_ASSERT_EQUAL_UINT(1, calls);
+    TEST_ASSERT_EQUAL_UINT(CREQ_INLINE_HEADER_CAPACITY + 1, cvector_size(req->header_vector));
+    TEST_ASSERT_EQUAL_STRING("www.example.com", req->header_vector[CREQ_INLINE_HEADER_CAPACITY].field_value);
+
+    creq_HeaderField_t *host = creq_Request_search_for_header(req, "Host");
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_remove_header_direct(req, host));
+    TEST_ASSERT_NULL(creq_Request_search_for_header(req, "Host"));
+    creq_HeaderField_t outsider = {0};
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_remove_header_direct(req, &outsider));
+
+    creq_Request_free(req);
+    creq_set_allocator(NULL);
+}
+
+void test_creq_Request_WellKnownHeaderIds()
+{
+    static const char expected[] = "GET / HTTP/1.1\r\n"
+                                   "Host: www.example.com\r\n"
+                                   "user-agent: creq/0.1.4\r\n"
+                                   "\r\n";
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_Request_set_http_method(req, METH_GET);
+    creq_Request_set_target(req, "/", true);
+    creq_Request_set_http_version(req, 1, 1);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_add_header_id(req, CREQ_HDR_HOST, "www.example.com", true));
+    creq_Request_add_header(req, "user-agent", "creq/0.1.4", false);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_add_header_id(req, CREQ_HDR_UNKNOWN, "x", true));
+
+    TEST_ASSERT_EQUAL_INT(CREQ_HDR_USER_AGENT, creq_get_header_id("USER-AGENT"));
+    TEST_ASSERT_EQUAL_INT(CREQ_HDR_UNKNOWN, creq_get_header_id("X-Custom"));
+    TEST_ASSERT_EQUAL_INT(CREQ_HDR_UNKNOWN, creq_get_header_id(""));
+    TEST_ASSERT_EQUAL_INT(CREQ_HDR_UNKNOWN, creq_get_header_id("Content-Lengthy"));
+    TEST_ASSERT_EQUAL_INT(CREQ_HDR_UNKNOWN, creq_get_header_id("Access-Control-Allow-Originsss"));
+    for (int id = CREQ_HDR_UNKNOWN + 1; id < _CREQ_HDR_COUNT; id++)
+    {
+        TEST_ASSERT_EQUAL_INT(id, creq_get_header_id(creq_get_header_name((creq_HeaderId_t)id)));
+    }
+    TEST_ASSERT_EQUAL_STRING("Host", creq_get_header_name(CREQ_HDR_HOST));
+    TEST_ASSERT_EQUAL_PTR(creq_get_header_name(CREQ_HDR_HOST), req->header_vector[0].field_name);
+    TEST_ASSERT_EQUAL_PTR(&req->header_vector[1], creq_Request_search_for_header_id(req, CREQ_HDR_USER_AGENT));
+    TEST_ASSERT_EQUAL_PTR(&req->header_vector[0], creq_Request_search_for_header(req, "host"));
+    TEST_ASSERT_NULL(creq_Request_search_for_header_id(req, CREQ_HDR_ACCEPT));
+
+    char *str = creq_Request_stringify(req);
+    TEST_ASSERT_EQUAL_STRING(expected, str);
+    creq_free(str);
+    creq_Request_free(req);
+}
+
+void test_creq_Request_BinaryBody()
+{
+    static const unsigned char payload[] = {0x08, 0x96, 0x01, 0x00, 0x12, 0x00};
+    creq_Config_t req_conf = {0};
+    req_conf.config_type = CONF_REQUEST;
+    req_conf.data.request_config.line_ending = LE_LF;
+    creq_Request_t *req = creq_Request_create_with_options(&req_conf, CONF_OPT_ARENA);
+    creq_Request_set_http_method(req, METH_POST);
+    creq_Request_set_target(req, "/rpc", true);
+    creq_Request_set_http_version(req, 1, 1);
+
+    unsigned char *owned = creq_malloc(sizeof(payload));
+    memcpy(owned, payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC,
+                          creq_Request_set_message_body_bytes(req, owned, sizeof(payload), OWN_TRANSFER));
+    creq_Request_update_content_len(req);
+    TEST_ASSERT_EQUAL_STRING("6", creq_Request_search_for_header_id(req, CREQ_HDR_CONTENT_LENGTH)->field_value);
+
+    char buf[128];
+    size_t needed = 0;
+    size_t len = creq_Request_stringify_into(req, buf, sizeof(buf), &needed);
+    TEST_ASSERT_EQUAL_UINT(needed, len);
+    TEST_ASSERT_EQUAL_MEMORY(payload, buf + len - sizeof(payload), sizeof(payload));
+
+    creq_Request_set_message_body_bytes(req, payload, sizeof(payload), OWN_BORROW);
+    TEST_ASSERT_EQUAL_PTR(payload, creq_Request_get_message_body(req));
+    TEST_ASSERT_EQUAL_UINT(len, creq_Request_stringify_into(req, buf, sizeof(buf), &needed));
+
+    creq_Request_free(req);
+}
+
+void test_creq_Request_LengthSetters()
+{
+    static const char line[] = "/index.html?q=1 Host:www.example.com";
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_Request_set_http_method(req, METH_GET);
+    creq_Request_set_http_version(req, 1, 1);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_set_target_n(req, line, 11, true));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_add_header_n(req, line + 16, 4, line + 21, 15, true));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_set_header_n(req, "HOST", 4, line + 25, 11, false));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_set_target_n(req, NULL, 3, false));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_set_target_n(req, line, 11, true));
+
+    TEST_ASSERT_EQUAL_UINT(11, creq_Request_get_target_len(req));
+    TEST_ASSERT_EQUAL_UINT(1, cvector_size(req->header_vector));
+    TEST_ASSERT_EQUAL_PTR(line + 16, req->header_vector[0].field_name);
+    TEST_ASSERT_EQUAL_STRING("example.com", req->header_vector[0].field_value);
+    TEST_ASSERT_EQUAL_PTR(&req->header_vector[0], creq_Request_search_for_header(req, "host"));
+
+    char *str = creq_Request_stringify(req);
+    TEST_ASSERT_EQUAL_STRING("GET /index.html HTTP/1.1\r\nHost: example.com\r\n\r\n", str);
+    creq_free(str);
+    creq_Request_free(req);
+}
+
+void test_creq_Request_Template()
+{
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_Request_set_http_method(req, METH_POST);
+    creq_Request_set_target(req, "/placeholder", true);
+    creq_Request_set_http_version(req, 1, 1);
+    creq_Request_add_header(req, "Host", "www.example.com", true);
+    creq_Request_add_header(req, "X-Request-Id", "0", true);
+    creq_Request_set_message_body_content_len(req, "", true);
+
+    const creq_TemplateSlot_t slots[] = {
+        {TPL_SLOT_BODY, NULL},
+        {TPL_SLOT_TARGET, NULL},
+        {TPL_SLOT_HEADER_VALUE, "x-request-id"},
+        {TPL_SLOT_CONTENT_LENGTH, NULL},
+    };
+    creq_Template_t *tpl = creq_Template_compile_request(req, slots, 4);
+    TEST_ASSERT_NOT_NULL(tpl);
+    const creq_TemplateSlot_t bad_slots[] = {{TPL_SLOT_HEADER_VALUE, "X-Missing"}};
+    TEST_ASSERT_NULL(creq_Template_compile_request(req, bad_slots, 1));
+    const creq_TemplateSlot_t duplicate_slots[] = {{TPL_SLOT_TARGET, NULL}, {TPL_SLOT_TARGET, NULL}};
+    TEST_ASSERT_NULL(creq_Template_compile_request(req, duplicate_slots, 2));
+
+    char buf[256];
+    size_t needed = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        char target[32], id[16], body[32];
+        sprintf(target, "/items/%d", i);
+        sprintf(id, "req-%d", i);
+        sprintf(body, "{\"n\":%d}", i * 1000);
+        creq_TemplateValue_t values[4] = {{body, strlen(body)}, {target, strlen(target)}, {id, strlen(id)}, {NULL, 0}};
+        size_t len = creq_Template_render(tpl, values, buf, sizeof(buf), &needed);
+        TEST_ASSERT_EQUAL_UINT(needed, len);
+
+        creq_Request_set_target(req, target, false);
+        creq_Request_set_header(req, "X-Request-Id", id, false);
+        creq_Request_set_message_body_content_len(req, body, false);
+        char expected[256];
+        size_t expected_len = creq_Request_stringify_into(req, expected, sizeof(expected), &needed);
+        TEST_ASSERT_EQUAL_UINT(expected_len, len);
+        TEST_ASSERT_EQUAL_MEMORY(expected, buf, len);
+    }
+    TEST_ASSERT_EQUAL_UINT(0, creq_Template_render(tpl, NULL, buf, sizeof(buf), &needed));
+
+    creq_Template_free(tpl);
+    creq_Request_free(req);
+}
+
 void setUp()
 {
     // empty body; placeholder
@@ -113,6 +450,430 @@ void tearDown()
     // empty body; placeholder
 }
 
+void test_creq_Request_HeaderProfile()
+{
+    creq_Request_t *base = creq_Request_create(NULL);
+    creq_Request_add_header(base, "User-Agent", "creq", true);
+    char *accept = malloc(4);
+    strcpy(accept, "*/*");
+    creq_Request_add_header(base, "Accept", accept, false);
+    creq_HeaderProfile_t *profile = creq_HeaderProfile_create_from_request(base);
+    creq_Request_free(base);
+    free(accept);
+    TEST_ASSERT_NOT_NULL(profile);
+    TEST_ASSERT_EQUAL_UINT(2, creq_HeaderProfile_get_count(profile));
+
+    creq_Request_t *a = creq_Request_create(NULL);
+    creq_Request_t *b = creq_Request_create(NULL);
+    creq_Request_t *reqs[] = {a, b};
+    for (int i = 0; i < 2; i++)
+    {
+        creq_Request_set_http_method(reqs[i], METH_GET);
+        creq_Request_set_target(reqs[i], "/", true);
+        creq_Request_set_http_version(reqs[i], 1, 1);
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_set_header_profile(reqs[i], profile));
+    }
+    creq_HeaderProfile_release(profile);
+    creq_Request_add_header(b, "accept", "text/html", true);
+    creq_Request_add_header(b, "Host", "example.com", true);
+
+    char *str = creq_Request_stringify(a);
+    TEST_ASSERT_EQUAL_STRING("GET / HTTP/1.1\r\nUser-Agent: creq\r\nAccept: */*\r\n\r\n", str);
+    free(str);
+    str = creq_Request_stringify(b);
+    TEST_ASSERT_EQUAL_STRING("GET / HTTP/1.1\r\nUser-Agent: creq\r\naccept: text/html\r\nHost: example.com\r\n\r\n",
+                             str);
+    free(str);
+
+    TEST_ASSERT_EQUAL_STRING("text/html", creq_Request_search_for_header_id(b, CREQ_HDR_ACCEPT)->field_value);
+    TEST_ASSERT_EQUAL_INT(-1, creq_Request_search_for_header_index(b, "User-Agent"));
+    creq_HeaderIter_t iter;
+    TEST_ASSERT_EQUAL_STRING("text/html", creq_Request_header_iter_begin(b, &iter, "Accept")->field_value);
+    TEST_ASSERT_NULL(creq_Request_header_iter_next(b, &iter));
+
+    // lookups see both layers and change nothing, while searching only sees the object's own headers
+    TEST_ASSERT_NULL(creq_Request_search_for_header(b, "user-agent"));
+    TEST_ASSERT_NULL(creq_Request_header_iter_begin(a, &iter, "Accept"));
+    TEST_ASSERT_EQUAL_STRING("creq", creq_Request_lookup_header(b, "user-agent")->field_value);
+    TEST_ASSERT_EQUAL_STRING("text/html", creq_Request_lookup_header_id(b, CREQ_HDR_ACCEPT)->field_value);
+    TEST_ASSERT_EQUAL_STRING("*/*", creq_Request_lookup_header(a, "ACCEPT")->field_value);
+    TEST_ASSERT_NULL(creq_Request_lookup_header(a, "Host"));
+    TEST_ASSERT_NULL(creq_Request_lookup_header_id(NULL, CREQ_HDR_ACCEPT));
+    TEST_ASSERT_EQUAL_UINT(0, cvector_size(a->header_vector));
+    TEST_ASSERT_EQUAL_UINT(2, cvector_size(b->header_vector));
+    str = creq_Request_stringify(b);
+    TEST_ASSERT_EQUAL_STRING("GET / HTTP/1.1\r\nUser-Agent: creq\r\naccept: text/html\r\nHost: example.com\r\n\r\n",
+                             str);
+    free(str);
+
+    // overriding a profile header for one object is an explicit change to it
+    creq_Request_set_header(b, "User-Agent", "Creq", true);
+    str = creq_Request_stringify(a);
+    TEST_ASSERT_EQUAL_STRING("GET / HTTP/1.1\r\nUser-Agent: creq\r\nAccept: */*\r\n\r\n", str);
+    free(str);
+    str = creq_Request_stringify(b);
+    TEST_ASSERT_EQUAL_STRING("GET / HTTP/1.1\r\naccept: text/html\r\nHost: example.com\r\nUser-Agent: Creq\r\n\r\n",
+                             str);
+    free(str);
+
+    // a profile whose headers are all overridden still leaves a header block
+    creq_Request_t *c = creq_Request_create(NULL);
+    creq_Request_set_http_method(c, METH_GET);
+    creq_Request_set_target(c, "/", true);
+    creq_Request_set_http_version(c, 1, 1);
+    creq_Request_add_header(c, "X-Only", "1", true);
+    profile = creq_HeaderProfile_create_from_request(c);
+    creq_Request_set_header_profile(a, profile);
+    creq_HeaderProfile_release(profile);
+    str = creq_Request_stringify(a);
+    TEST_ASSERT_EQUAL_STRING("GET / HTTP/1.1\r\nX-Only: 1\r\n\r\n", str);
+    free(str);
+    creq_Request_set_header_profile(c, creq_HeaderProfile_retain(profile));
+    creq_HeaderProfile_release(profile);
+    char *expected = creq_Request_stringify(c);
+    creq_Request_set_header_profile(c, NULL);
+    str = creq_Request_stringify(c);
+    TEST_ASSERT_EQUAL_STRING(str, expected);
+    free(str);
+    free(expected);
+
+    creq_Request_free(a);
+    creq_Request_free(b);
+    creq_Request_free(c);
+}
+
+void test_creq_Request_Parse()
+{
+    const char *raw = "\r\nPOST /submit?x=1 HTTP/1.1\r\nHost: example.com\r\nX-Empty:\r\n"
+                      "Content-Length:  5 \r\n\r\nhelloGET / HTTP/1.0\n\n";
+    size_t raw_len = strlen(raw);
+    size_t first_len = raw_len - strlen("GET / HTTP/1.0\n\n");
+
+    // one byte at a time, into a buffer that moves on every read
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_Parser_t parser;
+    creq_Parser_init(&parser, NULL);
+    char *buf = NULL;
+    creq_status_t status = CREQ_STATUS_INCOMPLETE;
+    size_t len = 0;
+    while (status == CREQ_STATUS_INCOMPLETE)
+    {
+        char *grown = malloc(len + 1);
+        if (buf != NULL)
+            memcpy(grown, buf, len);
+        free(buf);
+        buf = grown;
+        buf[len] = raw[len];
+        len++;
+        status = creq_Request_parse(&parser, req, buf, len);
+    }
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, status);
+    TEST_ASSERT_EQUAL_UINT(first_len, len);
+    TEST_ASSERT_EQUAL_UINT(first_len, parser.consumed);
+    TEST_ASSERT_EQUAL_INT(METH_POST, creq_Request_get_http_method(req));
+    TEST_ASSERT_EQUAL_UINT(1, req->http_version.major);
+    TEST_ASSERT_EQUAL_UINT(1, req->http_version.minor);
+    TEST_ASSERT_EQUAL_UINT(strlen("/submit?x=1"), creq_Request_get_target_len(req));
+    TEST_ASSERT_EQUAL_MEMORY("/submit?x=1", creq_Request_get_target(req), creq_Request_get_target_len(req));
+    TEST_ASSERT_EQUAL_UINT(3, cvector_size(req->header_vector));
+    creq_HeaderField_t *pField = creq_Request_search_for_header_id(req, CREQ_HDR_CONTENT_LENGTH);
+    TEST_ASSERT_EQUAL_UINT(1, pField->field_value_len);
+    TEST_ASSERT_EQUAL_MEMORY("5", pField->field_value, 1);
+    TEST_ASSERT_TRUE(pField->is_field_value_literal);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_search_for_header(req, "x-empty")->field_value_len);
+    TEST_ASSERT_EQUAL_UINT(5, creq_Request_get_message_body_len(req));
+    TEST_ASSERT_TRUE(creq_Request_get_message_body(req) == buf + first_len - 5);
+    creq_Request_free(req);
+    free(buf);
+
+    // pipelined messages in one buffer
+    req = creq_Request_create(NULL);
+    creq_Parser_init(&parser, NULL);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_parse(&parser, req, raw, raw_len));
+    TEST_ASSERT_EQUAL_UINT(first_len, parser.consumed);
+    creq_Request_free(req);
+    req = creq_Request_create(NULL);
+    creq_Parser_init(&parser, NULL);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_parse(&parser, req, raw + first_len, raw_len - first_len));
+    TEST_ASSERT_EQUAL_INT(METH_GET, creq_Request_get_http_method(req));
+    TEST_ASSERT_EQUAL_UINT(0, req->http_version.minor);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_get_message_body_len(req));
+    creq_Request_free(req);
+
+    // limits and malformed input
+    const creq_ParseLimits_t limits = {2, 32};
+    const struct
+    {
+        const char *raw;
+        creq_ParseError_t error;
+    } bad[] = {
+        {"GET / HTTP/1.1\r\nA: 1\r\nB: 2\r\nC: 3\r\n\r\n", PARSE_ERR_TOO_MANY_HEADERS},
+        {"GET /a-very-long-target-beyond-the-limit HTTP/1.1\r\n", PARSE_ERR_LINE_TOO_LONG},
+        {"GET / HTTP/1.1\r\nX-Long: 0123456789abcdef0123456789", PARSE_ERR_LINE_TOO_LONG},
+        {"GET / HTTP/1.1\r\nBad Name: 1\r\n\r\n", PARSE_ERR_SYNTAX},
+        {"GET / HTTP/1.1\r\n folded\r\n\r\n", PARSE_ERR_SYNTAX},
+        {"GET / HTTP/1.1\r\nX: a\rb\r\n\r\n", PARSE_ERR_SYNTAX},
+        {"GET  / HTTP/1.1\r\n\r\n", PARSE_ERR_SYNTAX},
+        {"GET / HTTP/11\r\n\r\n", PARSE_ERR_SYNTAX},
+        {"GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", PARSE_ERR_SYNTAX},
+        {"GET / HTTP/1.1\r\nContent-Length: -1\r\n\r\n", PARSE_ERR_SYNTAX},
+        {"GET / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", PARSE_ERR_UNSUPPORTED},
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        req = creq_Request_create(NULL);
+        creq_Parser_init(&parser, &limits);
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_parse(&parser, req, bad[i].raw, strlen(bad[i].raw)));
+        TEST_ASSERT_EQUAL_INT(bad[i].error, parser.error);
+        creq_Request_free(req);
+    }
+
+    // a parsed request serializes back to the same bytes
+    const char *canonical = "PUT /x HTTP/1.1\r\nhost: a\r\nContent-Length: 2\r\n\r\nhi";
+    req = creq_Request_create(NULL);
+    creq_Parser_init(&parser, NULL);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_parse(&parser, req, canonical, strlen(canonical)));
+    char out[128];
+    size_t needed = 0;
+    size_t out_len = creq_Request_stringify_into(req, out, sizeof(out), &needed);
+    TEST_ASSERT_EQUAL_UINT(strlen(canonical), out_len);
+    TEST_ASSERT_EQUAL_MEMORY(canonical, out, out_len);
+    creq_Request_free(req);
+}
+
+void test_creq_Request_Validate()
+{
+    creq_Request_t *req = creq_Request_create(NULL);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_validate(req));
+    creq_Request_set_http_method(req, METH_GET);
+    creq_Request_set_target(req, "/index.html?q=1", true);
+    creq_Request_set_http_version(req, 1, 1);
+    creq_Request_add_header(req, "Host", "www.example.com", true);
+    creq_Request_add_header(req, "X-Long-Header-Name-With-Many-Characters~!#$",
+                            "a value\twith tabs, spaces and \xC3\xA9 that spans more than one vector", true);
+    TEST_ASSERT_FALSE(req->is_verified);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_validate(req));
+    TEST_ASSERT_TRUE(req->is_verified);
+
+    // every setter drops the verdict
+    creq_Request_set_header(req, "Host", "example.com", true);
+    TEST_ASSERT_FALSE(req->is_verified);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_validate(req));
+
+    // a bad byte at every position of a value long enough for the vector paths
+    char value[80];
+    for (size_t pos = 0; pos < sizeof(value) - 1; pos++)
+    {
+        memset(value, 'v', sizeof(value) - 1);
+        value[sizeof(value) - 1] = '\0';
+        value[pos] = '\n';
+        creq_Request_set_header(req, "X-Injected", value, false);
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_validate(req));
+        TEST_ASSERT_FALSE(req->is_verified);
+        value[pos] = '"';
+        creq_Request_set_header(req, value, "ok", false);
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_validate(req));
+        creq_Request_remove_header(req, value);
+        value[pos] = 'v';
+        creq_Request_set_header(req, "X-Injected", value, false);
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_validate(req));
+    }
+
+    creq_Request_set_target(req, "/with space", true);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_validate(req));
+    creq_Request_set_target(req, "/", true);
+    creq_Request_set_http_version(req, 10, 0);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_validate(req));
+    creq_Request_free(req);
+
+    // CONF_OPT_VALIDATE refuses to serialize an invalid request
+    creq_Config_t req_conf = {0};
+    req_conf.config_type = CONF_REQUEST;
+    req_conf.data.request_config.line_ending = LE_CRLF;
+    req = creq_Request_create_with_options(&req_conf, CONF_OPT_VALIDATE);
+    creq_Request_set_http_method(req, METH_GET);
+    creq_Request_set_target(req, "/", true);
+    creq_Request_set_http_version(req, 1, 1);
+    creq_Request_add_header(req, "X-Evil", "a\r\nSet-Cookie: x", true);
+    size_t needed = 1;
+    TEST_ASSERT_NULL(creq_Request_stringify(req));
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_stringify_into(req, NULL, 0, &needed));
+    TEST_ASSERT_EQUAL_UINT(0, needed);
+    TEST_ASSERT_NULL(creq_Template_compile_request(req, NULL, 0));
+    creq_Request_set_header(req, "X-Evil", "a", true);
+    creq_Template_t *tpl = creq_Template_compile_request(req, NULL, 0);
+    TEST_ASSERT_NOT_NULL(tpl);
+    creq_Template_free(tpl);
+    char *str = creq_Request_stringify(req);
+    TEST_ASSERT_EQUAL_STRING("GET / HTTP/1.1\r\nX-Evil: a\r\n\r\n", str);
+    TEST_ASSERT_TRUE(req->is_verified);
+    free(str);
+    creq_Request_free(req);
+}
+
+void test_creq_Request_StringifyBatch()
+{
+    creq_Request_t *reqs[3];
+    char expected[512];
+    size_t expected_len = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        char target[16];
+        sprintf(target, "/item/%d", i);
+        reqs[i] = creq_Request_create(NULL);
+        creq_Request_set_http_method(reqs[i], i == 2 ? METH_POST : METH_GET);
+        creq_Request_set_target(reqs[i], target, false);
+        creq_Request_set_http_version(reqs[i], 1, 1);
+        creq_Request_add_header(reqs[i], "Host", "example.com", true);
+        if (i == 2)
+            creq_Request_set_message_body_content_len(reqs[i], "a=1", true);
+        char *str = creq_Request_stringify(reqs[i]);
+        strcpy(expected + expected_len, str);
+        expected_len += strlen(str);
+        free(str);
+    }
+
+    char buf[512];
+    size_t offsets[4], needed = 0;
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_stringify_batch(reqs, 3, NULL, 0, offsets, &needed));
+    TEST_ASSERT_EQUAL_UINT(expected_len, needed);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_stringify_batch(reqs, 3, buf, needed - 1, NULL, &needed));
+    TEST_ASSERT_EQUAL_UINT(expected_len, creq_Request_stringify_batch(reqs, 3, buf, sizeof(buf), offsets, &needed));
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, expected_len);
+    TEST_ASSERT_EQUAL_UINT(0, offsets[0]);
+    TEST_ASSERT_EQUAL_UINT(expected_len, offsets[3]);
+    TEST_ASSERT_EQUAL_MEMORY("GET /item/1 ", buf + offsets[1], 12);
+    TEST_ASSERT_EQUAL_MEMORY("POST /item/2 ", buf + offsets[2], 13);
+
+    creq_IoVec_t iov[64];
+    creq_IoVecScratch_t scratches[3];
+    size_t count = creq_Request_to_iovec_batch(reqs, 3, iov, 64, scratches, offsets, &needed);
+    TEST_ASSERT_EQUAL_UINT(needed, count);
+    TEST_ASSERT_EQUAL_UINT(count, offsets[3]);
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_MEMORY(expected + pos, iov[i].iov_base, iov[i].iov_len);
+        pos += iov[i].iov_len;
+    }
+    TEST_ASSERT_EQUAL_UINT(expected_len, pos);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_to_iovec_batch(reqs, 3, iov, count - 1, scratches, NULL, NULL));
+
+    creq_Request_t *with_null[] = {reqs[0], NULL};
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_stringify_batch(with_null, 2, buf, sizeof(buf), NULL, &needed));
+    TEST_ASSERT_EQUAL_UINT(0, needed);
+    for (int i = 0; i < 3; i++)
+        creq_Request_free(reqs[i]);
+}
+
+void test_creq_Request_MemoryUsage()
+{
+    creq_Stats_t before, after;
+    bool has_stats = creq_get_stats(NULL, &before) == CREQ_STATUS_SUCC;
+
+    creq_Request_t *req = creq_Request_create(NULL);
+    TEST_ASSERT_EQUAL_UINT(sizeof(creq_Request_t), creq_Request_memory_usage(req));
+    creq_Request_set_target(req, "/index.html", false);
+    creq_Request_add_header(req, "Host", "example.com", false);
+    creq_Request_add_header(req, "Accept", "*/*", true);
+    TEST_ASSERT_EQUAL_UINT(sizeof(creq_Request_t) + 12 + 5 + 12, creq_Request_memory_usage(req));
+    for (int i = 0; i < CREQ_INLINE_HEADER_CAPACITY; i++)
+    {
+        creq_Request_add_header(req, "X-Literal", "value", true);
+    }
+    size_t usage = creq_Request_memory_usage(req);
+    TEST_ASSERT_GREATER_THAN(sizeof(creq_Request_t) + 29 + sizeof(creq_HeaderField_t) * CREQ_INLINE_HEADER_CAPACITY,
+                             usage);
+    if (has_stats)
+    {
+        creq_get_stats(NULL, &after);
+        TEST_ASSERT_TRUE(after.bytes_live >= before.bytes_live + (int64_t)usage);
+        TEST_ASSERT_TRUE(after.alloc_count == before.alloc_count + 5);
+    }
+    creq_Request_free(req);
+    if (has_stats)
+    {
+        creq_get_stats(NULL, &after);
+        TEST_ASSERT_TRUE(after.bytes_live == before.bytes_live);
+        TEST_ASSERT_TRUE(after.bytes_peak >= before.bytes_live + (int64_t)usage);
+    }
+
+    creq_Config_t config = {0};
+    config.config_type = CONF_REQUEST;
+    req = creq_Request_create_with_options(&config, CONF_OPT_ARENA);
+    TEST_ASSERT_TRUE(creq_Request_memory_usage(req) >= CREQ_ARENA_BLOCK_SIZE);
+    creq_Request_free(req);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Request_memory_usage(NULL));
+}
+
+static void fill_request(creq_Request_t *req, char *target)
+{
+    char value[16];
+    creq_Request_set_http_method(req, METH_GET);
+    creq_Request_set_target(req, target, false);
+    creq_Request_set_http_version(req, 1, 1);
+    for (int i = 0; i < CREQ_INLINE_HEADER_CAPACITY + 4; i++)
+    {
+        snprintf(value, sizeof(value), "value-%d", i);
+        creq_Request_add_header(req, "X-Copied", value, false);
+    }
+    creq_Request_set_message_body_bytes(req, "hello", 5, OWN_COPY);
+}
+
+void test_creq_Request_Reset()
+{
+    creq_Config_t config = {0};
+    config.config_type = CONF_REQUEST;
+    int options[] = {CONF_OPT_HEADER_INDEX, CONF_OPT_ARENA | CONF_OPT_HEADER_INDEX};
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++)
+    {
+        creq_Request_t *req = creq_Request_create_with_options(&config, options[i]);
+        fill_request(req, "/first/and/longer");
+        size_t len = 0;
+        TEST_ASSERT_NOT_NULL(creq_Request_stringify_cached(req, &len));
+
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_reset(req));
+        TEST_ASSERT_EQUAL_INT(_METH_UNKNOWN, req->method);
+        TEST_ASSERT_NULL(req->request_target);
+        TEST_ASSERT_NULL(req->message_body);
+        TEST_ASSERT_EQUAL_UINT(0, cvector_size(req->header_vector));
+        TEST_ASSERT_NULL(creq_Request_search_for_header(req, "X-Copied"));
+        size_t usage = creq_Request_memory_usage(req);
+
+        // a short target and then the long one again: recycled buffers keep their full capacity across resets
+        char *targets[] = {"/second", "/first/and/longer"};
+        for (size_t j = 0; j < sizeof(targets) / sizeof(targets[0]); j++)
+        {
+            size_t calls = 0;
+            creq_Allocator_t allocator = {counting_malloc, counting_realloc, counting_free, &calls};
+            creq_set_allocator(&allocator);
+            fill_request(req, targets[j]);
+            const char *cached = creq_Request_stringify_cached(req, &len);
+            creq_set_allocator(NULL);
+            TEST_ASSERT_EQUAL_UINT(0, calls);
+            TEST_ASSERT_EQUAL_UINT(usage, creq_Request_memory_usage(req));
+
+            char *expected = creq_Request_stringify(req);
+            TEST_ASSERT_EQUAL_STRING(expected, cached);
+            TEST_ASSERT_EQUAL_STRING(targets[j], req->request_target);
+            TEST_ASSERT_EQUAL_STRING("value-0", creq_Request_search_for_header(req, "X-Copied")->field_value);
+            creq_free(expected);
+            TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_reset(req));
+            TEST_ASSERT_EQUAL_UINT(usage, creq_Request_memory_usage(req));
+        }
+
+        // releasing a recycled string outside a reset must not leave its capacity on record
+        fill_request(req, "/first/and/longer");
+        creq_Request_set_target(req, "/", true);
+        creq_Request_remove_header(req, "X-Copied");
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Request_reset(req));
+        fill_request(req, "/first/and/longer");
+        TEST_ASSERT_EQUAL_STRING("/first/and/longer", req->request_target);
+        creq_Request_free(req);
+    }
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Request_reset(NULL));
+}
+
 int main(int argc, char *argv[])
 {
     UNITY_BEGIN();
@@ -120,6 +881,22 @@ int main(int argc, char *argv[])
     RUN_TEST(test_creq_Request_HeaderModification);
     RUN_TEST(test_creq_Request_ContentLenCalculation);
     RUN_TEST(test_creq_Request_ContentLenReplacement);
+    RUN_TEST(test_creq_Request_StringifyInto);
+    RUN_TEST(test_creq_Request_ToIoVec);
+    RUN_TEST(test_creq_Request_ArenaMode);
+    RUN_TEST(test_creq_Request_AllocatorHooks);
+    RUN_TEST(test_creq_Request_HeaderFieldPool);
+    RUN_TEST(test_creq_Request_InlineHeaderStorage);
+    RUN_TEST(test_creq_Request_WellKnownHeaderIds);
+    RUN_TEST(test_creq_Request_BinaryBody);
+    RUN_TEST(test_creq_Request_LengthSetters);
+    RUN_TEST(test_creq_Request_Template);
+    RUN_TEST(test_creq_Request_HeaderProfile);
+    RUN_TEST(test_creq_Request_Parse);
+    RUN_TEST(test_creq_Request_Validate);
+    RUN_TEST(test_creq_Request_StringifyBatch);
+    RUN_TEST(test_creq_Request_MemoryUsage);
+    RUN_TEST(test_creq_Request_Reset);
     
     return UNITY_END();
 }
\ No newline at end of file
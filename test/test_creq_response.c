@@ -1,5 +1,15 @@
 #include "creq.h"
 #include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef CREQ_POSIX_IO
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 void test_creq_Response_BasicOperations()
 {
@@ -53,6 +63,461 @@ void test_creq_Response_ContentLenCalculation()
     creq_Response_free(resp);
 }
 
+void test_creq_Response_StringifyInto()
+{
+    creq_Response_t *resp = NULL;
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_LF;
+
+    resp = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(resp, 1, 0);
+    creq_Response_set_status_code(resp, 404);
+    creq_Response_set_reason_phrase_literal(resp, "Not Found");
+
+    char buf[256];
+    size_t needed = 0;
+    size_t len = creq_Response_stringify_into(resp, buf, sizeof(buf), &needed);
+    TEST_ASSERT_EQUAL_UINT(needed, len);
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.0 404 Not Found\n\n\n", buf, len);
+
+    creq_Response_add_header_literal(resp, "Connection", "close");
+    creq_Response_set_message_body_content_len(resp, "gone");
+    char *expected = creq_Response_stringify(resp);
+    len = creq_Response_stringify_into(resp, buf, sizeof(buf), &needed);
+    TEST_ASSERT_EQUAL_UINT(strlen(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.0 404 Not Found\nConnection: close\nContent-Length: 4\n\ngone", buf, len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, len);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Response_stringify_into(resp, buf, len - 1, &needed));
+    TEST_ASSERT_EQUAL_UINT(len, needed);
+
+    free(expected);
+    creq_Response_free(resp);
+}
+
+void test_creq_Response_ToIoVec()
+{
+    static const char body_s[] = "<html><body>A large literal body that is never copied.</body></html>";
+    creq_Response_t *resp = NULL;
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_CRLF;
+
+    resp = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase(resp, "OK");
+    // a well-known name spelled in a caller's buffer is still emitted as name, separator and value
+    char type_name[] = "Content-Type";
+    creq_Response_add_header_literal(resp, type_name, "text/html");
+    creq_Response_set_message_body_literal_content_len(resp, body_s);
+
+    creq_IoVec_t iov[32];
+    creq_IoVecScratch_t scratch;
+    size_t needed = 0;
+    TEST_ASSERT_EQUAL_UINT(0, creq_Response_to_iovec(resp, iov, 2, &scratch, &needed));
+    // The standard status line is a single piece and Content-Length is emitted as a single "Name: " run.
+    TEST_ASSERT_EQUAL_UINT(10, needed);
+    size_t count = creq_Response_to_iovec(resp, iov, 32, &scratch, &needed);
+    TEST_ASSERT_EQUAL_UINT(needed, count);
+    TEST_ASSERT_EQUAL_PTR(body_s, iov[count - 1].iov_base);
+    TEST_ASSERT_EQUAL_UINT(strlen(body_s), iov[count - 1].iov_len);
+
+    char joined[512];
+    size_t joined_len = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(joined + joined_len, iov[i].iov_base, iov[i].iov_len);
+        joined_len += iov[i].iov_len;
+    }
+    char *expected = creq_Response_stringify(resp);
+    TEST_ASSERT_EQUAL_UINT(strlen(expected), joined_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, joined, joined_len);
+
+    // more entries than one writev() call takes are refused
+    for (int i = 0; i < CREQ_IOV_MAX / 4; i++)
+    {
+        creq_Response_add_header_literal(resp, "X-Filler", "value");
+    }
+    creq_IoVec_t *big_iov = (creq_IoVec_t *)malloc(sizeof(creq_IoVec_t) * CREQ_IOV_MAX * 2);
+    TEST_ASSERT_EQUAL_UINT(0, creq_Response_to_iovec(resp, big_iov, CREQ_IOV_MAX * 2, &scratch, &needed));
+    TEST_ASSERT_TRUE(needed > CREQ_IOV_MAX);
+    free(big_iov);
+
+    free(expected);
+    creq_Response_free(resp);
+}
+
+void test_creq_Response_ArenaMode()
+{
+    creq_Response_t *resp = NULL;
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_CRLF;
+    resp = creq_Response_create_with_options(&resp_conf, CONF_OPT_ARENA);
+    TEST_ASSERT_NOT_NULL(resp->arena);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase(resp, "Okay");
+    creq_Response_set_reason_phrase(resp, "OK");
+    creq_Response_add_header(resp, "Server", "creq");
+    creq_Response_add_header_literal(resp, "Connection", "close");
+    creq_Response_remove_header(resp, "Server");
+    creq_Response_set_message_body_content_len(resp, "Hello world!");
+
+    char *actual = creq_Response_stringify(resp);
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 12\r\n\r\nHello world!", actual);
+    free(actual);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_free(resp));
+}
+
+void test_creq_Response_HeaderIndexAndUpsert()
+{
+    for (unsigned options = 0; options <= CONF_OPT_HEADER_INDEX; options += CONF_OPT_HEADER_INDEX)
+    {
+        creq_Config_t resp_conf = {0};
+        resp_conf.config_type = CONF_RESPONSE;
+        resp_conf.data.response_config.line_ending = LE_CRLF;
+        creq_Response_t *resp = creq_Response_create_with_options(&resp_conf, options);
+
+        char name[32];
+        for (int i = 0; i < 40; i++)
+        {
+            sprintf(name, "X-Filler-%d", i);
+            creq_Response_add_header(resp, name, "filler");
+            if (i % 10 == 0)
+            {
+                creq_Response_add_header_literal(resp, "Set-Cookie", i == 0 ? "a=1" : i == 10 ? "b=2" : "c=3");
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(options != 0, resp->header_index != NULL);
+        TEST_ASSERT_EQUAL_INT(1, creq_Response_search_for_header_index(resp, "set-cookie"));
+        TEST_ASSERT_EQUAL_STRING("filler", creq_Response_search_for_header(resp, "x-FILLER-39")->field_value);
+
+        creq_HeaderIter_t iter;
+        const char *expected[] = {"a=1", "b=2", "c=3", "c=3"};
+        int count = 0;
+        for (creq_HeaderField_t *f = creq_Response_header_iter_begin(resp, &iter, "SET-COOKIE"); f != NULL;
+             f = creq_Response_header_iter_next(resp, &iter))
+        {
+            TEST_ASSERT_EQUAL_STRING(expected[count], f->field_value);
+            count++;
+        }
+        TEST_ASSERT_EQUAL_INT(4, count);
+
+        creq_Response_remove_header(resp, "X-Filler-0");
+        TEST_ASSERT_EQUAL_INT(0, creq_Response_search_for_header_index(resp, "Set-Cookie"));
+        TEST_ASSERT_EQUAL_INT(-1, creq_Response_search_for_header_index(resp, "X-Filler-0"));
+        TEST_ASSERT_EQUAL_INT(1, creq_Response_search_for_header_index(resp, "X-Filler-1"));
+
+        size_t size_before = cvector_size(resp->header_vector), cached_len = 0;
+        TEST_ASSERT_NOT_NULL(creq_Response_stringify_cached(resp, &cached_len));
+        creq_Response_set_header(resp, "set-cookie", "z=9");
+        TEST_ASSERT_EQUAL_UINT(size_before - 3, cvector_size(resp->header_vector));
+        for (size_t i = 1; i < cvector_size(resp->header_vector); i++)
+        {
+            char *field_name = resp->header_vector[i].field_name;
+            TEST_ASSERT_EQUAL_INT((int)i, creq_Response_search_for_header_index(resp, field_name));
+        }
+        char *fresh = creq_Response_stringify(resp);
+        TEST_ASSERT_EQUAL_STRING(fresh, creq_Response_stringify_cached(resp, &cached_len));
+        free(fresh);
+        TEST_ASSERT_EQUAL_INT(0, creq_Response_search_for_header_index(resp, "Set-Cookie"));
+        TEST_ASSERT_EQUAL_STRING("Set-Cookie", resp->header_vector[0].field_name);
+        TEST_ASSERT_EQUAL_STRING("z=9", resp->header_vector[0].field_value);
+        TEST_ASSERT_NULL(creq_Response_header_iter_next(resp, &iter));
+        TEST_ASSERT_NOT_NULL(creq_Response_header_iter_begin(resp, &iter, "Set-Cookie"));
+        TEST_ASSERT_NULL(creq_Response_header_iter_next(resp, &iter));
+
+        creq_Response_set_header_literal(resp, "Connection", "close");
+        TEST_ASSERT_EQUAL_INT((int)size_before - 3, creq_Response_search_for_header_index(resp, "connection"));
+        TEST_ASSERT_EQUAL_STRING("X-Filler-39", creq_Response_search_for_header(resp, "x-filler-39")->field_name);
+
+        // removals must keep every remaining name findable at its first occurrence
+        creq_Response_add_header_literal(resp, "X-Filler-5", "again");
+        for (int step = 0; step < 39; step++)
+        {
+            sprintf(name, "X-Filler-%d", 1 + step * 7 % 39);
+            creq_Response_remove_header(resp, name);
+            for (size_t i = 0; i < cvector_size(resp->header_vector); i++)
+            {
+                char *fieldName = resp->header_vector[i].field_name;
+                size_t first = 0;
+                while (strcmp(resp->header_vector[first].field_name, fieldName) != 0)
+                {
+                    first++;
+                }
+                TEST_ASSERT_EQUAL_INT((int)first, creq_Response_search_for_header_index(resp, fieldName));
+            }
+        }
+        TEST_ASSERT_EQUAL_STRING("again", creq_Response_search_for_header(resp, "X-Filler-5")->field_value);
+        creq_Response_remove_header(resp, "X-Filler-5");
+        TEST_ASSERT_EQUAL_INT(-1, creq_Response_search_for_header_index(resp, "X-Filler-5"));
+        TEST_ASSERT_EQUAL_INT(0, creq_Response_search_for_header_index(resp, "Set-Cookie"));
+        creq_Response_free(resp);
+    }
+}
+
+void test_creq_Response_WellKnownHeaderIds()
+{
+    static const char expected[] = "HTTP/1.1 200 OK\r\n"
+                                   "Content-Type: text/plain\r\n"
+                                   "server: creq\r\n"
+                                   "Content-Length: 2\r\n"
+                                   "\r\n"
+                                   "hi";
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_CRLF;
+    creq_Response_t *resp = creq_Response_create_with_options(&resp_conf, CONF_OPT_HEADER_INDEX);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase(resp, "OK");
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC,
+                          creq_Response_add_header_id_literal(resp, CREQ_HDR_CONTENT_TYPE, "text/plain"));
+    creq_Response_add_header(resp, "server", "creq");
+    creq_Response_set_message_body_content_len(resp, "hi");
+
+    TEST_ASSERT_EQUAL_INT(CREQ_HDR_SERVER, resp->header_vector[1].field_id);
+    TEST_ASSERT_EQUAL_PTR(&resp->header_vector[1], creq_Response_search_for_header_id(resp, CREQ_HDR_SERVER));
+    TEST_ASSERT_EQUAL_INT(2, creq_Response_search_for_header_index(resp, "CONTENT-LENGTH"));
+
+    char *str = creq_Response_stringify(resp);
+    TEST_ASSERT_EQUAL_STRING(expected, str);
+    creq_free(str);
+    creq_Response_free(resp);
+}
+
+void test_creq_Response_BinaryBody()
+{
+    static const char payload[] = {'\x1f', '\x8b', '\0', '\0', 'z', '\0'};
+    static const char head[] = "HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\n";
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_CRLF;
+    creq_Response_t *resp = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase_literal(resp, "OK");
+
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC,
+                          creq_Response_set_message_body_bytes(resp, payload, sizeof(payload), OWN_COPY));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_update_content_len(resp));
+    TEST_ASSERT_EQUAL_UINT(sizeof(payload), creq_Response_get_message_body_len(resp));
+    TEST_ASSERT_NOT_EQUAL(payload, creq_Response_get_message_body(resp));
+
+    char buf[128];
+    size_t needed = 0;
+    size_t len = creq_Response_stringify_into(resp, buf, sizeof(buf), &needed);
+    TEST_ASSERT_EQUAL_UINT(sizeof(head) - 1 + sizeof(payload), len);
+    TEST_ASSERT_EQUAL_MEMORY(head, buf, sizeof(head) - 1);
+    TEST_ASSERT_EQUAL_MEMORY(payload, buf + sizeof(head) - 1, sizeof(payload));
+
+    char *owned = creq_malloc(3);
+    memcpy(owned, "a\0b", 3);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_set_message_body_bytes(resp, owned, 3, OWN_TRANSFER));
+    TEST_ASSERT_EQUAL_PTR(owned, creq_Response_get_message_body(resp));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_set_message_body_bytes(resp, NULL, 3, OWN_COPY));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_set_message_body_bytes(resp, NULL, 0, OWN_COPY));
+    TEST_ASSERT_EQUAL_UINT(0, creq_Response_get_message_body_len(resp));
+
+    creq_Response_free(resp);
+}
+
+void test_creq_Response_LengthSetters()
+{
+    static const char status[] = "Not Modified, really";
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_LF;
+    creq_Response_t *resp = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 304);
+    creq_Response_set_reason_phrase_literal_n(resp, status, 12);
+    TEST_ASSERT_EQUAL_UINT(12, creq_Response_get_reason_phrase_len(resp));
+    creq_Response_add_header_literal_n(resp, "ETag: \"abc\"", 4, "\"abc\"xyz", 5);
+    creq_Response_add_header_n(resp, "Vary-ish", 4, "Accept-Encoding, Cookie", 15);
+    creq_Response_set_header_literal_n(resp, "etag", 4, "\"def\"", 5);
+    creq_Response_set_header_n(resp, "Age!", 3, "42", 2);
+
+    char buf[128];
+    size_t needed = 0;
+    size_t len = creq_Response_stringify_into(resp, buf, sizeof(buf), &needed);
+    static const char expected[] = "HTTP/1.1 304 Not Modified\nETag: \"def\"\nVary: Accept-Encoding\nAge: 42\n\n";
+    TEST_ASSERT_EQUAL_UINT(sizeof(expected) - 1, len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, len);
+    TEST_ASSERT_EQUAL_INT(CREQ_HDR_VARY, resp->header_vector[1].field_id);
+
+    creq_Response_set_reason_phrase_n(resp, status, 3);
+    TEST_ASSERT_EQUAL_STRING("Not", creq_Response_get_reason_phrase(resp));
+    creq_Response_free(resp);
+}
+
+void test_creq_Response_BodyFile()
+{
+#ifdef CREQ_POSIX_IO
+    static const char content[] = "0123456789<html>static asset</html>";
+    static const char expected[] = "HTTP/1.1 200 OK\r\nContent-Length: 25\r\n\r\n<html>static asset</html>";
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(content, 1, sizeof(content) - 1, file);
+    fflush(file);
+    int pipe_fds[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(pipe_fds));
+
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_CRLF;
+    creq_Response_t *resp = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase_literal(resp, "OK");
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_set_body_file(resp, fileno(file), 10, 25));
+    TEST_ASSERT_EQUAL_STRING("25", creq_Response_search_for_header_id(resp, CREQ_HDR_CONTENT_LENGTH)->field_value);
+
+    size_t needed = 0;
+    char head[64];
+    TEST_ASSERT_EQUAL_UINT(sizeof(expected) - 1 - 25, creq_Response_stringify_into(resp, head, sizeof(head), &needed));
+
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_send(resp, pipe_fds[1]));
+    char buf[128];
+    ssize_t got = read(pipe_fds[0], buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT((int)sizeof(expected) - 1, (int)got);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, got);
+
+    creq_Response_set_message_body_literal(resp, "x");
+    TEST_ASSERT_EQUAL_INT(-1, resp->body_file.fd);
+
+    // a peer that has gone away fails the send instead of raising SIGPIPE
+    int sock_fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sock_fds));
+    close(sock_fds[1]);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_send(resp, sock_fds[0]));
+    TEST_ASSERT_EQUAL_INT(EPIPE, errno);
+    close(sock_fds[0]);
+
+    // sendfile() refuses O_APPEND outputs, so the mapping fallback runs; a range past the end of the file must fail
+    // rather than touch unmapped pages
+    FILE *out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ASSERT_EQUAL_INT(0, fcntl(fileno(out), F_SETFL, O_APPEND));
+    creq_Response_set_body_file(resp, fileno(file), 10, 25);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_send(resp, fileno(out)));
+    TEST_ASSERT_EQUAL_INT(0, fseek(out, 0, SEEK_SET));
+    TEST_ASSERT_EQUAL_UINT(sizeof(expected) - 1, fread(buf, 1, sizeof(buf), out));
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, sizeof(expected) - 1);
+    creq_Response_set_body_file(resp, fileno(file), 10, 40);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_send(resp, fileno(out)));
+    fclose(out);
+
+    creq_Response_free(resp);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    fclose(file);
+#else
+    TEST_IGNORE_MESSAGE("POSIX I/O unavailable");
+#endif
+}
+
+static size_t chunk_source(void *user_data, char *buf, size_t cap)
+{
+    const char **remaining = (const char **)user_data;
+    size_t len = strlen(*remaining);
+    len = len < cap ? len : cap;
+    memcpy(buf, *remaining, len);
+    *remaining += len;
+    return len;
+}
+
+void test_creq_Response_ChunkedEncoder()
+{
+    static const char expected[] = "HTTP/1.1 200 OK\r\n"
+                                   "Trailer: Expires\r\n"
+                                   "Transfer-Encoding: chunked\r\n"
+                                   "\r\n"
+                                   "1a\r\nabcdefghijklmnopqrstuvwxyz\r\n"
+                                   "3\r\nxyz\r\n"
+                                   "2\r\n12\r\n"
+                                   "0\r\n"
+                                   "Expires: never\r\n"
+                                   "\r\n";
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_CRLF;
+    creq_Response_t *resp = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase_literal(resp, "OK");
+    creq_Response_add_header_literal(resp, "Trailer", "Expires");
+    creq_Response_set_message_body_literal_content_len(resp, "ignored");
+
+    char out[512];
+    size_t pos = 0, needed = 0, offset = 0;
+    creq_ChunkedEncoder_t enc;
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_begin(&enc, resp, out, 8, &needed));
+    TEST_ASSERT_NOT_NULL(creq_Response_search_for_header_id(resp, CREQ_HDR_CONTENT_LENGTH));
+    TEST_ASSERT_NULL(creq_Response_search_for_header_id(resp, CREQ_HDR_TRANSFER_ENCODING));
+    size_t sized = needed;
+    pos += creq_ChunkedEncoder_begin(&enc, resp, out, sizeof(out), &needed);
+    TEST_ASSERT_EQUAL_UINT(sized, pos);
+    TEST_ASSERT_EQUAL_UINT(needed, pos);
+    TEST_ASSERT_NULL(creq_Response_search_for_header_id(resp, CREQ_HDR_CONTENT_LENGTH));
+
+    pos += creq_ChunkedEncoder_write_chunk(&enc, "abcdefghijklmnopqrstuvwxyz", 26, out + pos, sizeof(out) - pos, NULL);
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_write_chunk(&enc, "", 0, out + pos, sizeof(out) - pos, &needed));
+
+    const char *remaining = "xyz";
+    char scratch[64];
+    size_t len = creq_ChunkedEncoder_pull_chunk(&enc, chunk_source, &remaining, scratch, sizeof(scratch), &offset);
+    memcpy(out + pos, scratch + offset, len);
+    pos += len;
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_pull_chunk(&enc, chunk_source, &remaining, scratch, sizeof(scratch),
+                                                             &offset));
+    pos += creq_ChunkedEncoder_write_chunk(&enc, "12", 2, out + pos, sizeof(out) - pos, NULL);
+
+    creq_HeaderField_t *trailer = creq_HeaderField_create_literal("Expires", "never");
+    pos += creq_ChunkedEncoder_finish(&enc, &trailer, 1, out + pos, sizeof(out) - pos, &needed);
+    TEST_ASSERT_EQUAL_UINT(sizeof(expected) - 1, pos);
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, pos);
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_finish(&enc, NULL, 0, out, sizeof(out), NULL));
+
+    creq_HeaderField_free(&trailer);
+
+    creq_Response_free(resp);
+
+    // a Content-Length of the header profile is left out as well
+    resp = creq_Response_create(&resp_conf);
+    creq_Response_add_header_literal(resp, "Content-Length", "7");
+    creq_HeaderProfile_t *profile = creq_HeaderProfile_create_from_response(resp);
+    creq_Response_t *other = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(other, 1, 1);
+    creq_Response_set_status_code(other, 200);
+    creq_Response_set_reason_phrase_literal(other, "OK");
+    creq_Response_set_header_profile(other, profile);
+    static const char expectedHead[] = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_begin(&enc, other, NULL, 0, &needed));
+    TEST_ASSERT_EQUAL_UINT(sizeof(expectedHead) - 1, needed);
+    TEST_ASSERT_NULL(other->header_vector);
+    TEST_ASSERT_EQUAL_UINT(sizeof(expectedHead) - 1, creq_ChunkedEncoder_begin(&enc, other, out, sizeof(out), NULL));
+    TEST_ASSERT_EQUAL_MEMORY(expectedHead, out, sizeof(expectedHead) - 1);
+
+    // an existing Transfer-Encoding must end with chunked, its last field counting
+    creq_Response_add_header_literal(other, "Transfer-Encoding", "gzip");
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_begin(&enc, other, out, sizeof(out), &needed));
+    TEST_ASSERT_EQUAL_UINT(0, needed);
+    creq_Response_add_header_literal(other, "Transfer-Encoding", "br, CHUNKED ");
+    static const char codedHead[] = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: gzip\r\n"
+                                    "Transfer-Encoding: br, CHUNKED \r\n\r\n";
+    TEST_ASSERT_EQUAL_UINT(sizeof(codedHead) - 1, creq_ChunkedEncoder_begin(&enc, other, out, sizeof(out), NULL));
+    TEST_ASSERT_EQUAL_MEMORY(codedHead, out, sizeof(codedHead) - 1);
+    creq_Response_add_header_literal(other, "Transfer-Encoding", "xchunked");
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_begin(&enc, other, out, sizeof(out), NULL));
+
+    creq_HeaderProfile_release(profile);
+    creq_Response_free(other);
+    creq_Response_free(resp);
+}
+
 void setUp()
 {
     // placeholder
@@ -63,9 +528,554 @@ void tearDown()
     // placeholder
 }
 
+void test_creq_Response_HeaderProfile()
+{
+    creq_Response_t *base = creq_Response_create(NULL);
+    creq_Response_add_header_literal(base, "Server", "creq");
+    creq_Response_add_header_literal(base, "Cache-Control", "no-store");
+    creq_HeaderProfile_t *profile = creq_HeaderProfile_create_from_response(base);
+    creq_Response_free(base);
+    TEST_ASSERT_NOT_NULL(profile);
+
+    creq_Response_t *resp = creq_Response_create(NULL);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase_literal(resp, "OK");
+    creq_Response_set_header_profile(resp, profile);
+    creq_HeaderProfile_release(profile);
+    creq_Response_add_header_literal(resp, "Cache-Control", "max-age=60");
+    creq_Response_set_message_body_literal_content_len(resp, "hi");
+
+    char *str = creq_Response_stringify(resp);
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200 OK\r\nServer: creq\r\nCache-Control: max-age=60\r\n"
+                             "Content-Length: 2\r\n\r\nhi",
+                             str);
+    char buf[256];
+    size_t needed = 0;
+    size_t len = creq_Response_stringify_into(resp, buf, sizeof(buf), &needed);
+    TEST_ASSERT_EQUAL_UINT(strlen(str), len);
+    TEST_ASSERT_EQUAL_MEMORY(str, buf, len);
+    free(str);
+    TEST_ASSERT_EQUAL_STRING("creq", creq_Response_lookup_header_id(resp, CREQ_HDR_SERVER)->field_value);
+    TEST_ASSERT_NULL(creq_Response_search_for_header_id(resp, CREQ_HDR_SERVER));
+    TEST_ASSERT_EQUAL_STRING("max-age=60", creq_Response_search_for_header(resp, "cache-control")->field_value);
+
+    creq_Response_free(resp);
+}
+
+typedef struct
+{
+    char data[256];
+    size_t len;
+    bool should_abort;
+} body_sink_t;
+
+static creq_status_t body_sink(void *user_data, const char *data, size_t len)
+{
+    body_sink_t *sink = (body_sink_t *)user_data;
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    return sink->should_abort ? CREQ_STATUS_FAILED : CREQ_STATUS_SUCC;
+}
+
+void test_creq_Response_Parse()
+{
+    // chunked, one byte per read, into a buffer that moves and drops delivered body bytes
+    const char *raw = "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, Chunked\r\nServer: test\r\n\r\n"
+                      "4;name=value\r\nWiki\r\n5\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\nX-Trailer: 1\r\n\r\n"
+                      "HTTP/1.1 204 No Content\r\n\r\n";
+    size_t raw_len = strlen(raw);
+    creq_Response_t *resp = creq_Response_create(NULL);
+    creq_Parser_t parser;
+    body_sink_t sink = {{0}, 0, false};
+    creq_Parser_init_response(&parser, NULL, METH_GET, body_sink, &sink);
+    char *buf = NULL;
+    size_t len = 0, fed = 0, max_len = 0;
+    creq_status_t status = CREQ_STATUS_INCOMPLETE;
+    while (status == CREQ_STATUS_INCOMPLETE)
+    {
+        char *grown = malloc(len + 1);
+        if (buf != NULL)
+            memcpy(grown, buf, len);
+        free(buf);
+        buf = grown;
+        buf[len++] = raw[fed++];
+        status = creq_Response_parse(&parser, resp, buf, len);
+        len = creq_Parser_compact(&parser, buf, len);
+        max_len = len > max_len ? len : max_len;
+    }
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, status);
+    TEST_ASSERT_EQUAL_UINT(raw_len - strlen("HTTP/1.1 204 No Content\r\n\r\n"), fed);
+    TEST_ASSERT_TRUE(max_len < parser.head_len + 20);
+    TEST_ASSERT_EQUAL_UINT(strlen("Wikipedia in\r\n\r\nchunks."), sink.len);
+    TEST_ASSERT_EQUAL_MEMORY("Wikipedia in\r\n\r\nchunks.", sink.data, sink.len);
+    TEST_ASSERT_EQUAL_INT(200, creq_Response_get_status_code(resp));
+    TEST_ASSERT_EQUAL_UINT(2, creq_Response_get_reason_phrase_len(resp));
+    TEST_ASSERT_EQUAL_MEMORY("OK", creq_Response_get_reason_phrase(resp), 2);
+    TEST_ASSERT_EQUAL_UINT(2, cvector_size(resp->header_vector));
+    TEST_ASSERT_EQUAL_MEMORY("test", creq_Response_search_for_header_id(resp, CREQ_HDR_SERVER)->field_value, 4);
+    creq_Response_free(resp);
+    free(buf);
+
+    // bodies delimited by Content-Length, by the end of the connection, or absent
+    const struct
+    {
+        const char *raw;
+        creq_HttpMethod_t method;
+        const char *body;
+        size_t consumed;
+        bool needs_eof;
+    } cases[] = {
+        {"HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabcHTTP/1.1", METH_GET, "abc", 41, false},
+        {"HTTP/1.0 200 OK\r\n\r\nuntil close", METH_GET, "until close", 30, true},
+        {"HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\n", METH_HEAD, "", 38, false},
+        {"HTTP/1.1 304 Not Modified\r\nContent-Length: 3\r\n\r\n", METH_GET, "", 48, false},
+        {"HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\n", METH_POST, "", 25, false},
+        {"HTTP/1.1 200 Connection established\r\n\r\nxx", METH_CONNECT, "", 39, false},
+        {"HTTP/1.1 200\r\nContent-Length: 0\r\n\r\n", METH_GET, "", 35, false},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        resp = creq_Response_create(NULL);
+        sink.len = 0;
+        creq_Parser_init_response(&parser, NULL, cases[i].method, body_sink, &sink);
+        status = creq_Response_parse(&parser, resp, cases[i].raw, strlen(cases[i].raw));
+        if (cases[i].needs_eof)
+        {
+            TEST_ASSERT_EQUAL_INT(CREQ_STATUS_INCOMPLETE, status);
+            status = creq_Parser_eof(&parser);
+        }
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, status);
+        TEST_ASSERT_EQUAL_UINT(cases[i].consumed, parser.consumed);
+        TEST_ASSERT_EQUAL_UINT(strlen(cases[i].body), sink.len);
+        TEST_ASSERT_EQUAL_MEMORY(cases[i].body, sink.data, sink.len);
+        creq_Response_free(resp);
+    }
+
+    // failures
+    resp = creq_Response_create(NULL);
+    creq_Parser_init_response(&parser, NULL, METH_GET, NULL, NULL);
+    const char *truncated = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc";
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_INCOMPLETE, creq_Response_parse(&parser, resp, truncated, strlen(truncated)));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Parser_eof(&parser));
+    TEST_ASSERT_EQUAL_INT(PARSE_ERR_TRUNCATED, parser.error);
+    creq_Response_free(resp);
+
+    resp = creq_Response_create(NULL);
+    sink.should_abort = true;
+    creq_Parser_init_response(&parser, NULL, METH_GET, body_sink, &sink);
+    const char *chunked = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n";
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_parse(&parser, resp, chunked, strlen(chunked)));
+    TEST_ASSERT_EQUAL_INT(PARSE_ERR_ABORTED, parser.error);
+    creq_Response_free(resp);
+
+    const char *bad[] = {
+        "HTTP/1.1 2000 OK\r\n\r\n",
+        "HTTP/1.1 200 O\x01K\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab\r\n",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        resp = creq_Response_create(NULL);
+        creq_Parser_init_response(&parser, NULL, METH_GET, NULL, NULL);
+        TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_parse(&parser, resp, bad[i], strlen(bad[i])));
+        TEST_ASSERT_EQUAL_INT(PARSE_ERR_SYNTAX, parser.error);
+        creq_Response_free(resp);
+    }
+}
+
+void test_creq_Response_Validate()
+{
+    creq_Response_t *resp = creq_Response_create(NULL);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase_literal(resp, "OK");
+    creq_Response_add_header_literal(resp, "Content-Type", "text/plain");
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_validate(resp));
+    TEST_ASSERT_TRUE(resp->is_verified);
+
+    creq_Response_set_reason_phrase_literal(resp, "OK\r\nX-Injected: 1");
+    TEST_ASSERT_FALSE(resp->is_verified);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_validate(resp));
+    creq_Response_set_reason_phrase_literal(resp, "");
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_validate(resp));
+    creq_Response_set_status_code(resp, 42);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_validate(resp));
+    creq_Response_set_status_code(resp, 404);
+    creq_Response_add_header_literal(resp, "Bad:Name", "1");
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_validate(resp));
+    creq_Response_remove_header(resp, "Bad:Name");
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_validate(resp));
+
+    // headers inherited from a profile are checked as well
+    creq_Response_t *base = creq_Response_create(NULL);
+    creq_Response_add_header_literal(base, "X-Bad", "\x7F");
+    creq_HeaderProfile_t *profile = creq_HeaderProfile_create_from_response(base);
+    creq_Response_set_header_profile(resp, profile);
+    creq_HeaderProfile_release(profile);
+    creq_Response_free(base);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_validate(resp));
+    creq_Response_free(resp);
+
+    // CONF_OPT_VALIDATE also guards the chunked head, its trailers and templates
+    creq_Config_t config = {0};
+    config.config_type = CONF_RESPONSE;
+    config.data.response_config.line_ending = LE_CRLF;
+    resp = creq_Response_create_with_options(&config, CONF_OPT_VALIDATE);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_add_header(resp, "X-Evil", "a\r\nSet-Cookie: pwn=1");
+    creq_ChunkedEncoder_t enc;
+    char out[256];
+    size_t needed = 1;
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_begin(&enc, resp, out, sizeof(out), &needed));
+    TEST_ASSERT_EQUAL_UINT(0, needed);
+    TEST_ASSERT_NULL(creq_Response_search_for_header_id(resp, CREQ_HDR_TRANSFER_ENCODING));
+    TEST_ASSERT_NULL(creq_Template_compile_response(resp, NULL, 0));
+
+    creq_Response_set_header(resp, "X-Evil", "a");
+    creq_Template_t *tpl = creq_Template_compile_response(resp, NULL, 0);
+    TEST_ASSERT_NOT_NULL(tpl);
+    creq_Template_free(tpl);
+    TEST_ASSERT_NOT_EQUAL(0, creq_ChunkedEncoder_begin(&enc, resp, out, sizeof(out), NULL));
+    creq_HeaderField_t *trailer = creq_HeaderField_create_literal("Expires", "never\r\nSet-Cookie: pwn=1");
+    needed = 1;
+    TEST_ASSERT_EQUAL_UINT(0, creq_ChunkedEncoder_finish(&enc, &trailer, 1, out, sizeof(out), &needed));
+    TEST_ASSERT_EQUAL_UINT(0, needed);
+    TEST_ASSERT_FALSE(enc.is_finished);
+    creq_HeaderField_free(&trailer);
+    trailer = creq_HeaderField_create_literal("Expires", "never");
+    TEST_ASSERT_EQUAL_UINT(21, creq_ChunkedEncoder_finish(&enc, &trailer, 1, out, sizeof(out), NULL));
+    TEST_ASSERT_EQUAL_MEMORY("0\r\nExpires: never\r\n\r\n", out, 21);
+    creq_HeaderField_free(&trailer);
+    creq_Response_free(resp);
+}
+
+static void assert_cached_matches(creq_Response_t *resp)
+{
+    char expected[512];
+    size_t expected_len = creq_Response_stringify_into(resp, expected, sizeof(expected), NULL);
+    size_t len = 0;
+    const char *cached = creq_Response_stringify_cached(resp, &len);
+    TEST_ASSERT_NOT_NULL(cached);
+    TEST_ASSERT_EQUAL_UINT(expected_len, len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, cached, len);
+    TEST_ASSERT_EQUAL_INT('\0', cached[len]);
+}
+
+void test_creq_Response_StringifyCached()
+{
+    creq_Response_t *resp = creq_Response_create(NULL);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 200);
+    creq_Response_set_reason_phrase(resp, "OK");
+    creq_Response_add_header(resp, "Server", "creq");
+    creq_Response_add_header(resp, "X-Request-Id", "1");
+    creq_Response_add_header(resp, "Cache-Control", "no-store");
+    creq_Response_set_message_body_literal_content_len(resp, "hello");
+    assert_cached_matches(resp);
+
+    size_t len = 0;
+    const char *first = creq_Response_stringify_cached(resp, &len);
+    TEST_ASSERT_EQUAL_PTR(first, creq_Response_stringify_cached(resp, NULL));
+
+    creq_Response_set_header(resp, "X-Request-Id", "12345");
+    assert_cached_matches(resp);
+    creq_Response_set_status_code(resp, 404);
+    creq_Response_set_reason_phrase(resp, "Not Found");
+    assert_cached_matches(resp);
+    creq_Response_remove_header(resp, "Server");
+    assert_cached_matches(resp);
+    creq_Response_add_header(resp, "Vary", "Accept");
+    creq_Response_set_message_body_literal_content_len(resp, "no such thing");
+    assert_cached_matches(resp);
+    TEST_ASSERT_GREATER_THAN(sizeof(creq_Response_t) + len, creq_Response_memory_usage(resp));
+
+    creq_Config_t config = {0};
+    config.config_type = CONF_RESPONSE;
+    creq_Response_t *checked = creq_Response_create_with_options(&config, CONF_OPT_VALIDATE);
+    creq_Response_set_http_version(checked, 1, 1);
+    creq_Response_set_status_code(checked, 200);
+    creq_Response_add_header(checked, "X-Bad", "a\r\nb");
+    TEST_ASSERT_NULL(creq_Response_stringify_cached(checked, &len));
+    TEST_ASSERT_EQUAL_UINT(0, len);
+    creq_Response_set_header(checked, "X-Bad", "fine");
+    assert_cached_matches(checked);
+
+    creq_Response_free(checked);
+    creq_Response_free(resp);
+}
+
+void test_creq_Response_StandardStatusLines()
+{
+    creq_Response_t *resp = creq_Response_create(NULL);
+    creq_Response_set_http_version(resp, 1, 1);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_set_status(resp, 299));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_set_status(NULL, 200));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_set_status(resp, 404));
+    TEST_ASSERT_EQUAL_INT(404, creq_Response_get_status_code(resp));
+    TEST_ASSERT_TRUE(resp->is_reason_phrase_literal);
+
+    char buf[128];
+    size_t len = creq_Response_stringify_into(resp, buf, sizeof(buf), NULL);
+    TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 404 Not Found\r\n\r\n\r\n", buf, len);
+    creq_IoVec_t iov[8];
+    creq_IoVecScratch_t scratch;
+    TEST_ASSERT_EQUAL_UINT(3, creq_Response_to_iovec(resp, iov, 8, &scratch, NULL));
+    TEST_ASSERT_EQUAL_UINT(24, iov[0].iov_len);
+
+    // the same phrase given by hand, a custom one and an unregistered code
+    creq_Response_set_http_version(resp, 1, 0);
+    creq_Response_set_reason_phrase(resp, "Not Found");
+    len = creq_Response_stringify_into(resp, buf, sizeof(buf), NULL);
+    TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.0 404 Not Found\r\n\r\n\r\n", buf, len);
+    creq_Response_set_reason_phrase(resp, "Nope");
+    len = creq_Response_stringify_into(resp, buf, sizeof(buf), NULL);
+    TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.0 404 Nope\r\n\r\n\r\n", buf, len);
+    creq_Response_set_status_code(resp, 299);
+    len = creq_Response_stringify_into(resp, buf, sizeof(buf), NULL);
+    TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.0 299 Nope\r\n\r\n\r\n", buf, len);
+    creq_Response_free(resp);
+
+    creq_Config_t config = {0};
+    config.config_type = CONF_RESPONSE;
+    config.data.response_config.line_ending = LE_LF;
+    resp = creq_Response_create(&config);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status(resp, 511);
+    creq_Response_add_header_literal(resp, "Retry-After", "60");
+    len = creq_Response_stringify_into(resp, buf, sizeof(buf), NULL);
+    TEST_ASSERT_EQUAL_STRING_LEN("HTTP/1.1 511 Network Authentication Required\nRetry-After: 60\n\n", buf, len);
+    creq_Response_set_http_version(resp, 2, 0);
+    len = creq_Response_stringify_into(resp, buf, sizeof(buf), NULL);
+    TEST_ASSERT_EQUAL_STRING_LEN("HTTP/2.0 511 Network Authentication Required\nRetry-After: 60\n\n", buf, len);
+    creq_Response_free(resp);
+}
+
+void test_creq_Response_DateHeader()
+{
+    char before[64], after[64];
+    time_t now = time(NULL);
+    strftime(before, sizeof(before), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
+    creq_Response_t *resp = creq_Response_create(NULL);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_add_date_header(resp));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_add_date_header(resp));
+    now = time(NULL);
+    strftime(after, sizeof(after), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
+
+    creq_HeaderField_t *date = creq_Response_search_for_header_id(resp, CREQ_HDR_DATE);
+    TEST_ASSERT_NOT_NULL(date);
+    TEST_ASSERT_EQUAL_UINT(1, cvector_size(resp->header_vector));
+    TEST_ASSERT_TRUE(date->is_field_value_literal);
+    TEST_ASSERT_EQUAL_UINT(CREQ_HTTP_DATE_LEN, date->field_value_len);
+    TEST_ASSERT_TRUE(strcmp(before, date->field_value) == 0 || strcmp(after, date->field_value) == 0);
+
+    // the value points into the response, so a profile made from it must not
+    char expected[128];
+    snprintf(expected, sizeof(expected), "HTTP/1.1 204 No Content\r\nDate: %s\r\n\r\n", date->field_value);
+    creq_HeaderProfile_t *profile = creq_HeaderProfile_create_from_response(resp);
+    creq_Response_free(resp);
+    resp = creq_Response_create(NULL);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status_code(resp, 204);
+    creq_Response_set_reason_phrase_literal(resp, "No Content");
+    creq_Response_set_header_profile(resp, profile);
+    char *str = creq_Response_stringify(resp);
+    TEST_ASSERT_EQUAL_STRING(expected, str);
+    free(str);
+    creq_Response_free(resp);
+    creq_HeaderProfile_release(profile);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_add_date_header(NULL));
+}
+
+void test_creq_Response_Reset()
+{
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite("file body", 1, 9, file);
+    fflush(file);
+    creq_Response_t *base = creq_Response_create(NULL);
+    creq_Response_add_header_literal(base, "Server", "creq");
+    creq_HeaderProfile_t *profile = creq_HeaderProfile_create_from_response(base);
+    creq_Response_free(base);
+
+    creq_Config_t config = {0};
+    config.config_type = CONF_RESPONSE;
+    config.data.response_config.line_ending = LE_CRLF;
+    unsigned options[] = {0, CONF_OPT_HEADER_INDEX, CONF_OPT_ARENA};
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++)
+    {
+        creq_Response_t *resp = creq_Response_create_with_options(&config, options[i]);
+        for (int round = 0; round < 2; round++)
+        {
+            creq_Response_set_http_version(resp, 1, 1);
+            creq_Response_set_status_code(resp, 299);
+            creq_Response_set_reason_phrase_n(resp, "Custom Reason", 13);
+            creq_Response_set_header_profile(resp, profile);
+            TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_add_date_header(resp));
+            TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_set_body_file(resp, fileno(file), 0, 9));
+            char *head = creq_Response_stringify(resp);
+            TEST_ASSERT_NOT_NULL(strstr(head, "HTTP/1.1 299 Custom Reason\r\nServer: creq\r\nDate: "));
+            TEST_ASSERT_NOT_NULL(strstr(head, "\r\nContent-Length: 9\r\n\r\n"));
+            free(head);
+
+            TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_reset(resp));
+            TEST_ASSERT_EQUAL_INT(0, resp->status_code);
+            TEST_ASSERT_NULL(creq_Response_get_reason_phrase(resp));
+            TEST_ASSERT_NULL(resp->header_profile);
+            TEST_ASSERT_EQUAL_INT(-1, resp->body_file.fd);
+            TEST_ASSERT_EQUAL_UINT(0, cvector_size(resp->header_vector));
+            TEST_ASSERT_NULL(creq_Response_search_for_header_id(resp, CREQ_HDR_DATE));
+            TEST_ASSERT_NULL(creq_Response_lookup_header_id(resp, CREQ_HDR_SERVER));
+
+            // reused as a plain response, nothing of the previous one may leak through
+            creq_Response_set_http_version(resp, 1, 1);
+            creq_Response_set_status_code(resp, 200);
+            creq_Response_set_reason_phrase_literal(resp, "OK");
+            creq_Response_set_message_body_literal_content_len(resp, "hi");
+            char *str = creq_Response_stringify(resp);
+            TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nhi", str);
+            free(str);
+            TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Response_reset(resp));
+        }
+        creq_Response_free(resp);
+    }
+    creq_HeaderProfile_release(profile);
+    fclose(file);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Response_reset(NULL));
+}
+
+#ifdef CREQ_POSIX_IO
+/// Runs a writer against a non-blocking socket, reading at most 'step' bytes per readiness event.
+static size_t write_nonblocking(creq_Writer_t *writer, char *out, size_t cap, size_t step)
+{
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    int sndbuf = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    size_t got = 0, rounds = 0;
+    creq_status_t status;
+    while ((status = creq_Writer_write(writer, fds[0])) == CREQ_STATUS_INCOMPLETE)
+    {
+        ssize_t n = read(fds[1], out + got, cap - got < step ? cap - got : step);
+        TEST_ASSERT_TRUE(n > 0);
+        got += (size_t)n;
+        rounds++;
+    }
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, status);
+    TEST_ASSERT_TRUE(rounds > 1);
+    close(fds[0]);
+    for (ssize_t n; (n = read(fds[1], out + got, cap - got)) > 0;)
+    {
+        got += (size_t)n;
+    }
+    close(fds[1]);
+    return got;
+}
+#endif
+
+void test_creq_Response_Writer()
+{
+#ifdef CREQ_POSIX_IO
+    const size_t body_len = 200000, cap = body_len * 2;
+    char *body = (char *)malloc(body_len), *out = (char *)malloc(cap);
+    for (size_t i = 0; i < body_len; i++)
+    {
+        body[i] = (char)('a' + i % 26);
+    }
+    creq_Config_t resp_conf = {0};
+    resp_conf.config_type = CONF_RESPONSE;
+    resp_conf.data.response_config.line_ending = LE_CRLF;
+    creq_Response_t *resp = creq_Response_create(&resp_conf);
+    creq_Response_set_http_version(resp, 1, 1);
+    creq_Response_set_status(resp, 200);
+    for (int i = 0; i < 100; i++)
+    {
+        creq_Response_add_header_literal(resp, "X-Filler", "0123456789abcdefghijklmnopqrstuvwxyz");
+    }
+    creq_Response_set_message_body_bytes(resp, body, body_len, OWN_BORROW);
+    creq_Response_update_content_len(resp);
+    size_t len = 0;
+    const char *expected = creq_Response_stringify_cached(resp, &len);
+
+    creq_Writer_t writer;
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Writer_init_response(&writer, resp));
+    TEST_ASSERT_EQUAL_UINT(len, write_nonblocking(&writer, out, cap, 1000));
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, len);
+    TEST_ASSERT_TRUE(writer.is_finished);
+    TEST_ASSERT_EQUAL_UINT(len, (size_t)writer.written);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Writer_write(&writer, -1));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Writer_write(&writer, 1));
+
+    // a body file follows the head
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(body, 1, body_len, file);
+    fflush(file);
+    creq_Response_set_body_file(resp, fileno(file), 7, body_len - 7);
+    size_t head_len = 0;
+    creq_Response_stringify_into(resp, NULL, 0, &head_len);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Writer_init_response(&writer, resp));
+    TEST_ASSERT_EQUAL_UINT(head_len + body_len - 7, write_nonblocking(&writer, out, cap, 3000));
+    TEST_ASSERT_EQUAL_MEMORY(body + 7, out + head_len, body_len - 7);
+    TEST_ASSERT_EQUAL_UINT(body_len - 7, writer.file_offset);
+
+    // a peer that has gone away fails the write instead of raising SIGPIPE
+    int sock_fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sock_fds));
+    close(sock_fds[1]);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Writer_init_response(&writer, resp));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Writer_write(&writer, sock_fds[0]));
+    TEST_ASSERT_EQUAL_INT(EPIPE, errno);
+    TEST_ASSERT_EQUAL_UINT(0, (size_t)writer.written);
+    close(sock_fds[0]);
+    fclose(file);
+
+    creq_Request_t *req = creq_Request_create(NULL);
+    creq_Request_set_http_method(req, METH_POST);
+    creq_Request_set_target(req, "/upload", true);
+    creq_Request_set_http_version(req, 1, 1);
+    creq_Request_set_message_body_bytes(req, body, body_len, OWN_BORROW);
+    char *expected_req = creq_Request_stringify(req);
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_SUCC, creq_Writer_init_request(&writer, req));
+    TEST_ASSERT_EQUAL_UINT(strlen(expected_req), write_nonblocking(&writer, out, cap, 5000));
+    TEST_ASSERT_EQUAL_MEMORY(expected_req, out, strlen(expected_req));
+    TEST_ASSERT_EQUAL_INT(CREQ_STATUS_FAILED, creq_Writer_init_request(&writer, NULL));
+
+    creq_free(expected_req);
+    creq_Request_free(req);
+    creq_Response_free(resp);
+    free(out);
+    free(body);
+#else
+    TEST_IGNORE_MESSAGE("POSIX I/O unavailable");
+#endif
+}
+
 int main(int argc, char *argv[])
 {
     UNITY_BEGIN();
+    RUN_TEST(test_creq_Response_BasicOperations);
+    RUN_TEST(test_creq_Response_ContentLenCalculation);
+    RUN_TEST(test_creq_Response_StringifyInto);
+    RUN_TEST(test_creq_Response_ToIoVec);
+    RUN_TEST(test_creq_Response_ArenaMode);
+    RUN_TEST(test_creq_Response_HeaderIndexAndUpsert);
+    RUN_TEST(test_creq_Response_WellKnownHeaderIds);
+    RUN_TEST(test_creq_Response_BinaryBody);
+    RUN_TEST(test_creq_Response_LengthSetters);
+    RUN_TEST(test_creq_Response_BodyFile);
+    RUN_TEST(test_creq_Response_ChunkedEncoder);
+    RUN_TEST(test_creq_Response_HeaderProfile);
+    RUN_TEST(test_creq_Response_Parse);
+    RUN_TEST(test_creq_Response_Validate);
+    RUN_TEST(test_creq_Response_StringifyCached);
+    RUN_TEST(test_creq_Response_StandardStatusLines);
+    RUN_TEST(test_creq_Response_DateHeader);
+    RUN_TEST(test_creq_Response_Reset);
+    RUN_TEST(test_creq_Response_Writer);
 
     return UNITY_END();
 }
\ No newline at end of file